@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SGame.h"
+#include "SGAliasTable.h"
+
+bool FSGAliasTable::Build(const TArray<float>& Weights)
+{
+	Thresholds.Reset();
+	Aliases.Reset();
+
+	double TotalWeight = 0;
+	for (const float Weight : Weights)
+	{
+		TotalWeight += FMath::Max(Weight, 0.0f);
+	}
+	if (TotalWeight <= 0)
+	{
+		return false;
+	}
+
+	// Scale the weights so the average column holds 1
+	const int32 Num = Weights.Num();
+	TArray<double> ScaledWeights;
+	ScaledWeights.SetNumUninitialized(Num);
+	TArray<int32> SmallIndices;
+	TArray<int32> LargeIndices;
+	for (int32 i = 0; i < Num; i++)
+	{
+		ScaledWeights[i] = FMath::Max(Weights[i], 0.0f) * Num / TotalWeight;
+		if (ScaledWeights[i] < 1.0)
+		{
+			SmallIndices.Push(i);
+		}
+		else
+		{
+			LargeIndices.Push(i);
+		}
+	}
+
+	const double FullThreshold = static_cast<double>(uint64(1) << 32);
+	Thresholds.SetNumUninitialized(Num);
+	Aliases.SetNumUninitialized(Num);
+
+	// Fill every small column with a piece of a large one
+	while (SmallIndices.Num() > 0 && LargeIndices.Num() > 0)
+	{
+		const int32 SmallIndex = SmallIndices.Pop(false);
+		const int32 LargeIndex = LargeIndices.Pop(false);
+		Thresholds[SmallIndex] = static_cast<uint64>(ScaledWeights[SmallIndex] * FullThreshold);
+		Aliases[SmallIndex] = LargeIndex;
+
+		ScaledWeights[LargeIndex] = (ScaledWeights[LargeIndex] + ScaledWeights[SmallIndex]) - 1.0;
+		if (ScaledWeights[LargeIndex] < 1.0)
+		{
+			SmallIndices.Push(LargeIndex);
+		}
+		else
+		{
+			LargeIndices.Push(LargeIndex);
+		}
+	}
+
+	// The left columns are full, the small ones are only left by the rounding errors
+	for (const int32 LargeIndex : LargeIndices)
+	{
+		Thresholds[LargeIndex] = uint64(1) << 32;
+		Aliases[LargeIndex] = LargeIndex;
+	}
+	for (const int32 SmallIndex : SmallIndices)
+	{
+		Thresholds[SmallIndex] = uint64(1) << 32;
+		Aliases[SmallIndex] = SmallIndex;
+	}
+
+	return true;
+}
+
+double FSGAliasTable::GetProbability(int32 Index) const
+{
+	const int32 Num = Thresholds.Num();
+	if (Num == 0 || Index < 0 || Index >= Num)
+	{
+		return 0;
+	}
+
+	// Own part of the column, plus the parts of the columns aliased to the index
+	const double FullThreshold = static_cast<double>(uint64(1) << 32);
+	double Probability = Thresholds[Index] / FullThreshold;
+	for (int32 Column = 0; Column < Num; Column++)
+	{
+		if (Aliases[Column] == Index && Column != Index)
+		{
+			Probability += 1.0 - Thresholds[Column] / FullThreshold;
+		}
+	}
+	return Probability / Num;
+}
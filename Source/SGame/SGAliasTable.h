@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SGame.h"
+
+/**
+ * Vose alias table, draws an index by the weights in constant time.
+ * The draw only uses the integer output of the random stream, so the same stream gives the same indices on every platform.
+ */
+class SGAME_API FSGAliasTable
+{
+public:
+	FSGAliasTable() {}
+
+	/**
+	* Build the table from the weights, the negative weights count as 0
+	*
+	* @param Weights	the weight of every index
+	* @return false if there is no positive weight, the table draws 0 then
+	*/
+	bool Build(const TArray<float>& Weights);
+
+	/** Draw an index */
+	int32 Draw(FRandomStream& RandomStream) const
+	{
+		const int32 Num = Thresholds.Num();
+		if (Num == 0)
+		{
+			return 0;
+		}
+
+		// Pick the column by the first number, then the column index or its alias by the second one
+		const int32 Column = static_cast<int32>((static_cast<uint64>(RandomStream.GetUnsignedInt()) * Num) >> 32);
+		return static_cast<uint64>(RandomStream.GetUnsignedInt()) < Thresholds[Column] ? Column : Aliases[Column];
+	}
+
+	int32 Num() const { return Thresholds.Num(); }
+
+	/** The probability of the index, from the built table */
+	double GetProbability(int32 Index) const;
+
+private:
+	/** Keep the column index when the random number is below the threshold, 1 << 32 means always */
+	TArray<uint64> Thresholds;
+
+	/** The other index of the column */
+	TArray<int32> Aliases;
+};
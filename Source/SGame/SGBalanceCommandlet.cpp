@@ -0,0 +1,395 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SGame.h"
+#include "SGBalanceCommandlet.h"
+#include "SGLevelTileManager.h"
+#include "SGHintSearch.h"
+#include "Async/ParallelFor.h"
+
+/** Settings shared by all the games of a balance run */
+struct FSGBalanceSettings
+{
+	int32 GameNum;
+	int32 RoundNum;
+	int32 FirstSeed;
+	int32 GridWidth;
+	int32 GridHeight;
+	int32 PlayerHPMax;
+	int32 MaxLinkLength;
+	int32 MinimumLinkLength;
+	int32 MaxDeadlockReshuffleNum;
+
+	/** The player plays the hint link line instead of the greedy one */
+	bool bHintPolicy;
+};
+
+/** What happened in one game */
+struct FSGBalanceGameResult
+{
+	int32 Seed;
+
+	/** Rounds the player finished alive */
+	int32 SurvivedRoundNum;
+	bool bPlayerDied;
+
+	/** Refills which left no link line on the board, the board is reshuffled or regenerated then */
+	int32 DeadlockNum;
+
+	/** Deadlocks the shuffles couldn't fix, the board was regenerated */
+	int32 RegeneratedNum;
+
+	int32 EnemyKillNum;
+	float ShieldDamageTaken;
+	float DirectDamageTaken;
+
+	/** Collected resources, using the resource type as index */
+	float ResourceIncome[static_cast<int32>(ESGResourceType::ETT_MAX)];
+};
+
+/** Distribution of one metric over the games */
+struct FSGBalanceDistribution
+{
+	double Mean;
+	double Min;
+	double P10;
+	double P50;
+	double P90;
+	double Max;
+
+	void Build(TArray<double>& Values)
+	{
+		Values.Sort();
+		const int32 Num = Values.Num();
+		double Sum = 0;
+		for (const double Value : Values)
+		{
+			Sum += Value;
+		}
+		Mean = Num > 0 ? Sum / Num : 0;
+		Min = Num > 0 ? Values[0] : 0;
+		P10 = Num > 0 ? Values[(Num - 1) * 10 / 100] : 0;
+		P50 = Num > 0 ? Values[(Num - 1) * 50 / 100] : 0;
+		P90 = Num > 0 ? Values[(Num - 1) * 90 / 100] : 0;
+		Max = Num > 0 ? Values[Num - 1] : 0;
+	}
+
+	FString ToJson() const
+	{
+		return FString::Printf(TEXT("{ \"mean\": %f, \"min\": %f, \"p10\": %f, \"p50\": %f, \"p90\": %f, \"max\": %f }"), Mean, Min, P10, P50, P90, Max);
+	}
+};
+
+/** Reshuffle the dead board like the grid, and count it */
+static void ResolveBalanceDeadlock(FSGBoardState& Board, const FSGBalanceSettings& Settings, FSGLinkSolver& Solver, const FSGAliasTable& TileTable, const TArray<FSGBoardTile>& TileArchetypes, FRandomStream& RandomStream, FSGBalanceGameResult& Result)
+{
+	const ESGDeadlockResolve DeadlockResolve = FSGBoardRules::ResolveDeadlock(Board, Settings.MinimumLinkLength, Settings.MaxDeadlockReshuffleNum, Solver, TileTable, TileArchetypes, RandomStream);
+	Result.DeadlockNum += DeadlockResolve != ESGDeadlockResolve::None ? 1 : 0;
+	Result.RegeneratedNum += DeadlockResolve == ESGDeadlockResolve::Regenerated || DeadlockResolve == ESGDeadlockResolve::Failed ? 1 : 0;
+}
+
+/**
+ * Scripted player: try the greedy link line from every address, prefer the lines through the enemies, then the longer lines.
+ * Fall back to the solver when no greedy line is long enough.
+ *
+ * @return false if there is no link line long enough on the board
+ */
+static bool ChooseLinkLine(const FSGBoardState& Board, const FSGBalanceSettings& Settings, FSGLinkSolver& Solver, TArray<int32>& CandidateAddresses, TArray<int32>& OutLinkAddresses)
+{
+	int32 BestScore = -1;
+	for (int32 StartAddress = 0; StartAddress < Board.Num(); StartAddress++)
+	{
+		FSGBoardRules::BuildGreedyLinkLine(Board, StartAddress, Settings.MaxLinkLength, CandidateAddresses);
+		if (CandidateAddresses.Num() < Settings.MinimumLinkLength)
+		{
+			continue;
+		}
+
+		int32 Score = CandidateAddresses.Num();
+		for (const int32 GridAddress : CandidateAddresses)
+		{
+			if (FSGBoardRules::IsLinkDamageTarget(Board.GetTile(GridAddress).Abilities) == true)
+			{
+				Score += Settings.MaxLinkLength;
+			}
+		}
+
+		if (Score > BestScore)
+		{
+			BestScore = Score;
+			OutLinkAddresses = CandidateAddresses;
+		}
+	}
+
+	if (BestScore < 0)
+	{
+		Solver.BuildFromBoardState(Board);
+		return Solver.FindLinkLine(Settings.MinimumLinkLength, &OutLinkAddresses);
+	}
+	return true;
+}
+
+/** Hint player: play the most valuable link line, like the bot player in the game */
+static bool ChooseHintLinkLine(const FSGBoardState& Board, const FSGBalanceSettings& Settings, FSGHintSearch& HintSearch, FSGHintResult& HintResult, TArray<int32>& OutLinkAddresses)
+{
+	FSGHintSettings HintSettings;
+	HintSettings.MinimumLength = Settings.MinimumLinkLength;
+	HintSettings.MaxLength = Settings.MaxLinkLength;
+	if (HintSearch.Search(Board, TArray<int32>(), HintSettings, HintResult) == false)
+	{
+		return false;
+	}
+
+	OutLinkAddresses = HintResult.LinkAddresses;
+	return true;
+}
+
+/** Play one game, the player model follows ASGSpritePawn: integer HP clamped to the max HP, the armor doesn't block the damage yet */
+static void PlayBalanceGame(const FSGBalanceSettings& Settings, const TArray<FSGAliasTable>& RoundTileTables, const TArray<FSGBoardTile>& TileArchetypes, int32 inSeed, FSGBalanceGameResult& OutResult)
+{
+	FMemory::Memzero(OutResult);
+	OutResult.Seed = inSeed;
+
+	// Same as the game start, the first board comes from the round 0 table
+	FRandomStream RandomStream(inSeed);
+	FSGBoardState Board;
+	Board.Init(Settings.GridWidth, Settings.GridHeight);
+	FSGBoardRules::RefillBoard(Board, RoundTileTables[0], TileArchetypes, RandomStream);
+	FSGLinkSolver Solver;
+	ResolveBalanceDeadlock(Board, Settings, Solver, RoundTileTables[0], TileArchetypes, RandomStream, OutResult);
+
+	TArray<int32> CandidateAddresses;
+	TArray<int32> LinkAddresses;
+	FSGLinkResult LinkResult;
+	FSGHintSearch HintSearch;
+	FSGHintResult HintResult;
+	int32 CurrentHP = Settings.PlayerHPMax;
+	for (int32 Round = 1; Round <= Settings.RoundNum; Round++)
+	{
+		const FSGAliasTable& RoundTileTable = RoundTileTables[FMath::Clamp(Round, 0, RoundTileTables.Num() - 1)];
+
+		// Player turn, the board always has a link line after the deadlock is resolved
+		const bool bHasLinkLine = Settings.bHintPolicy == true ?
+			ChooseHintLinkLine(Board, Settings, HintSearch, HintResult, LinkAddresses) :
+			ChooseLinkLine(Board, Settings, Solver, CandidateAddresses, LinkAddresses);
+		if (bHasLinkLine == true &&
+			FSGBoardRules::SimulateLink(Board, LinkAddresses, Settings.MinimumLinkLength, RoundTileTable, TileArchetypes, RandomStream, LinkResult) == true)
+		{
+			for (int32 ResourceIndex = 0; ResourceIndex < LinkResult.Resources.Num(); ResourceIndex++)
+			{
+				OutResult.ResourceIncome[ResourceIndex] += LinkResult.Resources[ResourceIndex];
+			}
+			for (const int32 GridAddress : LinkResult.DamagedAddresses)
+			{
+				OutResult.EnemyKillNum += LinkResult.CollectedAddresses.Contains(GridAddress) ? 1 : 0;
+			}
+			CurrentHP = FMath::Min(CurrentHP + FMath::TruncToInt(LinkResult.Resources[static_cast<int32>(ESGResourceType::ETR_HP)]), Settings.PlayerHPMax);
+			ResolveBalanceDeadlock(Board, Settings, Solver, RoundTileTable, TileArchetypes, RandomStream, OutResult);
+		}
+
+		// Enemy attack
+		float ShieldDamage = 0;
+		float DirectDamage = 0;
+		if (FSGBoardRules::CalculateEnemyAttackDamage(Board, ShieldDamage, DirectDamage) == true)
+		{
+			CurrentHP = CurrentHP - FMath::TruncToInt(DirectDamage);
+			OutResult.ShieldDamageTaken += ShieldDamage;
+			OutResult.DirectDamageTaken += DirectDamage;
+		}
+
+		if (CurrentHP <= 0)
+		{
+			OutResult.bPlayerDied = true;
+			break;
+		}
+		OutResult.SurvivedRoundNum = Round;
+	}
+}
+
+/** Write the games to the CSV file and the distributions to the JSON file */
+static void WriteBalanceReport(const FString& inTileManagerName, const FString& inOutputDir, const FSGBalanceSettings& Settings, const TArray<FSGBalanceGameResult>& Results, double inSeconds)
+{
+	const int32 ResourceNum = static_cast<int32>(ESGResourceType::ETT_MAX);
+	const UEnum* ResourceEnum = StaticEnum<ESGResourceType>();
+
+	// One row for every game
+	FString Csv = TEXT("Seed,SurvivedRounds,Died,Deadlocks,Regenerated,EnemyKills,ShieldDamage,DirectDamage");
+	for (int32 ResourceIndex = 0; ResourceIndex < ResourceNum; ResourceIndex++)
+	{
+		Csv += FString::Printf(TEXT(",Income_%s"), *ResourceEnum->GetNameStringByIndex(ResourceIndex));
+	}
+	Csv += LINE_TERMINATOR;
+	for (const FSGBalanceGameResult& Result : Results)
+	{
+		Csv += FString::Printf(TEXT("%d,%d,%d,%d,%d,%d,%f,%f"), Result.Seed, Result.SurvivedRoundNum, Result.bPlayerDied ? 1 : 0, Result.DeadlockNum, Result.RegeneratedNum, Result.EnemyKillNum, Result.ShieldDamageTaken, Result.DirectDamageTaken);
+		for (int32 ResourceIndex = 0; ResourceIndex < ResourceNum; ResourceIndex++)
+		{
+			Csv += FString::Printf(TEXT(",%f"), Result.ResourceIncome[ResourceIndex]);
+		}
+		Csv += LINE_TERMINATOR;
+	}
+
+	// The distributions over the games
+	TArray<double> Values;
+	Values.Reserve(Results.Num());
+	auto BuildDistribution = [&Results, &Values](TFunctionRef<double(const FSGBalanceGameResult&)> GetValue)
+	{
+		Values.Reset();
+		for (const FSGBalanceGameResult& Result : Results)
+		{
+			Values.Add(GetValue(Result));
+		}
+		FSGBalanceDistribution Distribution;
+		Distribution.Build(Values);
+		return Distribution;
+	};
+
+	const FSGBalanceDistribution SurvivedRounds = BuildDistribution([](const FSGBalanceGameResult& Result) { return static_cast<double>(Result.SurvivedRoundNum); });
+	const FSGBalanceDistribution ShieldDamage = BuildDistribution([](const FSGBalanceGameResult& Result) { return static_cast<double>(Result.ShieldDamageTaken); });
+	const FSGBalanceDistribution DirectDamage = BuildDistribution([](const FSGBalanceGameResult& Result) { return static_cast<double>(Result.DirectDamageTaken); });
+	const FSGBalanceDistribution Deadlocks = BuildDistribution([](const FSGBalanceGameResult& Result) { return static_cast<double>(Result.DeadlockNum); });
+	const FSGBalanceDistribution EnemyKills = BuildDistribution([](const FSGBalanceGameResult& Result) { return static_cast<double>(Result.EnemyKillNum); });
+
+	// Survival curve, how many games are still alive after every round
+	TArray<int32> AliveNums;
+	AliveNums.AddZeroed(Settings.RoundNum + 1);
+	int32 PlayedRoundNum = 0;
+	int32 DeadlockNum = 0;
+	int32 DeadlockedGameNum = 0;
+	for (const FSGBalanceGameResult& Result : Results)
+	{
+		for (int32 Round = 0; Round <= Result.SurvivedRoundNum; Round++)
+		{
+			AliveNums[Round]++;
+		}
+		PlayedRoundNum += Result.SurvivedRoundNum + (Result.bPlayerDied ? 1 : 0);
+		DeadlockNum += Result.DeadlockNum;
+		DeadlockedGameNum += Result.DeadlockNum > 0 ? 1 : 0;
+	}
+	const double GameNum = FMath::Max(Results.Num(), 1);
+	const double DeadlockPerRound = static_cast<double>(DeadlockNum) / FMath::Max(PlayedRoundNum, 1);
+
+	FString Json = TEXT("{") LINE_TERMINATOR;
+	Json += FString::Printf(TEXT("\t\"tileManager\": \"%s\",") LINE_TERMINATOR, *inTileManagerName);
+	Json += FString::Printf(TEXT("\t\"games\": %d, \"rounds\": %d, \"firstSeed\": %d, \"gridWidth\": %d, \"gridHeight\": %d, \"playerHP\": %d, \"policy\": \"%s\", \"seconds\": %f,") LINE_TERMINATOR,
+		Results.Num(), Settings.RoundNum, Settings.FirstSeed, Settings.GridWidth, Settings.GridHeight, Settings.PlayerHPMax, Settings.bHintPolicy ? TEXT("hint") : TEXT("greedy"), inSeconds);
+	Json += TEXT("\t\"playerModel\": \"integer HP clamped to playerHP, the shield damage is only recorded and not taken from any shield\",") LINE_TERMINATOR;
+	Json += FString::Printf(TEXT("\t\"survivedRounds\": %s,") LINE_TERMINATOR, *SurvivedRounds.ToJson());
+	Json += FString::Printf(TEXT("\t\"shieldDamageTaken\": %s,") LINE_TERMINATOR, *ShieldDamage.ToJson());
+	Json += FString::Printf(TEXT("\t\"directDamageTaken\": %s,") LINE_TERMINATOR, *DirectDamage.ToJson());
+	Json += FString::Printf(TEXT("\t\"enemyKills\": %s,") LINE_TERMINATOR, *EnemyKills.ToJson());
+	Json += FString::Printf(TEXT("\t\"deadlocks\": %s,") LINE_TERMINATOR, *Deadlocks.ToJson());
+	Json += FString::Printf(TEXT("\t\"deadlockPerRound\": %f, \"deadlockedGameRatio\": %f,") LINE_TERMINATOR, DeadlockPerRound, DeadlockedGameNum / GameNum);
+	Json += TEXT("\t\"income\": {") LINE_TERMINATOR;
+	for (int32 ResourceIndex = 0; ResourceIndex < ResourceNum; ResourceIndex++)
+	{
+		const FSGBalanceDistribution Income = BuildDistribution([ResourceIndex](const FSGBalanceGameResult& Result) { return static_cast<double>(Result.ResourceIncome[ResourceIndex]); });
+		Json += FString::Printf(TEXT("\t\t\"%s\": %s%s") LINE_TERMINATOR, *ResourceEnum->GetNameStringByIndex(ResourceIndex), *Income.ToJson(), ResourceIndex + 1 < ResourceNum ? TEXT(",") : TEXT(""));
+	}
+	Json += TEXT("\t},") LINE_TERMINATOR;
+	Json += TEXT("\t\"survivalCurve\": [");
+	for (int32 Round = 0; Round < AliveNums.Num(); Round++)
+	{
+		Json += FString::Printf(TEXT("%s%f"), Round > 0 ? TEXT(", ") : TEXT(""), AliveNums[Round] / GameNum);
+	}
+	Json += TEXT("]") LINE_TERMINATOR TEXT("}") LINE_TERMINATOR;
+
+	const FString CsvPath = FPaths::Combine(inOutputDir, inTileManagerName + TEXT(".csv"));
+	const FString JsonPath = FPaths::Combine(inOutputDir, inTileManagerName + TEXT(".json"));
+	if (FFileHelper::SaveStringToFile(Csv, *CsvPath) == false || FFileHelper::SaveStringToFile(Json, *JsonPath) == false)
+	{
+		UE_LOG(LogSGame, Error, TEXT("Cannot write the balance report to %s"), *inOutputDir);
+		return;
+	}
+
+	UE_LOG(LogSGame, Display, TEXT("%s: %d games in %.2f s, survived rounds mean %.1f p10 %.0f p50 %.0f p90 %.0f, direct damage mean %.1f, deadlock %.4f per round"),
+		*inTileManagerName, Results.Num(), inSeconds, SurvivedRounds.Mean, SurvivedRounds.P10, SurvivedRounds.P50, SurvivedRounds.P90, DirectDamage.Mean, DeadlockPerRound);
+	UE_LOG(LogSGame, Display, TEXT("%s: report written to %s and %s"), *inTileManagerName, *CsvPath, *JsonPath);
+}
+
+USGBalanceCommandlet::USGBalanceCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 USGBalanceCommandlet::Main(const FString& Params)
+{
+	FString TileManagerNames;
+	if (FParse::Value(*Params, TEXT("TileManager="), TileManagerNames, false) == false)
+	{
+		UE_LOG(LogSGame, Error, TEXT("Usage: -run=SGBalance -TileManager=LevelTileManager_1_1[,LevelTileManager_1_2] [-Games=1000] [-Rounds=100] [-Seed=1] [-Width=6] [-Height=6] [-HP=100] [-MaxLinkLength=8] [-OutputDir=]"));
+		return 1;
+	}
+
+	FSGBalanceSettings Settings;
+	Settings.GameNum = 1000;
+	Settings.RoundNum = 100;
+	Settings.FirstSeed = 1;
+	Settings.GridWidth = 6;
+	Settings.GridHeight = 6;
+	Settings.PlayerHPMax = 100;
+	Settings.MaxLinkLength = 8;
+	Settings.MinimumLinkLength = 3;
+	Settings.MaxDeadlockReshuffleNum = 8;
+	FParse::Value(*Params, TEXT("Games="), Settings.GameNum);
+	FParse::Value(*Params, TEXT("Rounds="), Settings.RoundNum);
+	FParse::Value(*Params, TEXT("Seed="), Settings.FirstSeed);
+	FParse::Value(*Params, TEXT("Width="), Settings.GridWidth);
+	FParse::Value(*Params, TEXT("Height="), Settings.GridHeight);
+	FParse::Value(*Params, TEXT("HP="), Settings.PlayerHPMax);
+	FParse::Value(*Params, TEXT("MaxLinkLength="), Settings.MaxLinkLength);
+	Settings.GameNum = FMath::Max(Settings.GameNum, 1);
+	Settings.RoundNum = FMath::Max(Settings.RoundNum, 1);
+	Settings.GridWidth = FMath::Max(Settings.GridWidth, 1);
+	Settings.GridHeight = FMath::Max(Settings.GridHeight, 1);
+	Settings.MaxLinkLength = FMath::Max(Settings.MaxLinkLength, Settings.MinimumLinkLength);
+	Settings.bHintPolicy = FParse::Param(*Params, TEXT("HintPolicy"));
+
+	FString OutputDir = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Balance"));
+	FParse::Value(*Params, TEXT("OutputDir="), OutputDir);
+
+	TArray<FString> TileManagerNameArray;
+	TileManagerNames.ParseIntoArray(TileManagerNameArray, TEXT(","));
+	int32 FailedNum = 0;
+	for (const FString& TileManagerName : TileManagerNameArray)
+	{
+		// The short name is a blueprint in the blueprints folder
+		const FString ClassPath = TileManagerName.Contains(TEXT("/")) ? TileManagerName : FString::Printf(TEXT("/Game/Blueprints/%s.%s_C"), *TileManagerName, *TileManagerName);
+		UClass* TileManagerClass = LoadClass<ASGLevelTileManager>(nullptr, *ClassPath);
+		if (TileManagerClass == nullptr)
+		{
+			UE_LOG(LogSGame, Error, TEXT("Cannot load the tile manager class %s"), *ClassPath);
+			FailedNum++;
+			continue;
+		}
+
+		// Read the library from the class defaults once, the games only read the tables
+		const ASGLevelTileManager* TileManager = TileManagerClass->GetDefaultObject<ASGLevelTileManager>();
+		TArray<FSGAliasTable> RoundTileTables;
+		TArray<FSGBoardTile> TileArchetypes;
+		TileManager->BuildRoundTileTables(RoundTileTables);
+		TileManager->BuildTileArchetypes(TileArchetypes);
+		if (TileArchetypes.Num() == 0)
+		{
+			UE_LOG(LogSGame, Error, TEXT("The tile library of %s is empty"), *ClassPath);
+			FailedNum++;
+			continue;
+		}
+
+		// Every game has its own board and random stream
+		TArray<FSGBalanceGameResult> Results;
+		Results.SetNumUninitialized(Settings.GameNum);
+		const double StartTime = FPlatformTime::Seconds();
+		ParallelFor(Settings.GameNum, [&Settings, &RoundTileTables, &TileArchetypes, &Results](int32 GameIndex)
+		{
+			PlayBalanceGame(Settings, RoundTileTables, TileArchetypes, Settings.FirstSeed + GameIndex, Results[GameIndex]);
+		});
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+		WriteBalanceReport(FPaths::GetBaseFilename(TileManagerName), OutputDir, Settings, Results, Seconds);
+	}
+
+	return FailedNum > 0 ? 1 : 0;
+}
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "SGBalanceCommandlet.generated.h"
+
+/**
+ * Plays seeded headless games with the tile library of a tile manager class, and reports the balance distributions.
+ * The games run in parallel on the headless board rules, one random stream for every game.
+ *
+ * SGame.uproject -run=SGBalance -TileManager=LevelTileManager_1_1,LevelTileManager_1_2 -Games=10000 -Rounds=100
+ *
+ * Options:
+ *	-TileManager=	tile manager blueprint names under /Game/Blueprints, or the full class paths, comma separated
+ *	-Games=			games to play for every tile manager, default 1000
+ *	-Rounds=		stop the surviving games after this round, default 100
+ *	-Seed=			seed of the first game, the game N uses Seed + N, default 1
+ *	-Width= -Height=	board size, default 6x6
+ *	-HP=			player max HP, default 100
+ *	-MaxLinkLength=	longest link line the policy tries, default 8
+ *	-HintPolicy		play the most valuable link line from the hint search instead of the greedy one
+ *	-OutputDir=		where the CSV and JSON files go, default Saved/Balance
+ *
+ * The player model is the one of ASGSpritePawn, the shield damage is reported but the armor doesn't absorb it yet.
+ */
+UCLASS()
+class SGAME_API USGBalanceCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USGBalanceCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,255 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SGame.h"
+#include "SGBitBoard.h"
+#include "SGBoardGeometry.h"
+
+void FSGBoardMask::Init(int32 inNumBits)
+{
+	checkSlow(inNumBits >= 0);
+	NumBits = inNumBits;
+	Words.Reset();
+	Words.AddZeroed((inNumBits + 63) >> 6);
+}
+
+void FSGBoardMask::Reset()
+{
+	for (int32 i = 0; i < Words.Num(); i++)
+	{
+		Words[i] = 0;
+	}
+}
+
+void FSGBoardMask::SetAll()
+{
+	for (int32 i = 0; i < Words.Num(); i++)
+	{
+		Words[i] = ~uint64(0);
+	}
+	MaskLastWord();
+}
+
+bool FSGBoardMask::IsEmpty() const
+{
+	for (int32 i = 0; i < Words.Num(); i++)
+	{
+		if (Words[i] != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int32 FSGBoardMask::CountBits() const
+{
+	int32 Count = 0;
+	for (int32 i = 0; i < Words.Num(); i++)
+	{
+		uint64 Word = Words[i];
+		while (Word != 0)
+		{
+			Word &= Word - 1;
+			Count++;
+		}
+	}
+	return Count;
+}
+
+void FSGBoardMask::CopyFrom(const FSGBoardMask& Other)
+{
+	if (NumBits != Other.NumBits)
+	{
+		Init(Other.NumBits);
+	}
+	for (int32 i = 0; i < Words.Num(); i++)
+	{
+		Words[i] = Other.Words[i];
+	}
+}
+
+FSGBoardMask& FSGBoardMask::operator&=(const FSGBoardMask& Other)
+{
+	checkSlow(NumBits == Other.NumBits);
+	for (int32 i = 0; i < Words.Num(); i++)
+	{
+		Words[i] &= Other.Words[i];
+	}
+	return *this;
+}
+
+FSGBoardMask& FSGBoardMask::operator|=(const FSGBoardMask& Other)
+{
+	checkSlow(NumBits == Other.NumBits);
+	for (int32 i = 0; i < Words.Num(); i++)
+	{
+		Words[i] |= Other.Words[i];
+	}
+	return *this;
+}
+
+FSGBoardMask& FSGBoardMask::operator^=(const FSGBoardMask& Other)
+{
+	checkSlow(NumBits == Other.NumBits);
+	for (int32 i = 0; i < Words.Num(); i++)
+	{
+		Words[i] ^= Other.Words[i];
+	}
+	return *this;
+}
+
+void FSGBoardMask::MaskLastWord()
+{
+	const int32 UsedBitsInLastWord = NumBits & 63;
+	if (Words.Num() > 0 && UsedBitsInLastWord != 0)
+	{
+		Words.Last() &= (uint64(1) << UsedBitsInLastWord) - 1;
+	}
+}
+
+FSGBitBoard::FSGBitBoard()
+{
+	GridWidth = 0;
+	GridHeight = 0;
+	Geometry = nullptr;
+}
+
+void FSGBitBoard::Init(int32 inGridWidth, int32 inGridHeight)
+{
+	checkSlow(inGridWidth > 0 && inGridHeight > 0);
+	Geometry = &FSGBoardGeometry::GetShared(inGridWidth, inGridHeight);
+	GridWidth = inGridWidth;
+	GridHeight = inGridHeight;
+
+	const int32 NumAddresses = GridWidth * GridHeight;
+	for (FSGBoardMask& TypeMask : TypeMasks)
+	{
+		TypeMask.Init(NumAddresses);
+	}
+	OccupiedMask.Init(NumAddresses);
+	EnemyMask.Init(NumAddresses);
+	CanLinkEnemyMask.Init(NumAddresses);
+	LinkedMask.Init(NumAddresses);
+
+	AddressTileTypes.Empty(NumAddresses);
+	AddressTileTypes.AddZeroed(NumAddresses);
+}
+
+void FSGBitBoard::SetTile(int32 GridAddress, ESGTileType TileType, const FSGTileAbilities& Abilities)
+{
+	checkSlow(static_cast<int32>(TileType) < static_cast<int32>(ESGTileType::ETT_MAX));
+	if (OccupiedMask.Test(GridAddress) == true)
+	{
+		// Override the old tile
+		ClearTile(GridAddress);
+	}
+
+	OccupiedMask.Set(GridAddress);
+	TypeMasks[static_cast<int32>(TileType)].Set(GridAddress);
+	EnemyMask.SetTo(GridAddress, Abilities.bEnemyTile);
+	CanLinkEnemyMask.SetTo(GridAddress, Abilities.bCanLinkEnemy);
+	AddressTileTypes[GridAddress] = TileType;
+}
+
+void FSGBitBoard::ClearTile(int32 GridAddress)
+{
+	if (OccupiedMask.Test(GridAddress) == false)
+	{
+		return;
+	}
+
+	OccupiedMask.Clear(GridAddress);
+	TypeMasks[static_cast<int32>(AddressTileTypes[GridAddress])].Clear(GridAddress);
+	EnemyMask.Clear(GridAddress);
+	CanLinkEnemyMask.Clear(GridAddress);
+	LinkedMask.Clear(GridAddress);
+}
+
+void FSGBitBoard::MoveTile(int32 FromGridAddress, int32 ToGridAddress)
+{
+	checkSlow(OccupiedMask.Test(FromGridAddress) == true);
+	checkSlow(OccupiedMask.Test(ToGridAddress) == false);
+
+	const ESGTileType TileType = AddressTileTypes[FromGridAddress];
+	const bool bEnemy = EnemyMask.Test(FromGridAddress);
+	const bool bCanLinkEnemy = CanLinkEnemyMask.Test(FromGridAddress);
+	const bool bLinked = LinkedMask.Test(FromGridAddress);
+	ClearTile(FromGridAddress);
+
+	OccupiedMask.Set(ToGridAddress);
+	TypeMasks[static_cast<int32>(TileType)].Set(ToGridAddress);
+	EnemyMask.SetTo(ToGridAddress, bEnemy);
+	CanLinkEnemyMask.SetTo(ToGridAddress, bCanLinkEnemy);
+	LinkedMask.SetTo(ToGridAddress, bLinked);
+	AddressTileTypes[ToGridAddress] = TileType;
+}
+
+void FSGBitBoard::BuildNeighborMask(int32 GridAddress, FSGBoardMask& OutMask) const
+{
+	checkSlow(GridAddress >= 0 && GridAddress < GridWidth * GridHeight);
+	Geometry->BuildNeighborMask(GridAddress, OutMask);
+}
+
+void FSGBitBoard::BuildSelectableMask(int32 HeadGridAddress, FSGBoardMask& OutMask) const
+{
+	if (HeadGridAddress == INDEX_NONE)
+	{
+		// Empty link line, every tile can be the first one
+		OutMask.CopyFrom(OccupiedMask);
+		return;
+	}
+
+	checkSlow(OccupiedMask.Test(HeadGridAddress) == true);
+	BuildNeighborMask(HeadGridAddress, OutMask);
+
+	// Same type can always link together, and the enemy link the tile which can link enemy
+	const FSGBoardMask& HeadTypeMask = TypeMasks[static_cast<int32>(AddressTileTypes[HeadGridAddress])];
+	const uint64 EnemySelector = CanLinkEnemyMask.Test(HeadGridAddress) ? ~uint64(0) : 0;
+	const uint64 CanLinkEnemySelector = EnemyMask.Test(HeadGridAddress) ? ~uint64(0) : 0;
+	for (int32 WordIndex = 0; WordIndex < OutMask.NumWords(); WordIndex++)
+	{
+		const uint64 LinkableWord = HeadTypeMask.GetWord(WordIndex)
+			| (EnemyMask.GetWord(WordIndex) & EnemySelector)
+			| (CanLinkEnemyMask.GetWord(WordIndex) & CanLinkEnemySelector);
+		OutMask.SetWord(WordIndex, OutMask.GetWord(WordIndex) & LinkableWord);
+	}
+}
+
+uint32 FSGBitBoard::GetChecksum() const
+{
+	uint32 Checksum = 0;
+	for (int32 GridAddress = 0; GridAddress < AddressTileTypes.Num(); GridAddress++)
+	{
+		// Zero for the empty address, the stale type on it doesn't count
+		const uint8 AddressValue = OccupiedMask.Test(GridAddress) ? static_cast<uint8>(AddressTileTypes[GridAddress]) + 1 : 0;
+		Checksum = FCrc::MemCrc32(&AddressValue, sizeof(AddressValue), Checksum);
+	}
+	return Checksum;
+}
+
+bool FSGBitBoard::CanLinkAddresses(int32 HeadGridAddress, int32 TestGridAddress) const
+{
+	if (OccupiedMask.Test(TestGridAddress) == false)
+	{
+		return false;
+	}
+
+	if (HeadGridAddress == INDEX_NONE)
+	{
+		return true;
+	}
+
+	// Only the 8 direction neighbors can be linked
+	if (Geometry->AreNeighbors(HeadGridAddress, TestGridAddress) == false)
+	{
+		return false;
+	}
+
+	if (AddressTileTypes[HeadGridAddress] == AddressTileTypes[TestGridAddress])
+	{
+		return true;
+	}
+
+	return (CanLinkEnemyMask.Test(HeadGridAddress) && EnemyMask.Test(TestGridAddress)) ||
+		(EnemyMask.Test(HeadGridAddress) && CanLinkEnemyMask.Test(TestGridAddress));
+}
@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SGame.h"
+#include "SGTileStructs.h"
+
+/**
+ * A packed bit mask with one bit per grid address.
+ * Boards up to 64 tiles fit in a single inline word, bigger boards use more words.
+ */
+struct SGAME_API FSGBoardMask
+{
+public:
+	FSGBoardMask() : NumBits(0) {}
+	explicit FSGBoardMask(int32 inNumBits) { Init(inNumBits); }
+
+	/** Resize the mask to hold the bits, all the bits are cleared */
+	void Init(int32 inNumBits);
+
+	/** Clear all the bits */
+	void Reset();
+
+	/** Set all the valid bits */
+	void SetAll();
+
+	int32 Num() const { return NumBits; }
+	int32 NumWords() const { return Words.Num(); }
+	uint64 GetWord(int32 WordIndex) const { return Words[WordIndex]; }
+
+	/** Overwrite a whole word, the caller should not set bits beyond the mask size */
+	void SetWord(int32 WordIndex, uint64 Word) { Words[WordIndex] = Word; }
+
+	void Set(int32 Address)
+	{
+		checkSlow(Address >= 0 && Address < NumBits);
+		Words[Address >> 6] |= (uint64(1) << (Address & 63));
+	}
+
+	void Clear(int32 Address)
+	{
+		checkSlow(Address >= 0 && Address < NumBits);
+		Words[Address >> 6] &= ~(uint64(1) << (Address & 63));
+	}
+
+	void SetTo(int32 Address, bool bValue)
+	{
+		bValue ? Set(Address) : Clear(Address);
+	}
+
+	bool Test(int32 Address) const
+	{
+		checkSlow(Address >= 0 && Address < NumBits);
+		return (Words[Address >> 6] & (uint64(1) << (Address & 63))) != 0;
+	}
+
+	/** Whether there is no bit set */
+	bool IsEmpty() const;
+
+	/** Count how many bits are set */
+	int32 CountBits() const;
+
+	/** Copy another mask, the mask size should be the same */
+	void CopyFrom(const FSGBoardMask& Other);
+
+	FSGBoardMask& operator&=(const FSGBoardMask& Other);
+	FSGBoardMask& operator|=(const FSGBoardMask& Other);
+	FSGBoardMask& operator^=(const FSGBoardMask& Other);
+
+	/** Call the functor with every set bit address, from low address to high address */
+	template<typename FuncType>
+	void ForEachSetBit(FuncType Func) const
+	{
+		for (int32 WordIndex = 0; WordIndex < Words.Num(); WordIndex++)
+		{
+			uint64 Word = Words[WordIndex];
+			while (Word != 0)
+			{
+				Func((WordIndex << 6) + LowestBitIndex(Word));
+
+				// Clear the lowest set bit
+				Word &= Word - 1;
+			}
+		}
+	}
+
+	/** Index of the lowest set bit, the word should not be zero */
+	static int32 LowestBitIndex(uint64 Word)
+	{
+		checkSlow(Word != 0);
+		const uint32 LowWord = static_cast<uint32>(Word);
+		if (LowWord != 0)
+		{
+			return FMath::CountTrailingZeros(LowWord);
+		}
+		return 32 + FMath::CountTrailingZeros(static_cast<uint32>(Word >> 32));
+	}
+
+private:
+	/** Clear the bits beyond NumBits in the last word */
+	void MaskLastWord();
+
+	TArray<uint64, TInlineAllocator<1>> Words;
+	int32 NumBits;
+};
+
+/**
+ * Bitboard model of the grid, kept in sync with the grid tiles.
+ * Answer the link queries with mask operations instead of walking the tile actors.
+ */
+class SGAME_API FSGBitBoard
+{
+public:
+	FSGBitBoard();
+
+	/** Initialize the empty board */
+	void Init(int32 inGridWidth, int32 inGridHeight);
+
+	/** Place a tile on the address */
+	void SetTile(int32 GridAddress, ESGTileType TileType, const FSGTileAbilities& Abilities);
+
+	/** Remove the tile on the address */
+	void ClearTile(int32 GridAddress);
+
+	/** Move the tile to another empty address */
+	void MoveTile(int32 FromGridAddress, int32 ToGridAddress);
+
+	/** Mark the address is in the link line or not */
+	void SetLinked(int32 GridAddress, bool bLinked) { LinkedMask.SetTo(GridAddress, bLinked); }
+
+	/** Clear all the linked bits */
+	void ResetLinked() { LinkedMask.Reset(); }
+
+	/**
+	* Build the mask of the addresses which can be linked after the head
+	*
+	* @param HeadGridAddress	the last address of the link line, INDEX_NONE means the link line is empty
+	* @param OutMask			the selectable mask
+	*/
+	void BuildSelectableMask(int32 HeadGridAddress, FSGBoardMask& OutMask) const;
+
+	/** Build the 8 direction neighbor mask of the address, including the address itself */
+	void BuildNeighborMask(int32 GridAddress, FSGBoardMask& OutMask) const;
+
+	/** Whether the tile on the test address can be linked after the head address */
+	bool CanLinkAddresses(int32 HeadGridAddress, int32 TestGridAddress) const;
+
+	const FSGBoardMask& GetTypeMask(ESGTileType TileType) const { return TypeMasks[static_cast<int32>(TileType)]; }
+	const FSGBoardMask& GetOccupiedMask() const { return OccupiedMask; }
+	const FSGBoardMask& GetEnemyMask() const { return EnemyMask; }
+	const FSGBoardMask& GetCanLinkEnemyMask() const { return CanLinkEnemyMask; }
+	const FSGBoardMask& GetLinkedMask() const { return LinkedMask; }
+
+	int32 GetGridWidth() const { return GridWidth; }
+	int32 GetGridHeight() const { return GridHeight; }
+
+	/** Checksum of the tile type on every address, the same boards give the same checksum on every platform */
+	uint32 GetChecksum() const;
+
+private:
+	/** Mask for every tile type */
+	FSGBoardMask TypeMasks[static_cast<int32>(ESGTileType::ETT_MAX)];
+
+	/** Address has tile on it */
+	FSGBoardMask OccupiedMask;
+
+	/** Enemy tile mask */
+	FSGBoardMask EnemyMask;
+
+	/** Tile can link enemy mask */
+	FSGBoardMask CanLinkEnemyMask;
+
+	/** Tile in the link line mask */
+	FSGBoardMask LinkedMask;
+
+	/** Tile type on every address, used to move the tile and find the head type */
+	TArray<ESGTileType> AddressTileTypes;
+
+	/** Neighbors of every address, shared by the boards of the same size */
+	const class FSGBoardGeometry* Geometry;
+
+	int32 GridWidth;
+	int32 GridHeight;
+};
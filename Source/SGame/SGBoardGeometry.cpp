@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SGame.h"
+#include "SGBoardGeometry.h"
+
+/** The board sizes of the levels and the benchmarks */
+static constexpr TSGFixedBoardGeometry<6, 6> BoardGeometry6x6;
+static constexpr TSGFixedBoardGeometry<7, 7> BoardGeometry7x7;
+static constexpr TSGFixedBoardGeometry<8, 8> BoardGeometry8x8;
+
+static_assert(BoardGeometry6x6.Rows[35] == 5 && BoardGeometry6x6.Columns[35] == 5, "The fixed board geometry should be computed by the compiler");
+static_assert(BoardGeometry6x6.NeighborAddresses[0 * FSGNeighborDirections::Num + static_cast<int32>(ESGNeighborDirection::UpRight)] == 7, "The row grows upwards");
+static_assert(BoardGeometry8x8.NeighborWords[0] == 0x303, "The corner has 3 neighbors and itself");
+
+FSGBoardGeometry::FSGBoardGeometry()
+{
+	GridWidth = 0;
+	GridHeight = 0;
+	LocationTileSize = FVector2D::ZeroVector;
+	LocationOrigin = FVector::ZeroVector;
+	for (int32 i = 0; i < 9; i++)
+	{
+		OffsetDirections[i] = ESGNeighborDirection::None;
+	}
+}
+
+void FSGBoardGeometry::Init(int32 inGridWidth, int32 inGridHeight)
+{
+	checkSlow(inGridWidth > 0 && inGridHeight > 0);
+	if (inGridWidth == GridWidth && inGridHeight == GridHeight)
+	{
+		// Already built for the size
+		return;
+	}
+	GridWidth = inGridWidth;
+	GridHeight = inGridHeight;
+
+	if (GridWidth == 6 && GridHeight == 6)
+	{
+		CopyFixedGeometry(BoardGeometry6x6);
+	}
+	else if (GridWidth == 7 && GridHeight == 7)
+	{
+		CopyFixedGeometry(BoardGeometry7x7);
+	}
+	else if (GridWidth == 8 && GridHeight == 8)
+	{
+		CopyFixedGeometry(BoardGeometry8x8);
+	}
+	else
+	{
+		BuildGeometry();
+	}
+	InitDerivedTables();
+}
+
+template<typename FixedGeometryType>
+void FSGBoardGeometry::CopyFixedGeometry(const FixedGeometryType& inFixedGeometry)
+{
+	const int32 AddressNum = FixedGeometryType::AddressNum;
+	Columns.SetNumUninitialized(AddressNum);
+	Rows.SetNumUninitialized(AddressNum);
+	NeighborAddresses.SetNumUninitialized(AddressNum * FSGNeighborDirections::Num);
+	FMemory::Memcpy(Columns.GetData(), inFixedGeometry.Columns, sizeof(inFixedGeometry.Columns));
+	FMemory::Memcpy(Rows.GetData(), inFixedGeometry.Rows, sizeof(inFixedGeometry.Rows));
+	FMemory::Memcpy(NeighborAddresses.GetData(), inFixedGeometry.NeighborAddresses, sizeof(inFixedGeometry.NeighborAddresses));
+
+	NeighborWords.SetNumUninitialized(AddressNum);
+	FMemory::Memcpy(NeighborWords.GetData(), inFixedGeometry.NeighborWords, sizeof(inFixedGeometry.NeighborWords));
+}
+
+void FSGBoardGeometry::BuildGeometry()
+{
+	const int32 AddressNum = GridWidth * GridHeight;
+	Columns.SetNumUninitialized(AddressNum);
+	Rows.SetNumUninitialized(AddressNum);
+	NeighborAddresses.SetNumUninitialized(AddressNum * FSGNeighborDirections::Num);
+
+	// The bigger boards build the neighbor masks from the neighbor lists
+	const bool bOneWordBoard = AddressNum <= 64;
+	NeighborWords.SetNumZeroed(bOneWordBoard ? AddressNum : 0);
+	for (int32 GridAddress = 0; GridAddress < AddressNum; GridAddress++)
+	{
+		Columns[GridAddress] = GridAddress % GridWidth;
+		Rows[GridAddress] = GridAddress / GridWidth;
+		if (bOneWordBoard == true)
+		{
+			NeighborWords[GridAddress] = uint64(1) << GridAddress;
+		}
+
+		for (int32 Direction = 0; Direction < FSGNeighborDirections::Num; Direction++)
+		{
+			const int32 NeighborAddress = FSGNeighborDirections::GetNeighborAddress(GridWidth, GridHeight, GridAddress, Direction);
+			NeighborAddresses[GridAddress * FSGNeighborDirections::Num + Direction] = NeighborAddress;
+			if (bOneWordBoard == true && NeighborAddress != INDEX_NONE)
+			{
+				NeighborWords[GridAddress] |= uint64(1) << NeighborAddress;
+			}
+		}
+	}
+}
+
+const FSGBoardGeometry& FSGBoardGeometry::GetShared(int32 inGridWidth, int32 inGridHeight)
+{
+	// The boards are built from the game thread and the worker threads
+	static FCriticalSection SharedGeometryLock;
+	static TMap<FIntPoint, TUniquePtr<FSGBoardGeometry>> SharedGeometries;
+	FScopeLock Lock(&SharedGeometryLock);
+
+	TUniquePtr<FSGBoardGeometry>& Geometry = SharedGeometries.FindOrAdd(FIntPoint(inGridWidth, inGridHeight));
+	if (Geometry.IsValid() == false)
+	{
+		Geometry = MakeUnique<FSGBoardGeometry>();
+		Geometry->Init(inGridWidth, inGridHeight);
+	}
+	return *Geometry;
+}
+
+void FSGBoardGeometry::InitDerivedTables()
+{
+	TopRowStartAddresses.SetNumUninitialized(GridHeight);
+	for (int32 Row = 0; Row < GridHeight; Row++)
+	{
+		TopRowStartAddresses[Row] = (GridHeight - Row - 1) * GridWidth;
+	}
+
+	for (int32 Direction = 0; Direction < FSGNeighborDirections::Num; Direction++)
+	{
+		const int32 OffsetIndex = (FSGNeighborDirections::GetRowOffset(Direction) + 1) * 3 + FSGNeighborDirections::GetColumnOffset(Direction) + 1;
+		OffsetDirections[OffsetIndex] = static_cast<ESGNeighborDirection>(Direction);
+	}
+
+	// The locations need the tile size again
+	LocalLocations.Reset();
+}
+
+void FSGBoardGeometry::InitLocations(const FVector2D& inTileSize)
+{
+	checkSlow(inTileSize.X > 0.0f && inTileSize.Y > 0.0f);
+	checkSlow(GridWidth > 0 && GridHeight > 0);
+
+	const FVector Origin(-(GridWidth / 2.0f) * inTileSize.X + (inTileSize.X * 0.5f), 0.0f, -(GridHeight / 2.0f) * inTileSize.Y + (inTileSize.Y * 0.5f));
+	LocalLocations.SetNumUninitialized(Columns.Num());
+	for (int32 GridAddress = 0; GridAddress < Columns.Num(); GridAddress++)
+	{
+		LocalLocations[GridAddress] = Origin + FVector(inTileSize.X * Columns[GridAddress], 0.0f, inTileSize.Y * Rows[GridAddress]);
+	}
+
+	LocationTileSize = inTileSize;
+	LocationOrigin = Origin;
+}
+
+int32 FSGBoardGeometry::GetAddressFromLocalLocation(const FVector& inLocalLocation, float inHitRatio) const
+{
+	checkSlow(LocalLocations.Num() > 0);
+
+	// The location in tiles from the first tile center, the tile center is at the whole numbers
+	const float ColumnPosition = (inLocalLocation.X - LocationOrigin.X) / LocationTileSize.X;
+	const float RowPosition = (inLocalLocation.Z - LocationOrigin.Z) / LocationTileSize.Y;
+	const int32 Column = FMath::RoundToInt(ColumnPosition);
+	const int32 Row = FMath::RoundToInt(RowPosition);
+	if (static_cast<uint32>(Column) >= static_cast<uint32>(GridWidth) || static_cast<uint32>(Row) >= static_cast<uint32>(GridHeight))
+	{
+		return INDEX_NONE;
+	}
+
+	// Close enough to the tile center
+	const float HalfHitSize = FMath::Clamp(inHitRatio, 0.0f, 1.0f) * 0.5f;
+	if (FMath::Abs(ColumnPosition - Column) > HalfHitSize || FMath::Abs(RowPosition - Row) > HalfHitSize)
+	{
+		return INDEX_NONE;
+	}
+
+	return Row * GridWidth + Column;
+}
@@ -0,0 +1,250 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SGame.h"
+#include "SGBitBoard.h"
+
+/** Direction from an address to its neighbor, counter clockwise from the right, the link line angle is the direction times 45 */
+enum class ESGNeighborDirection : uint8
+{
+	Right,
+	UpRight,
+	Up,
+	UpLeft,
+	Left,
+	DownLeft,
+	Down,
+	DownRight,
+	None,			// Not a neighbor
+};
+
+/** The neighbor directions, the row grows upwards like the grid address */
+struct FSGNeighborDirections
+{
+	static constexpr int32 Num = 8;
+
+	static constexpr int32 GetColumnOffset(int32 inDirection)
+	{
+		return (inDirection == 0 || inDirection == 1 || inDirection == 7) ? 1 : ((inDirection >= 3 && inDirection <= 5) ? -1 : 0);
+	}
+
+	static constexpr int32 GetRowOffset(int32 inDirection)
+	{
+		return (inDirection >= 1 && inDirection <= 3) ? 1 : ((inDirection >= 5 && inDirection <= 7) ? -1 : 0);
+	}
+
+	/** The neighbor in the direction, INDEX_NONE if it is off the board */
+	static constexpr int32 GetNeighborAddress(int32 inGridWidth, int32 inGridHeight, int32 inGridAddress, int32 inDirection)
+	{
+		return (inGridAddress % inGridWidth + GetColumnOffset(inDirection) >= 0 && inGridAddress % inGridWidth + GetColumnOffset(inDirection) < inGridWidth &&
+			inGridAddress / inGridWidth + GetRowOffset(inDirection) >= 0 && inGridAddress / inGridWidth + GetRowOffset(inDirection) < inGridHeight) ?
+			inGridAddress + GetColumnOffset(inDirection) + GetRowOffset(inDirection) * inGridWidth : INDEX_NONE;
+	}
+};
+
+/**
+ * Address tables of a fixed board size, computed by the compiler.
+ * The board sizes of the levels are precompiled, FSGBoardGeometry copies them instead of building the tables.
+ */
+template<int32 InGridWidth, int32 InGridHeight>
+struct TSGFixedBoardGeometry
+{
+	static constexpr int32 GridWidth = InGridWidth;
+	static constexpr int32 GridHeight = InGridHeight;
+	static constexpr int32 AddressNum = InGridWidth * InGridHeight;
+	static_assert(AddressNum <= 64, "The fixed board geometry keeps the neighbor masks in one word");
+
+	int32 Columns[AddressNum];
+	int32 Rows[AddressNum];
+
+	/** Neighbor of every address in every direction, INDEX_NONE if it is off the board */
+	int32 NeighborAddresses[AddressNum * FSGNeighborDirections::Num];
+
+	/** 8 direction neighbors of every address, including the address itself */
+	uint64 NeighborWords[AddressNum];
+
+	constexpr TSGFixedBoardGeometry()
+		: Columns()
+		, Rows()
+		, NeighborAddresses()
+		, NeighborWords()
+	{
+		for (int32 GridAddress = 0; GridAddress < AddressNum; GridAddress++)
+		{
+			Columns[GridAddress] = GridAddress % InGridWidth;
+			Rows[GridAddress] = GridAddress / InGridWidth;
+			NeighborWords[GridAddress] = uint64(1) << GridAddress;
+			for (int32 Direction = 0; Direction < FSGNeighborDirections::Num; Direction++)
+			{
+				const int32 NeighborAddress = FSGNeighborDirections::GetNeighborAddress(InGridWidth, InGridHeight, GridAddress, Direction);
+				NeighborAddresses[GridAddress * FSGNeighborDirections::Num + Direction] = NeighborAddress;
+				if (NeighborAddress != INDEX_NONE)
+				{
+					NeighborWords[GridAddress] |= uint64(1) << NeighborAddress;
+				}
+			}
+		}
+	}
+};
+
+/**
+ * Geometry of the board, built once for the board size: the column and row of every address, the neighbors, and the tile locations.
+ * The grid helpers read the tables instead of dividing the address on every call.
+ */
+class SGAME_API FSGBoardGeometry
+{
+public:
+	FSGBoardGeometry();
+
+	/** Build the address tables, copied from the precompiled tables for the level board sizes */
+	void Init(int32 inGridWidth, int32 inGridHeight);
+
+	/** Build the tile locations relative to the grid center, the tiles are centered around it */
+	void InitLocations(const FVector2D& inTileSize);
+
+	/** Address tables of the board size shared by the bitboards, built on the first use, without the tile locations */
+	static const FSGBoardGeometry& GetShared(int32 inGridWidth, int32 inGridHeight);
+
+	int32 GetGridWidth() const { return GridWidth; }
+	int32 GetGridHeight() const { return GridHeight; }
+	int32 Num() const { return Columns.Num(); }
+
+	bool IsValidAddress(int32 inGridAddress) const { return Columns.IsValidIndex(inGridAddress); }
+
+	int32 GetColumn(int32 inGridAddress) const { return Columns[inGridAddress]; }
+	int32 GetRow(int32 inGridAddress) const { return Rows[inGridAddress]; }
+
+	/** Whether the column and row are on the board, false before the tables are built */
+	bool IsValidColumnRow(int32 inColumn, int32 inRow) const
+	{
+		return static_cast<uint32>(inColumn) < static_cast<uint32>(GridWidth) && static_cast<uint32>(inRow) < static_cast<uint32>(GridHeight);
+	}
+
+	/** Same as the grid, row 0 is the top row. Only for the column and row already on the board, see IsValidColumnRow */
+	int32 ColumnRowToGridAddress(int32 inColumn, int32 inRow) const
+	{
+		checkSlow(IsValidColumnRow(inColumn, inRow));
+		return TopRowStartAddresses[inRow] + inColumn;
+	}
+
+	/** The neighbor in the direction, INDEX_NONE if it is off the board */
+	int32 GetNeighborAddress(int32 inGridAddress, ESGNeighborDirection inDirection) const
+	{
+		checkSlow(inDirection != ESGNeighborDirection::None);
+		return NeighborAddresses[inGridAddress * FSGNeighborDirections::Num + static_cast<int32>(inDirection)];
+	}
+
+	/** Build the 8 direction neighbor mask of the address, including the address itself */
+	void BuildNeighborMask(int32 inGridAddress, FSGBoardMask& OutMask) const
+	{
+		if (OutMask.Num() != Num())
+		{
+			OutMask.Init(Num());
+		}
+
+		// The boards up to 64 tiles have the mask word ready
+		if (NeighborWords.Num() > 0)
+		{
+			OutMask.SetWord(0, NeighborWords[inGridAddress]);
+			return;
+		}
+
+		OutMask.Reset();
+		OutMask.Set(inGridAddress);
+		for (int32 Direction = 0; Direction < FSGNeighborDirections::Num; Direction++)
+		{
+			const int32 NeighborAddress = NeighborAddresses[inGridAddress * FSGNeighborDirections::Num + Direction];
+			if (NeighborAddress != INDEX_NONE)
+			{
+				OutMask.Set(NeighborAddress);
+			}
+		}
+	}
+
+	/** Whether the two addresses are neighbors, the same address counts as neighbor */
+	bool AreNeighbors(int32 inGridAddressA, int32 inGridAddressB) const
+	{
+		return IsValidAddress(inGridAddressA) && IsValidAddress(inGridAddressB) &&
+			(inGridAddressA == inGridAddressB || GetDirection(inGridAddressA, inGridAddressB) != ESGNeighborDirection::None);
+	}
+
+	/** Direction from the address to its neighbor, None if they are not neighbors or the same address */
+	ESGNeighborDirection GetDirection(int32 inFromGridAddress, int32 inToGridAddress) const
+	{
+		const int32 ColumnOffset = Columns[inToGridAddress] - Columns[inFromGridAddress];
+		const int32 RowOffset = Rows[inToGridAddress] - Rows[inFromGridAddress];
+		if (ColumnOffset < -1 || ColumnOffset > 1 || RowOffset < -1 || RowOffset > 1)
+		{
+			return ESGNeighborDirection::None;
+		}
+		return OffsetDirections[(RowOffset + 1) * 3 + ColumnOffset + 1];
+	}
+
+	/** The address with the column and row offset, false if it is off the board */
+	bool GetAddressWithOffset(int32 inGridAddress, int32 inColumnOffset, int32 inRowOffset, int32& OutGridAddress) const
+	{
+		const int32 Column = Columns[inGridAddress] + inColumnOffset;
+		const int32 Row = Rows[inGridAddress] + inRowOffset;
+		if (static_cast<uint32>(Column) >= static_cast<uint32>(GridWidth) || static_cast<uint32>(Row) >= static_cast<uint32>(GridHeight))
+		{
+			OutGridAddress = INDEX_NONE;
+			return false;
+		}
+		OutGridAddress = inGridAddress + inColumnOffset + inRowOffset * GridWidth;
+		return true;
+	}
+
+	/** Whether the three addresses are on one line */
+	bool IsThreePointsSameLine(int32 inGridAddress1, int32 inGridAddress2, int32 inGridAddress3) const
+	{
+		return (Rows[inGridAddress1] - Rows[inGridAddress2]) * (Columns[inGridAddress1] - Columns[inGridAddress3]) ==
+			(Rows[inGridAddress1] - Rows[inGridAddress3]) * (Columns[inGridAddress1] - Columns[inGridAddress2]);
+	}
+
+	/** Tile location relative to the grid center, only valid after InitLocations */
+	const FVector& GetLocalLocation(int32 inGridAddress) const { return LocalLocations[inGridAddress]; }
+
+	/**
+	* The address of the tile under the location, the inverse of the tile locations, only valid after InitLocations
+	*
+	* @param inLocalLocation	location relative to the grid center, the depth is ignored
+	* @param inHitRatio			part of the tile size around the tile center which hits the tile, the rest is the gap between the tiles
+	* @return INDEX_NONE if the location is off the board or in the gap
+	*/
+	int32 GetAddressFromLocalLocation(const FVector& inLocalLocation, float inHitRatio = 1.0f) const;
+
+private:
+	/** Copy the precompiled tables */
+	template<typename FixedGeometryType>
+	void CopyFixedGeometry(const FixedGeometryType& inFixedGeometry);
+
+	/** Build the tables for a board size which is not precompiled */
+	void BuildGeometry();
+
+	/** Fill the tables which don't depend on the board size */
+	void InitDerivedTables();
+
+	TArray<int32> Columns;
+	TArray<int32> Rows;
+
+	/** Address of the first column of every row, counted from the top row */
+	TArray<int32> TopRowStartAddresses;
+
+	TArray<int32> NeighborAddresses;
+
+	/** Neighbor mask word of every address, only for the boards up to 64 tiles */
+	TArray<uint64> NeighborWords;
+
+	TArray<FVector> LocalLocations;
+
+	/** Tile size and the first tile center of the tile locations */
+	FVector2D LocationTileSize;
+	FVector LocationOrigin;
+
+	/** Direction of the neighbor, indexed by (row offset + 1) * 3 + column offset + 1 */
+	ESGNeighborDirection OffsetDirections[9];
+
+	int32 GridWidth;
+	int32 GridHeight;
+};
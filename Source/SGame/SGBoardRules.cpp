@@ -0,0 +1,293 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SGame.h"
+#include "SGBoardRules.h"
+
+void FSGLinkResult::Reset()
+{
+	CollectedAddresses.Reset();
+	DamagedAddresses.Reset();
+	DamageInfos.Reset();
+	Resources.Reset();
+	Resources.AddZeroed(static_cast<int32>(ESGResourceType::ETT_MAX));
+}
+
+bool FSGBoardRules::AreAddressesNeighbors(int32 inGridWidth, int32 inGridHeight, int32 inGridAddressA, int32 inGridAddressB)
+{
+	if (inGridAddressA == inGridAddressB)
+	{
+		// Same grid address should be the neighbors
+		return true;
+	}
+
+	if ((FMath::Min(inGridAddressA, inGridAddressB) < 0) || (FMath::Max(inGridAddressA, inGridAddressB) >= (inGridWidth * inGridHeight)))
+	{
+		return false;
+	}
+
+	// The two address are neighbors only if there row and column distance less than 1
+	return FMath::Abs(inGridAddressA / inGridWidth - inGridAddressB / inGridWidth) <= 1 &&
+		FMath::Abs(inGridAddressA % inGridWidth - inGridAddressB % inGridWidth) <= 1;
+}
+
+bool FSGBoardRules::ApplyTileDamage(const FSGMessageDamageInfoArray& DamageInfos, FTileLifeArmorInfo& LifeArmorInfo)
+{
+	for (int i = 0; i < DamageInfos.Num(); i++)
+	{
+		// Calculate the piercing damage first
+		LifeArmorInfo.CurrentLife -= DamageInfos[i].InitialDamage * DamageInfos[i].PiercingArmorRatio;
+		if (LifeArmorInfo.CurrentLife < 0)
+		{
+			return true;
+		}
+
+		// Reduce the tile armor value
+		float ResultDamage = DamageInfos[i].InitialDamage * (1 - DamageInfos[i].PiercingArmorRatio);
+
+		// Currently the tile armor duracity is fix to 1 (1 armor absorb = 1 damage)
+		if (LifeArmorInfo.CurrentArmor > 0)
+		{
+			float ArmorBefore = LifeArmorInfo.CurrentArmor;
+			float ArmorAfter = ArmorBefore - ResultDamage;
+			LifeArmorInfo.CurrentArmor = FMath::Clamp(ArmorAfter, 0.0f, LifeArmorInfo.ArmorMax);
+
+			ResultDamage -= ArmorBefore;
+			if (ResultDamage < 0)
+			{
+				ResultDamage = 0;
+			}
+		}
+
+		// The damage don't absorb completely
+		if (ResultDamage > 0)
+		{
+			LifeArmorInfo.CurrentLife -= ResultDamage;
+			if (LifeArmorInfo.CurrentLife < 0)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void FSGBoardRules::BuildGreedyLinkLine(const FSGBoardState& inBoard, int32 inStartAddress, int32 inMaxLength, TArray<int32>& OutLinkAddresses)
+{
+	OutLinkAddresses.Reset();
+	if (inBoard.IsEmpty(inStartAddress) == true)
+	{
+		return;
+	}
+	OutLinkAddresses.Add(inStartAddress);
+
+	const int32 GridWidth = inBoard.GetGridWidth();
+	const int32 GridHeight = inBoard.GetGridHeight();
+	while (OutLinkAddresses.Num() < inMaxLength)
+	{
+		const int32 HeadAddress = OutLinkAddresses.Last();
+		const FSGBoardTile& HeadTile = inBoard.GetTile(HeadAddress);
+		const int32 HeadColumn = HeadAddress % GridWidth;
+		const int32 HeadRow = HeadAddress / GridWidth;
+		int32 NextAddress = INDEX_NONE;
+		for (int32 Row = FMath::Max(HeadRow - 1, 0); Row <= FMath::Min(HeadRow + 1, GridHeight - 1) && NextAddress == INDEX_NONE; Row++)
+		{
+			for (int32 Column = FMath::Max(HeadColumn - 1, 0); Column <= FMath::Min(HeadColumn + 1, GridWidth - 1); Column++)
+			{
+				const int32 TestAddress = Row * GridWidth + Column;
+				const FSGBoardTile& TestTile = inBoard.GetTile(TestAddress);
+				if (TestTile.IsEmpty() == false && OutLinkAddresses.Contains(TestAddress) == false &&
+					CanLinkTiles(HeadTile.TileType, HeadTile.Abilities, TestTile.TileType, TestTile.Abilities) == true)
+				{
+					NextAddress = TestAddress;
+					break;
+				}
+			}
+		}
+
+		if (NextAddress == INDEX_NONE)
+		{
+			break;
+		}
+		OutLinkAddresses.Add(NextAddress);
+	}
+}
+
+bool FSGBoardRules::CalculateEnemyAttackDamage(const FSGBoardState& inBoard, float& outDamageCanBeShield, float& outDamageDirectToHP)
+{
+	bool bHasEnemy = false;
+	for (int32 GridAddress = 0; GridAddress < inBoard.Num(); GridAddress++)
+	{
+		const FSGBoardTile& Tile = inBoard.GetTile(GridAddress);
+		if (Tile.IsEmpty() == false && Tile.Abilities.bEnemyTile == true)
+		{
+			AddEnemyAttackDamage(Tile.CauseDamageInfo, outDamageCanBeShield, outDamageDirectToHP);
+			bHasEnemy = true;
+		}
+	}
+	return bHasEnemy;
+}
+
+bool FSGBoardRules::IsValidLinkLine(const FSGBoardState& inBoard, const TArray<int32>& inLinkAddresses, int32 inMinimumLength)
+{
+	if (inLinkAddresses.Num() < inMinimumLength)
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < inLinkAddresses.Num(); i++)
+	{
+		const int32 GridAddress = inLinkAddresses[i];
+		if (inBoard.IsValidAddress(GridAddress) == false || inBoard.IsEmpty(GridAddress) == true)
+		{
+			return false;
+		}
+
+		// Every tile can only be linked once
+		for (int32 j = 0; j < i; j++)
+		{
+			if (inLinkAddresses[j] == GridAddress)
+			{
+				return false;
+			}
+		}
+
+		if (i > 0)
+		{
+			const int32 LastGridAddress = inLinkAddresses[i - 1];
+			const FSGBoardTile& LastTile = inBoard.GetTile(LastGridAddress);
+			const FSGBoardTile& TestTile = inBoard.GetTile(GridAddress);
+			if (AreAddressesNeighbors(inBoard.GetGridWidth(), inBoard.GetGridHeight(), LastGridAddress, GridAddress) == false ||
+				CanLinkTiles(LastTile.TileType, LastTile.Abilities, TestTile.TileType, TestTile.Abilities) == false)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void FSGBoardRules::ResolveLinkLine(FSGBoardState& Board, const TArray<int32>& inLinkAddresses, FSGLinkResult& OutResult)
+{
+	OutResult.Reset();
+
+	// The damage targets take the damage, the other tiles are collected
+	for (const int32 GridAddress : inLinkAddresses)
+	{
+		if (IsLinkDamageTarget(Board.GetTile(GridAddress).Abilities) == true)
+		{
+			OutResult.DamagedAddresses.Add(GridAddress);
+		}
+		else
+		{
+			OutResult.CollectedAddresses.Add(GridAddress);
+		}
+	}
+
+	if (OutResult.DamagedAddresses.Num() > 0)
+	{
+		for (const int32 GridAddress : inLinkAddresses)
+		{
+			const FSGBoardTile& Tile = Board.GetTile(GridAddress);
+			if (IsLinkDamageSource(Tile.Abilities) == true)
+			{
+				OutResult.DamageInfos.Add(Tile.CauseDamageInfo);
+			}
+		}
+
+		// The dead targets are collected after the other tiles
+		for (const int32 GridAddress : OutResult.DamagedAddresses)
+		{
+			if (ApplyTileDamage(OutResult.DamageInfos, Board.GetTile(GridAddress).LifeArmorInfo) == true)
+			{
+				OutResult.CollectedAddresses.Add(GridAddress);
+			}
+		}
+	}
+
+	for (const int32 GridAddress : OutResult.CollectedAddresses)
+	{
+		AddTileResources(Board.GetTile(GridAddress).Resources, OutResult.Resources);
+		Board.ClearTile(GridAddress);
+	}
+}
+
+void FSGBoardRules::CondenseBoard(FSGBoardState& Board)
+{
+	// The refill counts the holes again, the nums are not needed
+	TArray<int32, TInlineAllocator<16>> ColumnRefillNums;
+
+	// The new address is always below the read address, so the tile can move inside the sweep
+	BuildCondenseMoves(Board.GetGridWidth(), Board.GetGridHeight(),
+		[&Board](int32 GridAddress) { return Board.IsEmpty(GridAddress) == false; },
+		[&Board](int32 OldGridAddress, int32 NewGridAddress) { Board.MoveTile(OldGridAddress, NewGridAddress); },
+		ColumnRefillNums);
+}
+
+void FSGBoardRules::RefillBoard(FSGBoardState& Board, const FSGAliasTable& TileTable, const TArray<FSGBoardTile>& TileArchetypes, FRandomStream& RandomStream)
+{
+	const int32 GridWidth = Board.GetGridWidth();
+	const int32 GridHeight = Board.GetGridHeight();
+	for (int32 Col = 0; Col < GridWidth; ++Col)
+	{
+		const int32 RefillNum = CountColumnRefillNum(GridWidth, GridHeight, Col, [&Board](int32 GridAddress) { return Board.IsEmpty(GridAddress) == false; });
+
+		// Same as the grid, one draw for every row from the top row
+		for (int32 Row = 0; Row < RefillNum; Row++)
+		{
+			const int32 TileTypeID = TileTable.Draw(RandomStream);
+			checkSlow(TileArchetypes.IsValidIndex(TileTypeID));
+			Board.SetTile(Board.ColumnRowToGridAddress(Col, Row), TileArchetypes[TileTypeID]);
+		}
+	}
+}
+
+ESGDeadlockResolve FSGBoardRules::ResolveDeadlock(FSGBoardState& Board, int32 inMinimumLength, int32 inMaxAttemptNum, FSGLinkSolver& Solver, const FSGAliasTable& TileTable, const TArray<FSGBoardTile>& TileArchetypes, FRandomStream& RandomStream)
+{
+	Solver.BuildFromBoardState(Board);
+	if (Solver.FindLinkLine(inMinimumLength) == true)
+	{
+		return ESGDeadlockResolve::None;
+	}
+
+	for (int32 Attempt = 0; Attempt < inMaxAttemptNum; Attempt++)
+	{
+		ShuffleAddresses(Board.Num(), RandomStream, [&Board](int32 GridAddressA, int32 GridAddressB) { Swap(Board.GetTile(GridAddressA), Board.GetTile(GridAddressB)); });
+		Solver.BuildFromBoardState(Board);
+		if (Solver.FindLinkLine(inMinimumLength) == true)
+		{
+			return ESGDeadlockResolve::Reshuffled;
+		}
+	}
+
+	for (int32 Attempt = 0; Attempt < inMaxAttemptNum; Attempt++)
+	{
+		for (int32 GridAddress = 0; GridAddress < Board.Num(); GridAddress++)
+		{
+			Board.ClearTile(GridAddress);
+		}
+		RefillBoard(Board, TileTable, TileArchetypes, RandomStream);
+		Solver.BuildFromBoardState(Board);
+		if (Solver.FindLinkLine(inMinimumLength) == true)
+		{
+			return ESGDeadlockResolve::Regenerated;
+		}
+	}
+
+	return ESGDeadlockResolve::Failed;
+}
+
+bool FSGBoardRules::SimulateLink(FSGBoardState& Board, const TArray<int32>& inLinkAddresses, int32 inMinimumLength, const FSGAliasTable& TileTable, const TArray<FSGBoardTile>& TileArchetypes, FRandomStream& RandomStream, FSGLinkResult& OutResult)
+{
+	if (IsValidLinkLine(Board, inLinkAddresses, inMinimumLength) == false)
+	{
+		return false;
+	}
+
+	ResolveLinkLine(Board, inLinkAddresses, OutResult);
+
+	CondenseBoard(Board);
+	RefillBoard(Board, TileTable, TileArchetypes, RandomStream);
+	return true;
+}
@@ -0,0 +1,227 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SGame.h"
+#include "SGTileStructs.h"
+#include "SGMessagePayload.h"
+#include "SGAliasTable.h"
+#include "SGBoardState.h"
+#include "SGLinkSolver.h"
+
+/** How a board without any link line was brought back */
+enum class ESGDeadlockResolve : uint8
+{
+	None,			// The board has a link line
+	Reshuffled,		// The tiles were shuffled
+	Regenerated,	// The tiles were replaced with new ones
+	Failed,			// The tile library can't make a board with a link line
+};
+
+/** What happened to the board when the link line was resolved */
+struct SGAME_API FSGLinkResult
+{
+	/** Addresses of the collected tiles, in the collect order */
+	FSGMessageTileArray CollectedAddresses;
+
+	/** Addresses of the tiles which took the link damage */
+	FSGMessageTileArray DamagedAddresses;
+
+	/** Damage of the link line, one for every damage source tile */
+	FSGMessageDamageInfoArray DamageInfos;
+
+	/** Collected resources, using the resource type as index */
+	FSGMessageResourceArray Resources;
+
+	void Reset();
+};
+
+/**
+ * The gameplay rules of the board, without UObject dependencies.
+ * The actors call the single rules on their tiles, the board functions run the same rules on a FSGBoardState.
+ */
+struct SGAME_API FSGBoardRules
+{
+	/** Whether the two addresses are neighbors, the link is 8 directions and the same address counts as neighbor */
+	static bool AreAddressesNeighbors(int32 inGridWidth, int32 inGridHeight, int32 inGridAddressA, int32 inGridAddressB);
+
+	/** Whether the test tile can be linked after the last tile, the caller checks the neighbors */
+	static bool CanLinkTiles(ESGTileType inLastTileType, const FSGTileAbilities& inLastAbilities, ESGTileType inTestTileType, const FSGTileAbilities& inTestAbilities)
+	{
+		// Same tile type can always link together
+		if (inLastTileType == inTestTileType)
+		{
+			return true;
+		}
+
+		// Enemy links
+		return (inLastAbilities.bCanLinkEnemy == true && inTestAbilities.bEnemyTile == true) ||
+			(inLastAbilities.bEnemyTile == true && inTestAbilities.bCanLinkEnemy == true);
+	}
+
+	/** The linked tile takes the link damage instead of being collected */
+	static bool IsLinkDamageTarget(const FSGTileAbilities& inAbilities)
+	{
+		return inAbilities.bCanTakeDamage == true && inAbilities.bEnemyTile;
+	}
+
+	/** The linked tile adds its damage to the link damage */
+	static bool IsLinkDamageSource(const FSGTileAbilities& inAbilities)
+	{
+		return inAbilities.bCanCauseDamage == true && inAbilities.bEnemyTile == false;
+	}
+
+	/**
+	* Apply the damage to the life and the armor
+	*
+	* @param DamageInfos	all the damage infos caused to the tile
+	* @param LifeArmorInfo	the life and armor of the tile, reduced by the damage
+	* @return true means that the tile is dead (life reduce to 0)
+	*/
+	static bool ApplyTileDamage(const FSGMessageDamageInfoArray& DamageInfos, FTileLifeArmorInfo& LifeArmorInfo);
+
+	/** Add the attack of one enemy to the damage the player takes, the armor can block the non piercing part */
+	static void AddEnemyAttackDamage(const FTileDamageInfo& inDamageInfo, float& outDamageCanBeShield, float& outDamageDirectToHP)
+	{
+		outDamageCanBeShield += inDamageInfo.InitialDamage * (1 - inDamageInfo.PiercingArmorRatio);
+		outDamageDirectToHP += inDamageInfo.InitialDamage * (inDamageInfo.PiercingArmorRatio);
+	}
+
+	/** Add the tile resources to the sum, using the resource type as index */
+	template<typename ResourceArrayType>
+	static void AddTileResources(const ResourceArrayType& inTileResources, FSGMessageResourceArray& SumupResource)
+	{
+		for (int32 i = 0; i < inTileResources.Num(); i++)
+		{
+			SumupResource[static_cast<int32>(inTileResources[i].ResourceType)] += inTileResources[i].ResourceAmount;
+		}
+	}
+
+	/**
+	* Gravity pass, one sweep per column from bottom to top
+	*
+	* @param IsOccupied				tells whether the address has a tile
+	* @param OnMove					called with the old and the new address of every move, in the order they can be applied
+	* @param OutColumnRefillNums	how many tiles should be refilled on top of every column
+	*/
+	template<typename IsOccupiedFuncType, typename MoveFuncType, typename RefillNumArrayType>
+	static void BuildCondenseMoves(int32 inGridWidth, int32 inGridHeight, IsOccupiedFuncType IsOccupied, MoveFuncType OnMove, RefillNumArrayType& OutColumnRefillNums)
+	{
+		OutColumnRefillNums.SetNumUninitialized(inGridWidth, false);
+
+		const int32 AddressNum = inGridWidth * inGridHeight;
+		for (int32 Col = 0; Col < inGridWidth; ++Col)
+		{
+			// The lowest address is the bottom of the column, sweep up and pack the tiles down
+			int32 WriteAddress = Col;
+			for (int32 ReadAddress = Col; ReadAddress < AddressNum; ReadAddress += inGridWidth)
+			{
+				if (IsOccupied(ReadAddress) == false)
+				{
+					continue;
+				}
+
+				if (ReadAddress != WriteAddress)
+				{
+					OnMove(ReadAddress, WriteAddress);
+				}
+				WriteAddress += inGridWidth;
+			}
+
+			// The rest are the holes on top
+			OutColumnRefillNums[Col] = inGridHeight - WriteAddress / inGridWidth;
+		}
+	}
+
+	/** Empty addresses on top of the column, the refill fills them from the top row down */
+	template<typename IsOccupiedFuncType>
+	static int32 CountColumnRefillNum(int32 inGridWidth, int32 inGridHeight, int32 inColumn, IsOccupiedFuncType IsOccupied)
+	{
+		int32 RowNum = 0;
+		while (RowNum < inGridHeight && IsOccupied((inGridHeight - RowNum - 1) * inGridWidth + inColumn) == false)
+		{
+			++RowNum;
+		}
+		return RowNum;
+	}
+
+	/**
+	* Walk a link line from the start address, always taking the first linkable neighbor from the bottom left
+	*
+	* @param inBoard			the board
+	* @param inStartAddress		the first tile of the link line
+	* @param inMaxLength		stop when the link line is this long
+	* @param OutLinkAddresses	the link line, may be shorter than the minimum link length
+	*/
+	static void BuildGreedyLinkLine(const FSGBoardState& inBoard, int32 inStartAddress, int32 inMaxLength, TArray<int32>& OutLinkAddresses);
+
+	/**
+	* The attack of all the enemy tiles on the board
+	*
+	* @return false if there is no enemy on the board
+	*/
+	static bool CalculateEnemyAttackDamage(const FSGBoardState& inBoard, float& outDamageCanBeShield, float& outDamageDirectToHP);
+
+	/**
+	* Fisher-Yates shuffle of the addresses, using the integer output of the random stream so the order is the same on every platform
+	*
+	* @param inAddressNum	how many addresses
+	* @param RandomStream	the match random stream
+	* @param SwapAddresses	called to swap the tiles on two addresses
+	*/
+	template<typename SwapFuncType>
+	static void ShuffleAddresses(int32 inAddressNum, FRandomStream& RandomStream, SwapFuncType SwapAddresses)
+	{
+		for (int32 i = inAddressNum - 1; i > 0; i--)
+		{
+			const int32 j = static_cast<int32>((static_cast<uint64>(RandomStream.GetUnsignedInt()) * (i + 1)) >> 32);
+			if (i != j)
+			{
+				SwapAddresses(i, j);
+			}
+		}
+	}
+
+	/** Whether the addresses make a link line the player can collect */
+	static bool IsValidLinkLine(const FSGBoardState& inBoard, const TArray<int32>& inLinkAddresses, int32 inMinimumLength);
+
+	/**
+	* Resolve the link line like the game mode does, damage the enemies and collect the tiles
+	* The collected tiles are removed from the board, the damaged tiles keep the reduced life.
+	*
+	* @param Board			the board
+	* @param inLinkAddresses	the link line, from the first linked tile
+	* @param OutResult		what happened to the board
+	*/
+	static void ResolveLinkLine(FSGBoardState& Board, const TArray<int32>& inLinkAddresses, FSGLinkResult& OutResult);
+
+	/** Move the tiles down to fill the holes, the holes are left on top of the columns */
+	static void CondenseBoard(FSGBoardState& Board);
+
+	/**
+	* Fill the empty addresses on top of every column, in the same draw order as the grid
+	*
+	* @param Board			the board
+	* @param TileTable		the tile library table of the round
+	* @param TileArchetypes	the tile placed for every library index
+	* @param RandomStream	the match random stream
+	*/
+	static void RefillBoard(FSGBoardState& Board, const FSGAliasTable& TileTable, const TArray<FSGBoardTile>& TileArchetypes, FRandomStream& RandomStream);
+
+	/**
+	* Make sure the board has a link line, like the grid does after the refill: shuffle the tiles first, then replace them
+	*
+	* @param Board				the full board
+	* @param inMinimumLength	the shortest link line the player can collect
+	* @param inMaxAttemptNum	how many shuffles, then how many new boards to try
+	* @param Solver				the solver, reused to keep its allocations
+	*/
+	static ESGDeadlockResolve ResolveDeadlock(FSGBoardState& Board, int32 inMinimumLength, int32 inMaxAttemptNum, FSGLinkSolver& Solver, const FSGAliasTable& TileTable, const TArray<FSGBoardTile>& TileArchetypes, FRandomStream& RandomStream);
+
+	/**
+	* Run a whole player move: resolve the link line, condense, then refill
+	*
+	* @return false if the link line is not valid, the board is not changed then
+	*/
+	static bool SimulateLink(FSGBoardState& Board, const TArray<int32>& inLinkAddresses, int32 inMinimumLength, const FSGAliasTable& TileTable, const TArray<FSGBoardTile>& TileArchetypes, FRandomStream& RandomStream, FSGLinkResult& OutResult);
+};
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SGame.h"
+#include "SGBoardState.h"
+
+FSGBoardState::FSGBoardState()
+{
+	GridWidth = 0;
+	GridHeight = 0;
+}
+
+void FSGBoardState::Init(int32 inGridWidth, int32 inGridHeight)
+{
+	checkSlow(inGridWidth > 0 && inGridHeight > 0);
+	GridWidth = inGridWidth;
+	GridHeight = inGridHeight;
+
+	Tiles.Reset();
+	Tiles.SetNum(GridWidth * GridHeight);
+}
+
+void FSGBoardState::SetTile(int32 inGridAddress, const FSGBoardTile& inTile)
+{
+	checkSlow(IsValidAddress(inGridAddress));
+	Tiles[inGridAddress] = inTile;
+}
+
+void FSGBoardState::ClearTile(int32 inGridAddress)
+{
+	checkSlow(IsValidAddress(inGridAddress));
+	Tiles[inGridAddress].TileTypeID = INDEX_NONE;
+}
+
+void FSGBoardState::MoveTile(int32 inFromGridAddress, int32 inToGridAddress)
+{
+	checkSlow(IsEmpty(inFromGridAddress) == false);
+	checkSlow(IsEmpty(inToGridAddress) == true);
+
+	// Swap keeps the resource allocations on the board
+	Swap(Tiles[inFromGridAddress], Tiles[inToGridAddress]);
+}
+
+uint32 FSGBoardState::GetChecksum() const
+{
+	uint32 Checksum = 0;
+	for (int32 GridAddress = 0; GridAddress < Tiles.Num(); GridAddress++)
+	{
+		const uint8 AddressValue = Tiles[GridAddress].IsEmpty() ? 0 : static_cast<uint8>(Tiles[GridAddress].TileType) + 1;
+		Checksum = FCrc::MemCrc32(&AddressValue, sizeof(AddressValue), Checksum);
+	}
+	return Checksum;
+}
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SGame.h"
+#include "SGTileStructs.h"
+
+/** Resources of one tile, most tiles give one or two */
+typedef TArray<FTileResourceUnit, TInlineAllocator<2>> FSGTileResourceArray;
+
+/** Gameplay data of one tile on the board, without the actor. The tile manager also keeps one per library entry as the archetype of the spawned tiles */
+struct SGAME_API FSGBoardTile
+{
+	FSGBoardTile()
+		: TileTypeID(INDEX_NONE)
+		, TileType(ESGTileType::ETT_Sword)
+		, Abilities()
+		, CauseDamageInfo()
+		, LifeArmorInfo()
+	{}
+
+	/** The index in the tile library, INDEX_NONE means the address is empty */
+	int32 TileTypeID;
+
+	ESGTileType TileType;
+
+	FSGTileAbilities Abilities;
+
+	/** Only valid if the tile can cause damage */
+	FTileDamageInfo CauseDamageInfo;
+
+	/** Only valid if the tile can take damage */
+	FTileLifeArmorInfo LifeArmorInfo;
+
+	/** Resources collected from the tile */
+	FSGTileResourceArray Resources;
+
+	bool IsEmpty() const { return TileTypeID == INDEX_NONE; }
+};
+
+/**
+ * Plain data model of the grid, with no world, actor or message bus behind it.
+ * The grid actor drives the same rules on its tiles, the state lets the tools and the tests run the rules headless.
+ * Same address layout as the grid, the address 0 is the bottom left.
+ */
+class SGAME_API FSGBoardState
+{
+public:
+	FSGBoardState();
+
+	/** Initialize the empty board */
+	void Init(int32 inGridWidth, int32 inGridHeight);
+
+	int32 GetGridWidth() const { return GridWidth; }
+	int32 GetGridHeight() const { return GridHeight; }
+	int32 Num() const { return Tiles.Num(); }
+
+	/** Same as the grid, row 0 is the top row */
+	int32 ColumnRowToGridAddress(int32 inColumn, int32 inRow) const
+	{
+		checkSlow(inColumn < GridWidth && inRow < GridHeight);
+		return (GridHeight - inRow - 1) * GridWidth + inColumn;
+	}
+
+	bool IsValidAddress(int32 inGridAddress) const { return Tiles.IsValidIndex(inGridAddress); }
+
+	const FSGBoardTile& GetTile(int32 inGridAddress) const { return Tiles[inGridAddress]; }
+	FSGBoardTile& GetTile(int32 inGridAddress) { return Tiles[inGridAddress]; }
+
+	bool IsEmpty(int32 inGridAddress) const { return Tiles[inGridAddress].IsEmpty(); }
+
+	/** Place the tile on the address */
+	void SetTile(int32 inGridAddress, const FSGBoardTile& inTile);
+
+	/** Remove the tile on the address */
+	void ClearTile(int32 inGridAddress);
+
+	/** Move the tile to another empty address */
+	void MoveTile(int32 inFromGridAddress, int32 inToGridAddress);
+
+	/** Checksum of the tile type on every address, the same as FSGBitBoard::GetChecksum for the same board */
+	uint32 GetChecksum() const;
+
+private:
+	TArray<FSGBoardTile> Tiles;
+
+	int32 GridWidth;
+	int32 GridHeight;
+};
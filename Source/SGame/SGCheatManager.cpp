@@ -7,10 +7,155 @@
 #include "SGPlayerController.h"
 #include "SGGrid.h"
 #include "SGSpritePawn.h"
+#include "SGGameMode.h"
+#include "SGGlobalGameInstance.h"
+#include "MessageEndpointBuilder.h"
+
+/** Stand-in receiver of the event bus benchmark, handles the messages through the endpoint or the bus */
+class FSGEventBenchmarkReceiver
+{
+public:
+	FSGEventBenchmarkReceiver() {}
+
+	template<typename MessageType>
+	void HandleMessage(const MessageType& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+	{
+		ReceivedNum.Increment();
+	}
+
+	template<typename MessageType>
+	void HandleEvent(const MessageType& Message)
+	{
+		ReceivedNum.Increment();
+	}
+
+	FThreadSafeCounter ReceivedNum;
+
+	TSharedPtr<FMessageEndpoint, ESPMode::ThreadSafe> MessageEndpoint;
+};
+
+/** Publish the messages through the message endpoint, the messages are copied to the heap like the old game code */
+struct FSGEndpointBenchmarkSender
+{
+	template<typename MessageType>
+	void Publish(const MessageType& Message)
+	{
+		Endpoint->Publish(new MessageType(Message), EMessageScope::Process);
+	}
+
+	template<typename MessageType>
+	void Send(const MessageType& Message, FSGEventBenchmarkReceiver* Receiver)
+	{
+		Endpoint->Send(new MessageType(Message), Receiver->MessageEndpoint->GetAddress());
+	}
+
+	TSharedPtr<FMessageEndpoint, ESPMode::ThreadSafe> Endpoint;
+};
+
+/** Publish the messages through the gameplay event bus */
+struct FSGEventBusBenchmarkSender
+{
+	template<typename MessageType>
+	void Publish(const MessageType& Message)
+	{
+		EventBus->Publish(Message);
+	}
+
+	template<typename MessageType>
+	void Send(const MessageType& Message, FSGEventBenchmarkReceiver* Receiver)
+	{
+		EventBus->Send(Message, Receiver);
+	}
+
+	FSGGameplayEventBus* EventBus;
+};
+
+/**
+* Send the messages of one round, from the round begin to the round end
+*
+* @param Sender				the endpoint or the event bus sender
+* @param TileReceivers		receivers standing for the grid tiles
+* @param GridWidth			the link line length and the collected tile number
+* @return the number of deliveries the receivers should get
+*/
+template<typename SenderType>
+static int32 SendBenchmarkRoundMessages(SenderType& Sender, const TArray<FSGEventBenchmarkReceiver*>& TileReceivers, int32 GridWidth)
+{
+	const int32 TileNum = TileReceivers.Num();
+	int32 DeliveryNum = 0;
+
+	// Stage changes before the player input, handled by the game mode
+	FMessage_Gameplay_GameStatusUpdate GameStatusUpdateMesssage;
+	GameStatusUpdateMesssage.NewGameStatus = ESGGameStatus::EGS_PlayerTurnBegin;
+	for (int32 i = 0; i < 4; i++)
+	{
+		Sender.Publish(GameStatusUpdateMesssage);
+		DeliveryNum++;
+	}
+
+	// The player drags the link line, every step changes the status of the neighbors around the head
+	FMessage_Gameplay_TileStatusChange StatusMessage;
+	StatusMessage.TileID = 0;
+	StatusMessage.bSelectableChanged = true;
+	StatusMessage.NewSelectableStatus = true;
+	StatusMessage.bLinkedChanged = true;
+	StatusMessage.NewLinkStatus = true;
+	for (int32 Step = 0; Step < GridWidth; Step++)
+	{
+		for (int32 i = 0; i < 9; i++)
+		{
+			Sender.Send(StatusMessage, TileReceivers[(Step * GridWidth + i) % TileNum]);
+			DeliveryNum++;
+		}
+	}
+
+	// Collect the link line, the game mode handles the collect and every tile and the grid check the collect list
+	Sender.Publish(FMessage_Gameplay_CollectLinkLine());
+	DeliveryNum++;
+	FMessage_Gameplay_LinkedTilesCollect CollectMessage;
+	for (int32 i = 0; i < GridWidth; i++)
+	{
+		CollectMessage.TilesAddressToCollect.Add(i);
+	}
+	Sender.Publish(CollectMessage);
+	DeliveryNum += TileNum + 1;
+
+	// Half of the tiles fall down, every falling tile reports back to the grid
+	FMessage_Gameplay_TileBeginMove BeginMoveMessage{ 0 };
+	FMessage_Gameplay_TileEndMove EndMoveMessage{ 0 };
+	for (int32 i = 0; i < TileNum / 2; i++)
+	{
+		Sender.Send(BeginMoveMessage, TileReceivers[i]);
+		Sender.Publish(EndMoveMessage);
+		DeliveryNum += 2;
+	}
+
+	// Player end input, enemy attack and round end stages
+	for (int32 i = 0; i < 3; i++)
+	{
+		Sender.Publish(GameStatusUpdateMesssage);
+		DeliveryNum++;
+	}
+	Sender.Publish(FMessage_Gameplay_EnemyBeginAttack());
+	DeliveryNum++;
+
+	return DeliveryNum;
+}
+
+/** Send one addressed message to every tile, the cost of the per tile status, move and damage messages */
+template<typename SenderType>
+static int32 SendBenchmarkAddressedMessages(SenderType& Sender, const TArray<FSGEventBenchmarkReceiver*>& TileReceivers)
+{
+	FMessage_Gameplay_TileBeginMove BeginMoveMessage{ 0 };
+	for (FSGEventBenchmarkReceiver* Receiver : TileReceivers)
+	{
+		Sender.Send(BeginMoveMessage, Receiver);
+	}
+	return TileReceivers.Num();
+}
 
 USGCheatManager::USGCheatManager()
 {
-	MessageEndpoint = FMessageEndpoint::Builder("CheatManagerMessageEP");
 }
 
 void USGCheatManager::BeginAttack()
@@ -34,10 +179,24 @@ void USGCheatManager::UseSkill(int32 inSkillIndex)
 
 void USGCheatManager::StartGame()
 {
-	if (MessageEndpoint.IsValid() == true)
+	StartMatch(FMessage_Gameplay_GameStart());
+}
+
+void USGCheatManager::StartGameWithSeed(int32 inSeed)
+{
+	FMessage_Gameplay_GameStart GameStartMessage;
+	GameStartMessage.RandomSeed = inSeed;
+	GameStartMessage.bUseFixedSeed = true;
+	StartMatch(GameStartMessage);
+}
+
+void USGCheatManager::StartMatch(const FMessage_Gameplay_GameStart& inGameStartMessage)
+{
+	FSGGameplayEventBus* EventBus = GetEventBus();
+	if (EventBus != nullptr)
 	{
 		// Test: Send game start message 		
-		MessageEndpoint->Publish(new FMessage_Gameplay_GameStart(), EMessageScope::Process);
+		EventBus->Publish(inGameStartMessage);
 	}
 
 	// Start the new round
@@ -46,33 +205,35 @@ void USGCheatManager::StartGame()
 
 void USGCheatManager::NewRound()
 {
-	if (MessageEndpoint.IsValid() == true)
+	FSGGameplayEventBus* EventBus = GetEventBus();
+	if (EventBus != nullptr)
 	{
 		// Test: Send game start message
-		FMessage_Gameplay_GameStatusUpdate* GameStatusUpdateMesssage = new FMessage_Gameplay_GameStatusUpdate();
-		GameStatusUpdateMesssage->NewGameStatus = ESGGameStatus::EGS_RondBegin;
-		MessageEndpoint->Publish(GameStatusUpdateMesssage, EMessageScope::Process);
+		FMessage_Gameplay_GameStatusUpdate GameStatusUpdateMesssage;
+		GameStatusUpdateMesssage.NewGameStatus = ESGGameStatus::EGS_RondBegin;
+		EventBus->Publish(GameStatusUpdateMesssage);
 	}
 }
 
 void USGCheatManager::ForceCollect()
 {
-	if (MessageEndpoint.IsValid() == true)
+	FSGGameplayEventBus* EventBus = GetEventBus();
+	if (EventBus != nullptr)
 	{
 		// Test: Send game start message
-		FMessage_Gameplay_CollectLinkLine* CollectLinkLineMessage = new FMessage_Gameplay_CollectLinkLine();
-		MessageEndpoint->Publish(CollectLinkLineMessage, EMessageScope::Process);
+		EventBus->Publish(FMessage_Gameplay_CollectLinkLine());
 	}
 }
 
 void USGCheatManager::PlayerEndBuildPath()
 {
-	if (MessageEndpoint.IsValid() == true)
+	FSGGameplayEventBus* EventBus = GetEventBus();
+	if (EventBus != nullptr)
 	{
 		// Test: Send game start message
-		FMessage_Gameplay_GameStatusUpdate* GameStatusUpdateMesssage = new FMessage_Gameplay_GameStatusUpdate();
-		GameStatusUpdateMesssage->NewGameStatus = ESGGameStatus::EGS_PlayerEndBuildPath;
-		MessageEndpoint->Publish(GameStatusUpdateMesssage, EMessageScope::Process);
+		FMessage_Gameplay_GameStatusUpdate GameStatusUpdateMesssage;
+		GameStatusUpdateMesssage.NewGameStatus = ESGGameStatus::EGS_PlayerEndBuildPath;
+		EventBus->Publish(GameStatusUpdateMesssage);
 	}
 }
 
@@ -90,4 +251,714 @@ void USGCheatManager::ResetGrid()
 	{
 		((ASGGrid*)(*It))->ResetGrid();
 	}
+}
+
+void USGCheatManager::BenchmarkSelectState(int32 inIterations)
+{
+	ASGGrid* Grid = GetFilledGrid(TEXT("BenchmarkSelectState"));
+	if (Grid == nullptr)
+	{
+		return;
+	}
+
+	const TArray<ASGTileBase*>& GridTiles = Grid->GetGridTiles();
+	const int32 Iterations = inIterations > 0 ? inIterations : 1000;
+
+	// Pointer walking path, every head asks the game mode for every tile
+	int32 PointerSelectableNum = 0;
+	const double PointerStartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for (int32 HeadAddress = 0; HeadAddress < GridTiles.Num(); HeadAddress++)
+		{
+			for (int32 TestAddress = 0; TestAddress < GridTiles.Num(); TestAddress++)
+			{
+				ASGGameMode* TestGameMode = Cast<ASGGameMode>(UGameplayStatics::GetGameMode(Grid));
+				if (TestGameMode->CanLinkTiles(GridTiles[HeadAddress], GridTiles[TestAddress]) == true)
+				{
+					PointerSelectableNum++;
+				}
+			}
+		}
+	}
+	const double PointerTime = FPlatformTime::Seconds() - PointerStartTime;
+
+	// Bitboard path, one mask query per head
+	const FSGBitBoard& BitBoard = Grid->GetBitBoard();
+	FSGBoardMask SelectableMask(GridTiles.Num());
+	int32 BitBoardSelectableNum = 0;
+	const double BitBoardStartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for (int32 HeadAddress = 0; HeadAddress < GridTiles.Num(); HeadAddress++)
+		{
+			BitBoard.BuildSelectableMask(HeadAddress, SelectableMask);
+			for (int32 TestAddress = 0; TestAddress < GridTiles.Num(); TestAddress++)
+			{
+				if (SelectableMask.Test(TestAddress) == true)
+				{
+					BitBoardSelectableNum++;
+				}
+			}
+		}
+	}
+	const double BitBoardTime = FPlatformTime::Seconds() - BitBoardStartTime;
+
+	const double StepNum = static_cast<double>(Iterations) * GridTiles.Num();
+	ReportBenchmark(FString::Printf(TEXT("BenchmarkSelectState: pointer walking %.3f us/step, bitboard %.3f us/step, speed up %.1fx"),
+		PointerTime * 1000000.0 / StepNum, BitBoardTime * 1000000.0 / StepNum, PointerTime / FMath::Max(BitBoardTime, 1e-9)));
+
+	if (PointerSelectableNum != BitBoardSelectableNum)
+	{
+		ReportBenchmark(FString::Printf(TEXT("BenchmarkSelectState: result mismatch, pointer walking %d, bitboard %d"), PointerSelectableNum, BitBoardSelectableNum));
+	}
+}
+
+void USGCheatManager::BenchmarkCondense(int32 inIterations)
+{
+	ASGGrid* Grid = GetFilledGrid(TEXT("BenchmarkCondense"));
+	if (Grid == nullptr)
+	{
+		return;
+	}
+
+	const TArray<ASGTileBase*>& GridTiles = Grid->GetGridTiles();
+	const int32 GridWidth = Grid->GetGridWidth();
+	const int32 GridHeight = Grid->GetGridHeight();
+	const int32 Iterations = inIterations > 0 ? inIterations : 1000;
+
+	// Punch random holes into copies of the grid, like the collected link lines
+	const int32 PatternNum = 64;
+	FRandomStream RandomStream(PatternNum);
+	TArray<TArray<ASGTileBase*>> HolePatterns;
+	HolePatterns.SetNum(PatternNum);
+	for (TArray<ASGTileBase*>& HolePattern : HolePatterns)
+	{
+		HolePattern = GridTiles;
+		const int32 HoleNum = RandomStream.RandRange(3, FMath::Max(3, GridTiles.Num() / 3));
+		for (int32 i = 0; i < HoleNum; i++)
+		{
+			HolePattern[RandomStream.RandRange(0, GridTiles.Num() - 1)] = nullptr;
+		}
+	}
+
+	TArray<ASGTileBase*> WorkingTiles;
+	WorkingTiles.Reserve(GridTiles.Num());
+
+	// Old path, count the holes below every tile, then move with the hole map
+	int32 HoleCountingMoveNum = 0;
+	const double HoleCountingStartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		WorkingTiles = HolePatterns[Iteration % PatternNum];
+
+		TMap<int32, int32> GridHoleNumMap;
+		for (int32 columnIndex = 0; columnIndex < GridWidth; columnIndex++)
+		{
+			for (int32 rowIndex = 0; rowIndex < GridHeight; rowIndex++)
+			{
+				int32 gridAddress = Grid->ColumnRowToGridAddress(columnIndex, rowIndex);
+				if (WorkingTiles[gridAddress] == nullptr)
+				{
+					continue;
+				}
+
+				int32 currentGridHoleNum = 0;
+				for (int32 j = rowIndex + 1; j < GridHeight; j++)
+				{
+					if (WorkingTiles[Grid->ColumnRowToGridAddress(columnIndex, j)] == nullptr)
+					{
+						currentGridHoleNum++;
+					}
+				}
+
+				if (currentGridHoleNum > 0)
+				{
+					GridHoleNumMap.Add(gridAddress, currentGridHoleNum);
+				}
+			}
+		}
+
+		for (int32 columnIndex = 0; columnIndex < GridWidth; columnIndex++)
+		{
+			for (int32 rowIndex = GridHeight - 1; rowIndex >= 0; rowIndex--)
+			{
+				int32 testAddress = Grid->ColumnRowToGridAddress(columnIndex, rowIndex);
+				if (GridHoleNumMap.Find(testAddress) == nullptr)
+				{
+					continue;
+				}
+
+				int32 NewAddress = Grid->ColumnRowToGridAddress(columnIndex, rowIndex + GridHoleNumMap[testAddress]);
+				WorkingTiles[NewAddress] = WorkingTiles[testAddress];
+				WorkingTiles[testAddress] = nullptr;
+				HoleCountingMoveNum++;
+			}
+		}
+	}
+	const double HoleCountingTime = FPlatformTime::Seconds() - HoleCountingStartTime;
+
+	// New path, one sweep per column into the reused move list
+	TArray<FSGTileMove> TileMoves;
+	TArray<int32> ColumnRefillNums;
+	int32 SweepMoveNum = 0;
+	const double SweepStartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		WorkingTiles = HolePatterns[Iteration % PatternNum];
+
+		ASGGrid::BuildCondenseMoveList(WorkingTiles, GridWidth, GridHeight, TileMoves, ColumnRefillNums);
+		for (const FSGTileMove& TileMove : TileMoves)
+		{
+			WorkingTiles[TileMove.NewTileAddress] = TileMove.Tile;
+			WorkingTiles[TileMove.OldTileAddress] = nullptr;
+		}
+		SweepMoveNum += TileMoves.Num();
+	}
+	const double SweepTime = FPlatformTime::Seconds() - SweepStartTime;
+
+	ReportBenchmark(FString::Printf(TEXT("BenchmarkCondense: hole counting %.3f us/condense, one sweep %.3f us/condense, speed up %.1fx"),
+		HoleCountingTime * 1000000.0 / Iterations, SweepTime * 1000000.0 / Iterations, HoleCountingTime / FMath::Max(SweepTime, 1e-9)));
+
+	if (HoleCountingMoveNum != SweepMoveNum)
+	{
+		ReportBenchmark(FString::Printf(TEXT("BenchmarkCondense: move num mismatch, hole counting %d, one sweep %d"), HoleCountingMoveNum, SweepMoveNum));
+	}
+}
+
+void USGCheatManager::BenchmarkGridScaling(int32 inMaxGridSize)
+{
+	ASGGrid* Grid = GetFilledGrid(TEXT("BenchmarkGridScaling"));
+	if (Grid == nullptr)
+	{
+		return;
+	}
+
+	const TArray<ASGTileBase*>& LiveTiles = Grid->GetGridTiles();
+	const int32 MaxGridSize = FMath::Clamp(inMaxGridSize > 0 ? inMaxGridSize : 64, 6, 128);
+	FRandomStream RandomStream(MaxGridSize);
+
+	static const int32 GridSizes[] = { 6, 8, 16, 32, 64, 128 };
+	for (const int32 GridSize : GridSizes)
+	{
+		if (GridSize > MaxGridSize)
+		{
+			break;
+		}
+
+		// Fill the board with the live tiles, so the tile type and ability mix is the real one
+		const int32 NumAddresses = GridSize * GridSize;
+		TArray<ASGTileBase*> BoardTiles;
+		BoardTiles.SetNumUninitialized(NumAddresses);
+		FSGBitBoard BitBoard;
+		BitBoard.Init(GridSize, GridSize);
+		for (int32 Address = 0; Address < NumAddresses; Address++)
+		{
+			ASGTileBase* Tile = LiveTiles[RandomStream.RandRange(0, LiveTiles.Num() - 1)];
+			BoardTiles[Address] = Tile;
+			BitBoard.SetTile(Address, Tile->GetTileType(), Tile->GetAbilities());
+		}
+
+		// Keep roughly the same total work for every board size
+		const int32 Steps = FMath::Max(16, 200000 / NumAddresses);
+		int32 Checksum = 0;
+
+		// Select, one link step queries the selectable mask and tests every address
+		FSGBoardMask SelectableMask(NumAddresses);
+		const uint64 SelectStartCycles = FPlatformTime::Cycles64();
+		for (int32 Step = 0; Step < Steps; Step++)
+		{
+			BitBoard.BuildSelectableMask((Step * 7919) % NumAddresses, SelectableMask);
+			for (int32 Address = 0; Address < NumAddresses; Address++)
+			{
+				Checksum += SelectableMask.Test(Address) ? 1 : 0;
+			}
+		}
+		const double SelectTime = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - SelectStartCycles);
+
+		// Link, sync the linked mask with a link line as long as the board width and test every address
+		const uint64 LinkStartCycles = FPlatformTime::Cycles64();
+		for (int32 Step = 0; Step < Steps; Step++)
+		{
+			BitBoard.ResetLinked();
+			for (int32 Column = 0; Column < GridSize; Column++)
+			{
+				BitBoard.SetLinked(Column, true);
+			}
+			for (int32 Address = 0; Address < NumAddresses; Address++)
+			{
+				Checksum += BitBoard.GetLinkedMask().Test(Address) ? 1 : 0;
+			}
+		}
+		const double LinkTime = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - LinkStartCycles);
+		BitBoard.ResetLinked();
+
+		// Condense and refill, collect a link line worth of tiles, pack the columns and refill the holes
+		TArray<ASGTileBase*> WorkingTiles;
+		TArray<FSGTileMove> TileMoves;
+		TArray<int32> ColumnRefillNums;
+		uint64 CondenseCycles = 0;
+		uint64 RefillCycles = 0;
+		for (int32 Step = 0; Step < Steps; Step++)
+		{
+			WorkingTiles = BoardTiles;
+			for (int32 i = 0; i < GridSize; i++)
+			{
+				const int32 CollectAddress = RandomStream.RandRange(0, NumAddresses - 1);
+				if (WorkingTiles[CollectAddress] != nullptr)
+				{
+					WorkingTiles[CollectAddress] = nullptr;
+					BitBoard.ClearTile(CollectAddress);
+				}
+			}
+
+			const uint64 CondenseStartCycles = FPlatformTime::Cycles64();
+			ASGGrid::BuildCondenseMoveList(WorkingTiles, GridSize, GridSize, TileMoves, ColumnRefillNums);
+			for (const FSGTileMove& TileMove : TileMoves)
+			{
+				WorkingTiles[TileMove.NewTileAddress] = TileMove.Tile;
+				WorkingTiles[TileMove.OldTileAddress] = nullptr;
+				BitBoard.MoveTile(TileMove.OldTileAddress, TileMove.NewTileAddress);
+			}
+			CondenseCycles += FPlatformTime::Cycles64() - CondenseStartCycles;
+
+			const uint64 RefillStartCycles = FPlatformTime::Cycles64();
+			for (int32 Column = 0; Column < GridSize; Column++)
+			{
+				for (int32 Row = 0; Row < ColumnRefillNums[Column]; Row++)
+				{
+					const int32 RefillAddress = (GridSize - Row - 1) * GridSize + Column;
+					const ASGTileBase* Tile = LiveTiles[(Step + Row) % LiveTiles.Num()];
+					BitBoard.SetTile(RefillAddress, Tile->GetTileType(), Tile->GetAbilities());
+				}
+			}
+			RefillCycles += FPlatformTime::Cycles64() - RefillStartCycles;
+			Checksum += TileMoves.Num();
+		}
+		const double CondenseTime = FPlatformTime::ToSeconds64(CondenseCycles);
+		const double RefillTime = FPlatformTime::ToSeconds64(RefillCycles);
+
+		// Report the time per operation and per cell, the per cell cost should stay flat when it is linear
+		const double NanosecondsPerCell = 1000000000.0 / (static_cast<double>(Steps) * NumAddresses);
+		ReportBenchmark(FString::Printf(TEXT("BenchmarkGridScaling %dx%d: select %.2f ns/cell, link %.2f ns/cell, condense %.2f ns/cell, refill %.2f ns/cell (checksum %d)"),
+			GridSize, GridSize, SelectTime * NanosecondsPerCell, LinkTime * NanosecondsPerCell, CondenseTime * NanosecondsPerCell, RefillTime * NanosecondsPerCell, Checksum));
+	}
+}
+
+void USGCheatManager::BenchmarkEventBus(int32 inRounds)
+{
+	ASGGrid* Grid = GetFilledGrid(TEXT("BenchmarkEventBus"));
+	if (Grid == nullptr)
+	{
+		return;
+	}
+
+	const int32 Rounds = inRounds > 0 ? inRounds : 100;
+	const int32 GridWidth = Grid->GetGridWidth();
+	const int32 TileNum = Grid->GetGridTiles().Num();
+
+	// Stand-in receivers for the tiles, the grid and the game mode, the game mode one uses the inbox or the deferred delivery
+	TArray<FSGEventBenchmarkReceiver*> TileReceivers;
+	for (int32 i = 0; i < TileNum; i++)
+	{
+		TileReceivers.Add(new FSGEventBenchmarkReceiver());
+	}
+	FSGEventBenchmarkReceiver GridReceiver;
+	FSGEventBenchmarkReceiver GameModeReceiver;
+
+	// Endpoint path, the receivers are built like the old game code
+	for (int32 i = 0; i < TileNum; i++)
+	{
+		FSGEventBenchmarkReceiver* Receiver = TileReceivers[i];
+		Receiver->MessageEndpoint = FMessageEndpoint::Builder(*FString::Printf(TEXT("BenchmarkTile_%d"), i))
+			.Handling<FMessage_Gameplay_TileStatusChange>(Receiver, &FSGEventBenchmarkReceiver::HandleMessage<FMessage_Gameplay_TileStatusChange>)
+			.Handling<FMessage_Gameplay_LinkedTilesCollect>(Receiver, &FSGEventBenchmarkReceiver::HandleMessage<FMessage_Gameplay_LinkedTilesCollect>)
+			.Handling<FMessage_Gameplay_TileBeginMove>(Receiver, &FSGEventBenchmarkReceiver::HandleMessage<FMessage_Gameplay_TileBeginMove>);
+		Receiver->MessageEndpoint->Subscribe<FMessage_Gameplay_LinkedTilesCollect>();
+	}
+	GridReceiver.MessageEndpoint = FMessageEndpoint::Builder("BenchmarkGrid")
+		.Handling<FMessage_Gameplay_LinkedTilesCollect>(&GridReceiver, &FSGEventBenchmarkReceiver::HandleMessage<FMessage_Gameplay_LinkedTilesCollect>)
+		.Handling<FMessage_Gameplay_TileEndMove>(&GridReceiver, &FSGEventBenchmarkReceiver::HandleMessage<FMessage_Gameplay_TileEndMove>);
+	GridReceiver.MessageEndpoint->Subscribe<FMessage_Gameplay_LinkedTilesCollect>();
+	GridReceiver.MessageEndpoint->Subscribe<FMessage_Gameplay_TileEndMove>();
+	GameModeReceiver.MessageEndpoint = FMessageEndpoint::Builder("BenchmarkGameMode")
+		.Handling<FMessage_Gameplay_GameStatusUpdate>(&GameModeReceiver, &FSGEventBenchmarkReceiver::HandleMessage<FMessage_Gameplay_GameStatusUpdate>)
+		.Handling<FMessage_Gameplay_CollectLinkLine>(&GameModeReceiver, &FSGEventBenchmarkReceiver::HandleMessage<FMessage_Gameplay_CollectLinkLine>)
+		.Handling<FMessage_Gameplay_EnemyBeginAttack>(&GameModeReceiver, &FSGEventBenchmarkReceiver::HandleMessage<FMessage_Gameplay_EnemyBeginAttack>)
+		.WithInbox();
+	GameModeReceiver.MessageEndpoint->Subscribe<FMessage_Gameplay_GameStatusUpdate>();
+	GameModeReceiver.MessageEndpoint->Subscribe<FMessage_Gameplay_CollectLinkLine>();
+	GameModeReceiver.MessageEndpoint->Subscribe<FMessage_Gameplay_EnemyBeginAttack>();
+
+	FSGEndpointBenchmarkSender EndpointSender;
+	EndpointSender.Endpoint = FMessageEndpoint::Builder("BenchmarkSender");
+
+	auto GetReceivedNum = [&]()
+	{
+		int32 ReceivedNum = GridReceiver.ReceivedNum.GetValue() + GameModeReceiver.ReceivedNum.GetValue();
+		for (const FSGEventBenchmarkReceiver* Receiver : TileReceivers)
+		{
+			ReceivedNum += Receiver->ReceivedNum.GetValue();
+		}
+		return ReceivedNum;
+	};
+
+	// The messages are routed on the router thread and handled in the game thread tasks, wait until every round is delivered
+	int32 EndpointDeliveryNum = 0;
+	bool bEndpointTimeout = false;
+	const double EndpointStartTime = FPlatformTime::Seconds();
+	for (int32 Round = 0; Round < Rounds && bEndpointTimeout == false; Round++)
+	{
+		EndpointDeliveryNum += SendBenchmarkRoundMessages(EndpointSender, TileReceivers, GridWidth);
+		while (GetReceivedNum() < EndpointDeliveryNum)
+		{
+			FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+			GameModeReceiver.MessageEndpoint->ProcessInbox();
+			if (FPlatformTime::Seconds() - EndpointStartTime > 10.0)
+			{
+				bEndpointTimeout = true;
+				break;
+			}
+		}
+	}
+	const double EndpointTime = FPlatformTime::Seconds() - EndpointStartTime;
+
+	// Only the addressed sends, every tile gets one message
+	const double EndpointSendStartTime = FPlatformTime::Seconds();
+	for (int32 Round = 0; Round < Rounds && bEndpointTimeout == false; Round++)
+	{
+		EndpointDeliveryNum += SendBenchmarkAddressedMessages(EndpointSender, TileReceivers);
+		while (GetReceivedNum() < EndpointDeliveryNum)
+		{
+			FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+			if (FPlatformTime::Seconds() - EndpointSendStartTime > 10.0)
+			{
+				bEndpointTimeout = true;
+				break;
+			}
+		}
+	}
+	const double EndpointSendTime = FPlatformTime::Seconds() - EndpointSendStartTime;
+	const int32 EndpointReceivedNum = GetReceivedNum();
+
+	// Release the endpoints before the bus path, they should not get any more message
+	for (FSGEventBenchmarkReceiver* Receiver : TileReceivers)
+	{
+		Receiver->MessageEndpoint.Reset();
+		Receiver->ReceivedNum.Reset();
+	}
+	GridReceiver.MessageEndpoint.Reset();
+	GridReceiver.ReceivedNum.Reset();
+	GameModeReceiver.MessageEndpoint.Reset();
+	GameModeReceiver.ReceivedNum.Reset();
+	EndpointSender.Endpoint.Reset();
+
+	// Event bus path, a private bus so the live actors don't get the benchmark messages
+	FSGGameplayEventBus BenchmarkBus;
+	for (FSGEventBenchmarkReceiver* Receiver : TileReceivers)
+	{
+		BenchmarkBus.Subscribe<FMessage_Gameplay_TileStatusChange, FSGEventBenchmarkReceiver, &FSGEventBenchmarkReceiver::HandleEvent<FMessage_Gameplay_TileStatusChange>>(Receiver);
+		BenchmarkBus.Subscribe<FMessage_Gameplay_LinkedTilesCollect, FSGEventBenchmarkReceiver, &FSGEventBenchmarkReceiver::HandleEvent<FMessage_Gameplay_LinkedTilesCollect>>(Receiver);
+		BenchmarkBus.Subscribe<FMessage_Gameplay_TileBeginMove, FSGEventBenchmarkReceiver, &FSGEventBenchmarkReceiver::HandleEvent<FMessage_Gameplay_TileBeginMove>>(Receiver);
+	}
+	BenchmarkBus.Subscribe<FMessage_Gameplay_LinkedTilesCollect, FSGEventBenchmarkReceiver, &FSGEventBenchmarkReceiver::HandleEvent<FMessage_Gameplay_LinkedTilesCollect>>(&GridReceiver);
+	BenchmarkBus.Subscribe<FMessage_Gameplay_TileEndMove, FSGEventBenchmarkReceiver, &FSGEventBenchmarkReceiver::HandleEvent<FMessage_Gameplay_TileEndMove>>(&GridReceiver);
+	BenchmarkBus.Subscribe<FMessage_Gameplay_GameStatusUpdate, FSGEventBenchmarkReceiver, &FSGEventBenchmarkReceiver::HandleEvent<FMessage_Gameplay_GameStatusUpdate>>(&GameModeReceiver, ESGEventDelivery::Deferred);
+	BenchmarkBus.Subscribe<FMessage_Gameplay_CollectLinkLine, FSGEventBenchmarkReceiver, &FSGEventBenchmarkReceiver::HandleEvent<FMessage_Gameplay_CollectLinkLine>>(&GameModeReceiver, ESGEventDelivery::Deferred);
+	BenchmarkBus.Subscribe<FMessage_Gameplay_EnemyBeginAttack, FSGEventBenchmarkReceiver, &FSGEventBenchmarkReceiver::HandleEvent<FMessage_Gameplay_EnemyBeginAttack>>(&GameModeReceiver, ESGEventDelivery::Deferred);
+
+	FSGEventBusBenchmarkSender EventBusSender;
+	EventBusSender.EventBus = &BenchmarkBus;
+
+	int32 EventBusDeliveryNum = 0;
+	const double EventBusStartTime = FPlatformTime::Seconds();
+	for (int32 Round = 0; Round < Rounds; Round++)
+	{
+		EventBusDeliveryNum += SendBenchmarkRoundMessages(EventBusSender, TileReceivers, GridWidth);
+		BenchmarkBus.DispatchDeferredEvents();
+	}
+	const double EventBusTime = FPlatformTime::Seconds() - EventBusStartTime;
+
+	const double EventBusSendStartTime = FPlatformTime::Seconds();
+	for (int32 Round = 0; Round < Rounds; Round++)
+	{
+		EventBusDeliveryNum += SendBenchmarkAddressedMessages(EventBusSender, TileReceivers);
+	}
+	const double EventBusSendTime = FPlatformTime::Seconds() - EventBusSendStartTime;
+	const int32 EventBusReceivedNum = GetReceivedNum();
+
+	for (FSGEventBenchmarkReceiver* Receiver : TileReceivers)
+	{
+		delete Receiver;
+	}
+
+	ReportBenchmark(FString::Printf(TEXT("BenchmarkEventBus: %d rounds of %d deliveries, message endpoint %.3f ms/round, event bus %.3f ms/round, speed up %.1fx"),
+		Rounds, EventBusDeliveryNum / Rounds - TileNum, EndpointTime * 1000.0 / Rounds, EventBusTime * 1000.0 / Rounds, EndpointTime / FMath::Max(EventBusTime, 1e-9)));
+	const int32 AddressedSendNum = FMath::Max(Rounds * TileNum, 1);
+	ReportBenchmark(FString::Printf(TEXT("BenchmarkEventBus: %d addressed sends to %d tiles, message endpoint %.3f us/send, event bus %.3f us/send, speed up %.1fx"),
+		AddressedSendNum, TileNum, EndpointSendTime * 1000000.0 / AddressedSendNum, EventBusSendTime * 1000000.0 / AddressedSendNum, EndpointSendTime / FMath::Max(EventBusSendTime, 1e-9)));
+
+	if (bEndpointTimeout == true || EndpointReceivedNum != EndpointDeliveryNum || EventBusReceivedNum != EventBusDeliveryNum)
+	{
+		ReportBenchmark(FString::Printf(TEXT("BenchmarkEventBus: delivery mismatch, message endpoint %d of %d, event bus %d of %d"),
+			EndpointReceivedNum, EndpointDeliveryNum, EventBusReceivedNum, EventBusDeliveryNum));
+	}
+}
+
+void USGCheatManager::BenchmarkTileSampler(int32 inDraws)
+{
+	ASGGrid* Grid = GetFilledGrid(TEXT("BenchmarkTileSampler"));
+	if (Grid == nullptr)
+	{
+		return;
+	}
+
+	ASGLevelTileManager* TileManager = Grid->GetTileManager();
+	const TArray<FSGTileType>& TileLibrary = TileManager->TileLibrary;
+	const int32 Draws = inDraws > 0 ? inDraws : 1000000;
+	const int32 Round = FMath::Max(1, Cast<ASGGameMode>(UGameplayStatics::GetGameMode(this))->GetCurrentRound());
+	if (TileLibrary.Num() == 0)
+	{
+		ReportBenchmark(TEXT("BenchmarkTileSampler: the tile library is empty"));
+		return;
+	}
+
+	// Linear path, sum the probabilities and walk them for every draw like the old sampler
+	TArray<int32> LinearCounts;
+	LinearCounts.AddZeroed(TileLibrary.Num());
+	FRandomStream LinearStream(Draws);
+	const double LinearStartTime = FPlatformTime::Seconds();
+	for (int32 Draw = 0; Draw < Draws; Draw++)
+	{
+		float NormalizingFactor = 0;
+		for (const FSGTileType& TileType : TileLibrary)
+		{
+			NormalizingFactor += TileType.Probability;
+		}
+		const float TestNumber = LinearStream.FRandRange(0.0f, NormalizingFactor);
+		float CompareTo = 0;
+		int32 Picked = 0;
+		for (int32 i = 0; i < TileLibrary.Num(); i++)
+		{
+			CompareTo += TileLibrary[i].Probability;
+			if (TestNumber <= CompareTo)
+			{
+				Picked = i;
+				break;
+			}
+		}
+		LinearCounts[Picked]++;
+	}
+	const double LinearTime = FPlatformTime::Seconds() - LinearStartTime;
+
+	// Alias table path
+	TArray<int32> AliasCounts;
+	AliasCounts.AddZeroed(TileLibrary.Num());
+	FRandomStream AliasStream(Draws);
+	const double AliasStartTime = FPlatformTime::Seconds();
+	for (int32 Draw = 0; Draw < Draws; Draw++)
+	{
+		AliasCounts[TileManager->SelectTileFromLibrary(AliasStream, Round)]++;
+	}
+	const double AliasTime = FPlatformTime::Seconds() - AliasStartTime;
+
+	ReportBenchmark(FString::Printf(TEXT("BenchmarkTileSampler: %d draws, linear walk %.2f ns/draw, alias table %.2f ns/draw, speed up %.1fx"),
+		Draws, LinearTime * 1000000000.0 / Draws, AliasTime * 1000000000.0 / Draws, LinearTime / FMath::Max(AliasTime, 1e-9)));
+
+	// The drawn frequency should match the table probability of the round
+	const FSGAliasTable& RoundTable = TileManager->GetRoundTileTable(Round);
+	for (int32 i = 0; i < TileLibrary.Num(); i++)
+	{
+		ReportBenchmark(FString::Printf(TEXT("BenchmarkTileSampler: tile type %d, round %d probability %.4f, alias drawn %.4f, linear drawn %.4f"),
+			i, Round, RoundTable.GetProbability(i), static_cast<double>(AliasCounts[i]) / Draws, static_cast<double>(LinearCounts[i]) / Draws));
+	}
+}
+
+/** Play the moves on the board, return how many link lines were collected */
+static int32 SimulateGreedyMoves(FSGBoardState& Board, int32 inMoves, int32 inMinimumLength, const FSGAliasTable& TileTable, const TArray<FSGBoardTile>& TileArchetypes, FRandomStream& RandomStream)
+{
+	TArray<int32> LinkAddresses;
+	FSGLinkResult LinkResult;
+	int32 CollectedMoveNum = 0;
+	for (int32 Move = 0; Move < inMoves; Move++)
+	{
+		const int32 StartAddress = RandomStream.RandHelper(Board.Num());
+		FSGBoardRules::BuildGreedyLinkLine(Board, StartAddress, inMinimumLength + 2, LinkAddresses);
+		if (FSGBoardRules::SimulateLink(Board, LinkAddresses, inMinimumLength, TileTable, TileArchetypes, RandomStream, LinkResult) == true)
+		{
+			CollectedMoveNum++;
+		}
+	}
+	return CollectedMoveNum;
+}
+
+void USGCheatManager::BenchmarkBoardSimulation(int32 inMoves)
+{
+	ASGGrid* Grid = GetFilledGrid(TEXT("BenchmarkBoardSimulation"));
+	if (Grid == nullptr)
+	{
+		return;
+	}
+
+	ASGGameMode* GameMode = Cast<ASGGameMode>(UGameplayStatics::GetGameMode(this));
+	const int32 Moves = inMoves > 0 ? inMoves : 100000;
+	const int32 MinimumLength = GameMode->GetMinimumLinkLineLength();
+	const FSGAliasTable& TileTable = Grid->GetTileManager()->GetRoundTileTable(GameMode->GetCurrentRound());
+	TArray<FSGBoardTile> TileArchetypes;
+	Grid->GetTileManager()->BuildTileArchetypes(TileArchetypes);
+
+	FSGBoardState StartBoard;
+	Grid->BuildBoardState(StartBoard);
+	if (StartBoard.GetChecksum() != Grid->GetBitBoard().GetChecksum())
+	{
+		ReportBenchmark(TEXT("BenchmarkBoardSimulation: the board state doesn't match the grid"));
+	}
+
+	// Play the moves twice from the same seed, the boards should be the same
+	uint32 Checksums[2];
+	int32 CollectedMoveNum = 0;
+	double SimulationTime = 0;
+	for (int32 Run = 0; Run < 2; Run++)
+	{
+		FSGBoardState Board = StartBoard;
+		FRandomStream RandomStream(Moves);
+		const double StartTime = FPlatformTime::Seconds();
+		CollectedMoveNum = SimulateGreedyMoves(Board, Moves, MinimumLength, TileTable, TileArchetypes, RandomStream);
+		SimulationTime = FPlatformTime::Seconds() - StartTime;
+		Checksums[Run] = Board.GetChecksum();
+	}
+
+	ReportBenchmark(FString::Printf(TEXT("BenchmarkBoardSimulation: %d moves, %d collected, %.0f moves/s, %.3f us/move"),
+		Moves, CollectedMoveNum, Moves / FMath::Max(SimulationTime, 1e-9), SimulationTime * 1000000.0 / Moves));
+
+	if (Checksums[0] != Checksums[1])
+	{
+		ReportBenchmark(FString::Printf(TEXT("BenchmarkBoardSimulation: the same seed gives different boards, %08x and %08x"), Checksums[0], Checksums[1]));
+	}
+}
+
+void USGCheatManager::BenchmarkLinkSolver(int32 inMaxLength)
+{
+	ASGGrid* Grid = GetFilledGrid(TEXT("BenchmarkLinkSolver"));
+	if (Grid == nullptr)
+	{
+		return;
+	}
+
+	const int32 Iterations = 1000;
+	const int32 MaxLength = inMaxLength >= 3 ? inMaxLength : 8;
+	FSGLinkSolver Solver;
+	TArray<int32> LinkAddresses;
+	for (int32 Length = 3; Length <= MaxLength; Length++)
+	{
+		// Build and search every time, like the check after the refill
+		bool bFound = false;
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			Solver.BuildFromBitBoard(Grid->GetBitBoard());
+			bFound = Solver.FindLinkLine(Length);
+		}
+		const double SolveTime = FPlatformTime::Seconds() - StartTime;
+
+		Solver.FindLinkLine(Length, &LinkAddresses);
+		ReportBenchmark(FString::Printf(TEXT("BenchmarkLinkSolver: length %d, %s, %.2f us/check, %d search steps"),
+			Length, bFound ? TEXT("found") : TEXT("deadlocked"), SolveTime * 1000000.0 / Iterations, Solver.GetLastSearchStepNum()));
+	}
+}
+
+void USGCheatManager::BenchmarkHintSearch(int32 inMaxLength)
+{
+	ASGGrid* Grid = GetFilledGrid(TEXT("BenchmarkHintSearch"));
+	if (Grid == nullptr)
+	{
+		return;
+	}
+
+	FSGBoardState Board;
+	Grid->BuildBoardState(Board);
+	FSGHintSettings Settings;
+	Settings.MaxLength = inMaxLength >= Settings.MinimumLength ? inMaxLength : 8;
+
+	FSGHintSearch HintSearch;
+	FSGHintResult Result;
+	TArray<int32> Prefix;
+	double StartTime = FPlatformTime::Seconds();
+	HintSearch.Search(Board, Prefix, Settings, Result);
+	const double SearchTime = FPlatformTime::Seconds() - StartTime;
+	const int32 SearchStepNum = HintSearch.GetLastSearchStepNum();
+
+	// Follow the hint for one tile, like the player dragging along it
+	if (Result.LinkAddresses.Num() > 0)
+	{
+		Prefix.Add(Result.LinkAddresses[0]);
+	}
+	FSGHintResult FollowResult;
+	StartTime = FPlatformTime::Seconds();
+	HintSearch.Search(Board, Prefix, Settings, FollowResult);
+	const double FollowTime = FPlatformTime::Seconds() - StartTime;
+
+	ReportBenchmark(FString::Printf(TEXT("BenchmarkHintSearch: length %d, value %f, %d kills, %s, %.3f ms with %d steps, follow %s in %.3f ms"),
+		Result.LinkAddresses.Num(), Result.Value, Result.KillNum, Result.bComplete ? TEXT("complete") : TEXT("out of steps"), SearchTime * 1000.0, SearchStepNum,
+		HintSearch.WasLastQueryCached() ? TEXT("cached") : TEXT("searched"), FollowTime * 1000.0));
+}
+
+void USGCheatManager::DumpStageTimings()
+{
+	ASGGameMode* GameMode = Cast<ASGGameMode>(UGameplayStatics::GetGameMode(this));
+	if (GameMode == nullptr)
+	{
+		ReportBenchmark(TEXT("DumpStageTimings: no game mode"));
+		return;
+	}
+
+	const UEnum* GameStatusEnum = StaticEnum<ESGGameStatus>();
+	for (int32 StatusIndex = 0; StatusIndex <= static_cast<int32>(ESGGameStatus::EGS_GameOver); StatusIndex++)
+	{
+		const FSGGameStageTiming& StageTiming = GameMode->GetStageTiming(static_cast<ESGGameStatus>(StatusIndex));
+		if (StageTiming.EnterNum == 0)
+		{
+			continue;
+		}
+
+		ReportBenchmark(FString::Printf(TEXT("%s: entered %d times, latency avg %.3f ms max %.3f ms, execute avg %.3f ms, stage avg %.3f ms last %.3f ms"),
+			*GameStatusEnum->GetNameStringByValue(StatusIndex), StageTiming.EnterNum,
+			StageTiming.TotalLatencySeconds * 1000.0 / StageTiming.EnterNum, StageTiming.MaxLatencySeconds * 1000.0,
+			StageTiming.TotalExecuteSeconds * 1000.0 / StageTiming.EnterNum,
+			StageTiming.TotalStageSeconds * 1000.0 / StageTiming.EnterNum, StageTiming.LastStageSeconds * 1000.0));
+	}
+	ReportBenchmark(FString::Printf(TEXT("Last turn handoff %.3f ms"), GameMode->GetLastTurnHandoffSeconds() * 1000.0));
+}
+
+ASGGrid* USGCheatManager::GetFilledGrid(const TCHAR* inBenchmarkName)
+{
+	ASGGameMode* GameMode = Cast<ASGGameMode>(UGameplayStatics::GetGameMode(this));
+	ASGGrid* Grid = GameMode != nullptr ? GameMode->GetCurrentGrid() : nullptr;
+	if (Grid == nullptr)
+	{
+		ReportBenchmark(FString::Printf(TEXT("%s: no grid in the level"), inBenchmarkName));
+		return nullptr;
+	}
+
+	for (const ASGTileBase* Tile : Grid->GetGridTiles())
+	{
+		if (Tile == nullptr)
+		{
+			ReportBenchmark(FString::Printf(TEXT("%s: the grid is not filled, start the game first"), inBenchmarkName));
+			return nullptr;
+		}
+	}
+
+	return Grid;
+}
+
+void USGCheatManager::ReportBenchmark(const FString& inResult)
+{
+	UE_LOG(LogSGame, Display, TEXT("%s"), *inResult);
+	GetOuterASGPlayerController()->ClientMessage(inResult);
+}
+
+FSGGameplayEventBus* USGCheatManager::GetEventBus() const
+{
+	return USGGlobalGameInstance::GetEventBus(GetOuterASGPlayerController());
 }
\ No newline at end of file
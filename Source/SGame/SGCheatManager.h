@@ -3,7 +3,6 @@
 #pragma once
 
 #include "GameFramework/CheatManager.h"
-#include "MessageEndpoint.h"
 #include "SGameMessages.h"
 #include "SGCheatManager.generated.h"
 
@@ -29,6 +28,10 @@ public:
 	UFUNCTION(exec)
 	void StartGame();
 
+	// Start the game from the seed, the same seed and the same input give the same boards
+	UFUNCTION(exec)
+	void StartGameWithSeed(int32 inSeed);
+
 	// Manually Start the new round
 	UFUNCTION(exec)
 	void NewRound();
@@ -49,8 +52,52 @@ public:
 	UFUNCTION(exec)
 	void ResetGrid();
 
+	// Compare the bitboard selectable query against the tile pointer walking path
+	UFUNCTION(exec)
+	void BenchmarkSelectState(int32 inIterations);
+
+	// Compare the one sweep condense pass against the old hole counting condense
+	UFUNCTION(exec)
+	void BenchmarkCondense(int32 inIterations);
+
+	// Run the select, link, condense and refill paths on boards from 6x6 up to the max size, to check they scale linearly
+	UFUNCTION(exec)
+	void BenchmarkGridScaling(int32 inMaxGridSize);
+
+	// Run the messages of a full round through the message endpoints and through the gameplay event bus
+	UFUNCTION(exec)
+	void BenchmarkEventBus(int32 inRounds);
+
+	// Compare the alias table tile draw against the linear probability walk
+	UFUNCTION(exec)
+	void BenchmarkTileSampler(int32 inDraws);
+
+	// Play random link lines on a headless copy of the board, and check the same seed gives the same board
+	UFUNCTION(exec)
+	void BenchmarkBoardSimulation(int32 inMoves);
+
+	// Time the deadlock check on the current board, for the link line lengths from 3 to the max length
+	UFUNCTION(exec)
+	void BenchmarkLinkSolver(int32 inMaxLength);
+
+	// Search the most valuable link line on the current board, then query it again from the cache
+	UFUNCTION(exec)
+	void BenchmarkHintSearch(int32 inMaxLength);
+
+	// Print the recorded timings of the game status stages
+	UFUNCTION(exec)
+	void DumpStageTimings();
+
 private:
+	/** Find the grid which is filled with tiles, return null if there is not */
+	class ASGGrid* GetFilledGrid(const TCHAR* inBenchmarkName);
+
+	/** Publish the game start message and begin the first round */
+	void StartMatch(const struct FMessage_Gameplay_GameStart& inGameStartMessage);
+
+	/** Print the benchmark result to the log and the console */
+	void ReportBenchmark(const FString& inResult);
 
-	// Holds the messaging endpoint.
-	TSharedPtr<FMessageEndpoint, ESPMode::ThreadSafe> MessageEndpoint;
+	/** The gameplay event bus of the game instance */
+	class FSGGameplayEventBus* GetEventBus() const;
 };
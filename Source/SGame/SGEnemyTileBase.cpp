@@ -51,42 +51,35 @@ void ASGEnemyTileBase::Tick(float DeltaSeconds)
 	Super::Tick(DeltaSeconds);
 }
 
-void ASGEnemyTileBase::BeginPlay()
+void ASGEnemyTileBase::ActivateTile()
 {
-	Super::BeginPlay();
+	Super::ActivateTile();
 
-	// Create its own message endpoint, noted that this class may
-	// have two message endpoint, one for its parent messages and handlers, and 
-	// one for itself
-	FString EndPointName = FString::Printf(TEXT("Gameplay_Tile_%d_Enemylogic"), GridAddress);
-	MessageEndpoint = FMessageEndpoint::Builder(*EndPointName)
-		.Handling<FMessage_Gameplay_EnemyBeginAttack>(this, &ASGEnemyTileBase::HandleBeginAttack)
-		.Handling<FMessage_Gameplay_EnemyGetHit>(this, &ASGEnemyTileBase::HandlePlayHit);
-
-	if (MessageEndpoint.IsValid() == true)
+	// Subscribe the enemy logic events, the subscriptions are removed with the parent ones in DeactivateTile and EndPlay
+	FSGGameplayEventBus* EventBus = USGGlobalGameInstance::GetEventBus(this);
+	if (EventBus != nullptr)
 	{
-		// Subscribe the tile need events
-		MessageEndpoint->Subscribe<FMessage_Gameplay_EnemyBeginAttack>();
-		MessageEndpoint->Subscribe<FMessage_Gameplay_EnemyGetHit>();
+		EventBus->Subscribe<FMessage_Gameplay_EnemyBeginAttack, ASGEnemyTileBase, &ASGEnemyTileBase::HandleBeginAttack>(this);
+		EventBus->Subscribe<FMessage_Gameplay_EnemyGetHit, ASGEnemyTileBase, &ASGEnemyTileBase::HandlePlayHit>(this);
 	}
 
 	// Set the stats text
 	checkSlow(Text_HP);
-	Text_HP->SetText(FText::AsNumber(Data.LifeArmorInfo.CurrentLife));
+	Text_HP->SetText(FText::AsNumber(State.LifeArmorInfo.CurrentLife));
 	checkSlow(Text_Armor);
-	Text_Armor->SetText(FText::AsNumber(Data.LifeArmorInfo.CurrentArmor));
+	Text_Armor->SetText(FText::AsNumber(State.LifeArmorInfo.CurrentArmor));
 	checkSlow(Text_Attack);
-	Text_Attack->SetText(FText::AsNumber(Data.CauseDamageInfo.InitialDamage));
+	Text_Attack->SetText(FText::AsNumber(GetArchetype().CauseDamageInfo.InitialDamage));
 }
 
-void ASGEnemyTileBase::HandleBeginAttack(const FMessage_Gameplay_EnemyBeginAttack& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGEnemyTileBase::HandleBeginAttack(const FMessage_Gameplay_EnemyBeginAttack& Message)
 {
 	EnemyAttack();
 }
 
-void ASGEnemyTileBase::HandlePlayHit(const FMessage_Gameplay_EnemyGetHit& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGEnemyTileBase::HandlePlayHit(const FMessage_Gameplay_EnemyGetHit& Message)
 {
-	FILTER_MESSAGE;
+	checkSlow(Message.TileID == TileID);
 	BeginPlayHit();
 }
 
@@ -97,16 +90,16 @@ void ASGEnemyTileBase::BeginPlayHit()
 	// Ensure the cached message is valid
 	if (CachedDamageMessage.TileID == TileID)
 	{
-		// Do the take damage now
-		if (OnTakeTileDamage(CachedDamageMessage.DamageInfos, Data.LifeArmorInfo) == false)
+		// Show the damage result now
+		if (ApplyDamageResult(CachedDamageMessage) == false)
 		{
 			// Update the new stats
 			checkSlow(Text_HP);
-			Text_HP->SetText(FText::AsNumber(Data.LifeArmorInfo.CurrentLife));
+			Text_HP->SetText(FText::AsNumber(State.LifeArmorInfo.CurrentLife));
 			checkSlow(Text_Armor);
-			Text_Armor->SetText(FText::AsNumber(Data.LifeArmorInfo.CurrentArmor));
+			Text_Armor->SetText(FText::AsNumber(State.LifeArmorInfo.CurrentArmor));
 			checkSlow(Text_Attack);
-			Text_Attack->SetText(FText::AsNumber(Data.CauseDamageInfo.InitialDamage));
+			Text_Attack->SetText(FText::AsNumber(GetArchetype().CauseDamageInfo.InitialDamage));
 		}
 		else
 		{
@@ -23,8 +23,8 @@ public:
 	// Called every frame
 	virtual void Tick(float DeltaSeconds) override;
 
-	// Called when the game starts or when spawned
-	virtual void BeginPlay() override;
+	// Called when the tile is spawned or taken from the pool
+	virtual void ActivateTile() override;
 
 	/** Begin play hit */
 	UFUNCTION(BlueprintCallable, Category = Hit)
@@ -68,15 +68,9 @@ protected:
 	void StartPlayHitAnimation();
 
 private:
-	// Holds the messaging endpoint.
-	// Noted that this class may have two message endpoint, 
-	// one for its parent messages and handlers, and 
-	// one for itself
-	TSharedPtr<FMessageEndpoint, ESPMode::ThreadSafe> MessageEndpoint;
-
 	/** Handle begin attack message */
-	void HandleBeginAttack(const FMessage_Gameplay_EnemyBeginAttack& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleBeginAttack(const FMessage_Gameplay_EnemyBeginAttack& Message);
 
 	/** Handle play hit animation and effects */
-	void HandlePlayHit(const FMessage_Gameplay_EnemyGetHit& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandlePlayHit(const FMessage_Gameplay_EnemyGetHit& Message);
 };
@@ -4,6 +4,9 @@
 #include "SGGameMode.h"
 #include "SGPlayerController.h"
 #include "SGEnemyTileBase.h"
+#include "SGGlobalGameInstance.h"
+
+DECLARE_CYCLE_STAT(TEXT("Game Stage"), STAT_SGGameStage, STATGROUP_SGame);
 
 ASGGameMode::ASGGameMode(const FObjectInitializer& ObjectInitializer)
 {
@@ -12,9 +15,22 @@ ASGGameMode::ASGGameMode(const FObjectInitializer& ObjectInitializer)
 	DefaultPawnClass = nullptr;
 	PlayerControllerClass = ASGPlayerController::StaticClass();
 	CurrentRound = 0;
+	MatchRandomSeed = 0;
 	MinimunLengthLinkLineRequired = 3;
 	CurrentPlayerPawn = 0;
 	bShouldReplayLinkAnimation = true;
+	EventBus = nullptr;
+	CurrentGameGameStatus = ESGGameStatus::EGS_Init;
+	bRunningStageMachine = false;
+	StageTimings.SetNum(static_cast<int32>(ESGGameStatus::EGS_GameOver) + 1);
+	CurrentStageEnterCycles = 0;
+	RoundEndEnterCycles = 0;
+	LastTurnHandoffSeconds = 0;
+	bShowLinkHint = false;
+	bBotPlayer = false;
+	HintMaxLinkLength = 8;
+	HintMaxSearchStepNum = 100000;
+	bHintTaskRunning = false;
 
 	PlayerSkillManager = CreateDefaultSubobject<USGPlayerSkillManager>(TEXT("PlayerSkillManager"));
 }
@@ -23,24 +39,16 @@ void ASGGameMode::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// Create messaeng end point for game mode
-	MessageEndpoint = FMessageEndpoint::Builder("Gameplay_GameMode")
-		.Handling<FMessage_Gameplay_GameStart>(this, &ASGGameMode::HandleGameStart)
-		.Handling<FMessage_Gameplay_GameStatusUpdate>(this, &ASGGameMode::HandleGameStatusUpdate)
-		.Handling<FMessage_Gameplay_AllTileFinishMove>(this, &ASGGameMode::HandleAllTileFinishMoving)
-		.Handling<FMessage_Gameplay_EnemyBeginAttack>(this, &ASGGameMode::HandleBeginAttack)
-		.Handling<FMessage_Gameplay_CollectLinkLine>(this, &ASGGameMode::HandleCollectLinkLine)
-		.Handling<FMessage_Gameplay_NewTilePicked>(this, &ASGGameMode::HandleNewTileIsPicked)
-		.WithInbox();
-	if (MessageEndpoint.IsValid() == true)
-	{
-		// Subscribe the game mode needed messages
-		MessageEndpoint->Subscribe<FMessage_Gameplay_GameStart>();
-		MessageEndpoint->Subscribe<FMessage_Gameplay_GameStatusUpdate>();
-		MessageEndpoint->Subscribe<FMessage_Gameplay_AllTileFinishMove>();
-		MessageEndpoint->Subscribe<FMessage_Gameplay_EnemyBeginAttack>();
-		MessageEndpoint->Subscribe<FMessage_Gameplay_CollectLinkLine>();
-		MessageEndpoint->Subscribe<FMessage_Gameplay_NewTilePicked>();
+	// Subscribe the game mode needed messages, handled right away so the stage machine does not wait a frame for every stage
+	EventBus = USGGlobalGameInstance::GetEventBus(this);
+	if (EventBus != nullptr)
+	{
+		EventBus->Subscribe<FMessage_Gameplay_GameStart, ASGGameMode, &ASGGameMode::HandleGameStart>(this);
+		EventBus->Subscribe<FMessage_Gameplay_GameStatusUpdate, ASGGameMode, &ASGGameMode::HandleGameStatusUpdate>(this);
+		EventBus->Subscribe<FMessage_Gameplay_AllTileFinishMove, ASGGameMode, &ASGGameMode::HandleAllTileFinishMoving>(this);
+		EventBus->Subscribe<FMessage_Gameplay_EnemyBeginAttack, ASGGameMode, &ASGGameMode::HandleBeginAttack>(this);
+		EventBus->Subscribe<FMessage_Gameplay_CollectLinkLine, ASGGameMode, &ASGGameMode::HandleCollectLinkLine>(this);
+		EventBus->Subscribe<FMessage_Gameplay_NewTilePicked, ASGGameMode, &ASGGameMode::HandleNewTileIsPicked>(this);
 	}
 
 	// Find the grid actor in the world
@@ -60,6 +68,10 @@ void ASGGameMode::BeginPlay()
 	{
 		UE_LOG(LogSGame, Warning, TEXT("There is no grid object in the level!"));
 	}
+	else
+	{
+		CurrentGrid->SetMinimumLinkLineLength(MinimunLengthLinkLineRequired);
+	}
 
 	// Find the link line actor in the world
 	CurrentLinkLine = nullptr;
@@ -87,19 +99,14 @@ ESGGameStatus ASGGameMode::GetCurrentGameStatus()
 
 void ASGGameMode::OnBeginRound()
 {
-	UE_LOG(LogSGameProcedure, Log, TEXT("New round begin!"));
 	CurrentRound++;
+	UE_LOG(LogSGameProcedure, Log, TEXT("New round %d begin! Board checksum %08x"), CurrentRound, CurrentGrid != nullptr ? CurrentGrid->GetBitBoard().GetChecksum() : 0);
 
 	// Change the next status to new round begin
-	if (MessageEndpoint.IsValid())
-	{
-		FMessage_Gameplay_GameStatusUpdate* GameStatusUpdateMesssage = new FMessage_Gameplay_GameStatusUpdate();
-		GameStatusUpdateMesssage->NewGameStatus = ESGGameStatus::EGS_PlayerTurnBegin;
-		MessageEndpoint->Publish(GameStatusUpdateMesssage, EMessageScope::Process);
-	}
+	ChangeGameStatus(ESGGameStatus::EGS_PlayerTurnBegin);
 }
 
-void ASGGameMode::HandleCollectLinkLine(const FMessage_Gameplay_CollectLinkLine& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGGameMode::HandleCollectLinkLine(const FMessage_Gameplay_CollectLinkLine& Message)
 {
 	checkSlow(CurrentLinkLine != nullptr);
 
@@ -110,29 +117,29 @@ void ASGGameMode::HandleCollectLinkLine(const FMessage_Gameplay_CollectLinkLine&
 	}
 
 	// Post a tile disappear message
-	FMessage_Gameplay_LinkedTilesCollect* DisappearMessage = new FMessage_Gameplay_LinkedTilesCollect();
+	FMessage_Gameplay_LinkedTilesCollect DisappearMessage;
 	for (int i = 0; i < CurrentLinkLine->LinkLineTiles.Num(); i++)
 	{
 		checkSlow(CurrentLinkLine->LinkLineTiles[i]);
-		DisappearMessage->TilesAddressToCollect.Push(CurrentLinkLine->LinkLineTiles[i]->GetGridAddress());
+		DisappearMessage.TilesAddressToCollect.Push(CurrentLinkLine->LinkLineTiles[i]->GetGridAddress());
 	}
 
-	if (MessageEndpoint.IsValid() == true)
+	if (EventBus != nullptr)
 	{
-		MessageEndpoint->Publish(DisappearMessage, EMessageScope::Process);
+		EventBus->Publish(DisappearMessage);
 	}
 }
 
 bool ASGGameMode::CollectTileArray(TArray<ASGTileBase*> inTileArrayToCollect)
 {
 	// Collect resouce array, using the resource type as index
-	TArray<float> SumupResource;
+	FSGMessageResourceArray SumupResource;
 	SumupResource.AddZeroed(static_cast<int32>(ESGResourceType::ETT_MAX));
 
 	// Array of tile address should be collected, used for condense the grid
-	TArray<int32> CollectedTileAddressArray;
+	FSGMessageTileArray CollectedTileAddressArray;
 
-	// Iterate the link tiles, retrieve their resources
+	// Iterate the link tiles, retrieve their addresses
 	for (int i = 0; i < inTileArrayToCollect.Num(); i++)
 	{
 		const ASGTileBase* Tile = inTileArrayToCollect[i];
@@ -140,33 +147,29 @@ bool ASGGameMode::CollectTileArray(TArray<ASGTileBase*> inTileArrayToCollect)
 
 		// Insert into the collect tile array
 		CollectedTileAddressArray.Add(Tile->GetGridAddress());
-
-		// Collecte the resouces
-		TArray<FTileResourceUnit> TileResource = Tile->GetTileResource();
-		for (int j = 0; j < TileResource.Num(); j++)
-		{
-			// Sumup the resource
-			SumupResource[static_cast<int32>(TileResource[j].ResourceType)] += TileResource[j].ResourceAmount;
-		}
 	}
 
+	// Collecte the resouces from the grid tile store in one pass
+	checkSlow(CurrentGrid);
+	CurrentGrid->GetTileStore().SumResources(CollectedTileAddressArray, SumupResource);
+
 	if (SumupResource.Num() > 0)
 	{
-		FMessage_Gameplay_ResourceCollect* ResouceCollectMessage = new FMessage_Gameplay_ResourceCollect();
-		ResouceCollectMessage->SummupResouces = SumupResource;
+		FMessage_Gameplay_ResourceCollect ResouceCollectMessage;
+		ResouceCollectMessage.SummupResouces = SumupResource;
 
-		checkSlow(MessageEndpoint.IsValid());
-		MessageEndpoint->Publish(ResouceCollectMessage, EMessageScope::Process);
+		checkSlow(EventBus != nullptr);
+		EventBus->Publish(ResouceCollectMessage);
 	}
 
 	// Finally, sent the message indicate the tiles are collected
 	if (CollectedTileAddressArray.Num() > 0)
 	{
-		FMessage_Gameplay_LinkedTilesCollect* Message = new FMessage_Gameplay_LinkedTilesCollect();
-		Message->TilesAddressToCollect = CollectedTileAddressArray;
-		if (MessageEndpoint.IsValid() == true)
+		FMessage_Gameplay_LinkedTilesCollect Message;
+		Message.TilesAddressToCollect = CollectedTileAddressArray;
+		if (EventBus != nullptr)
 		{
-			MessageEndpoint->Publish(Message, EMessageScope::Process);
+			EventBus->Publish(Message);
 		}
 	}
 
@@ -182,12 +185,7 @@ void ASGGameMode::OnPlayerTurnBegin()
 	CurrentLinkLine->ResetLinkState();
 
 	// Change the next status to player regenerate
-	if (MessageEndpoint.IsValid())
-	{
-		FMessage_Gameplay_GameStatusUpdate* GameStatusUpdateMesssage = new FMessage_Gameplay_GameStatusUpdate();
-		GameStatusUpdateMesssage->NewGameStatus = ESGGameStatus::EGS_PlayerRegengerate;
-		MessageEndpoint->Publish(GameStatusUpdateMesssage, EMessageScope::Process);
-	}
+	ChangeGameStatus(ESGGameStatus::EGS_PlayerRegengerate);
 }
 
 void ASGGameMode::OnPlayerRegenerate()
@@ -195,12 +193,7 @@ void ASGGameMode::OnPlayerRegenerate()
 	UE_LOG(LogSGameProcedure, Log, TEXT("Player regenerate!"));
 
 	// Change the next status to player skill CD
-	if (MessageEndpoint.IsValid())
-	{
-		FMessage_Gameplay_GameStatusUpdate* GameStatusUpdateMesssage = new FMessage_Gameplay_GameStatusUpdate();
-		GameStatusUpdateMesssage->NewGameStatus = ESGGameStatus::EGS_PlayerSkillCD;
-		MessageEndpoint->Publish(GameStatusUpdateMesssage, EMessageScope::Process);
-	}
+	ChangeGameStatus(ESGGameStatus::EGS_PlayerSkillCD);
 }
 
 void ASGGameMode::OnPlayerSkillCD()
@@ -208,12 +201,7 @@ void ASGGameMode::OnPlayerSkillCD()
 	UE_LOG(LogSGameProcedure, Log, TEXT("Player skill CD!"));
 
 	// Change the next status to player begin input
-	if (MessageEndpoint.IsValid())
-	{
-		FMessage_Gameplay_GameStatusUpdate* GameStatusUpdateMesssage = new FMessage_Gameplay_GameStatusUpdate();
-		GameStatusUpdateMesssage->NewGameStatus = ESGGameStatus::EGS_PlayerBeginInput;
-		MessageEndpoint->Publish(GameStatusUpdateMesssage, EMessageScope::Process);
-	}
+	ChangeGameStatus(ESGGameStatus::EGS_PlayerBeginInput);
 }
 
 void ASGGameMode::OnPlayerBeginInputStage()
@@ -221,9 +209,9 @@ void ASGGameMode::OnPlayerBeginInputStage()
 	UE_LOG(LogSGameProcedure, Log, TEXT("Player begin input!"));
 
 	// Tell the player, he begin input now
-	if (MessageEndpoint.IsValid())
+	if (EventBus != nullptr)
 	{
-		MessageEndpoint->Publish(new FMessage_Gameplay_PlayerBeginInput(), EMessageScope::Process);
+		EventBus->Publish(FMessage_Gameplay_PlayerBeginInput());
 	}
 
 	// Reset the link line.
@@ -233,6 +221,12 @@ void ASGGameMode::OnPlayerBeginInputStage()
 	// Reset the tiles
 	checkSlow(CurrentGrid);
 	CurrentGrid->ResetTiles();
+
+	// Search the hint while the player thinks, the bot waits for it
+	if (bShowLinkHint == true || bBotPlayer == true)
+	{
+		RequestLinkHint();
+	}
 }
 
 void ASGGameMode::OnPlayerEndBuildPathStage()
@@ -243,9 +237,7 @@ void ASGGameMode::OnPlayerEndBuildPathStage()
 	if (IsLinkLineValid() == false)
 	{
 		// If not, set back the stage to player input
-		FMessage_Gameplay_GameStatusUpdate* GameStatusUpdateMesssage = new FMessage_Gameplay_GameStatusUpdate();
-		GameStatusUpdateMesssage->NewGameStatus = ESGGameStatus::EGS_PlayerBeginInput;
-		MessageEndpoint->Publish(GameStatusUpdateMesssage, EMessageScope::Process);
+		ChangeGameStatus(ESGGameStatus::EGS_PlayerBeginInput);
 		return;
 	}
 
@@ -253,23 +245,39 @@ void ASGGameMode::OnPlayerEndBuildPathStage()
 	CalculateLinkLine();
 
 	// Change the next status to player end input
-	if (MessageEndpoint.IsValid())
-	{
-		FMessage_Gameplay_GameStatusUpdate* GameStatusUpdateMesssage = new FMessage_Gameplay_GameStatusUpdate();
-		GameStatusUpdateMesssage->NewGameStatus = ESGGameStatus::EGS_PlayerEndInput;
-		MessageEndpoint->Publish(GameStatusUpdateMesssage, EMessageScope::Process);
-	}
+	ChangeGameStatus(ESGGameStatus::EGS_PlayerEndInput);
 }
 
 void ASGGameMode::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
 
-	// Need to process the inbox to make sure the callbacks function work
-	if (MessageEndpoint.IsValid())
+	// The game mode handles its events right away, this only serves the deferred subscribers
+	if (EventBus != nullptr)
+	{
+		EventBus->DispatchDeferredEvents();
+	}
+
+	PollLinkHint();
+}
+
+void ASGGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// The task uses the hint search of the game mode
+	if (HintTask.IsValid() == true)
 	{
-		MessageEndpoint->ProcessInbox();
+		HintTask->EnsureCompletion();
+		HintTask.Reset();
+		bHintTaskRunning = false;
 	}
+
+	if (EventBus != nullptr)
+	{
+		EventBus->UnsubscribeAll(this);
+		EventBus = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 bool ASGGameMode::IsLinkLineValid()
@@ -283,7 +291,7 @@ bool ASGGameMode::IsLinkLineValid()
 	return false;
 }
 
-void ASGGameMode::HandleBeginAttack(const FMessage_Gameplay_EnemyBeginAttack& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGGameMode::HandleBeginAttack(const FMessage_Gameplay_EnemyBeginAttack& Message)
 {
 	float ShiledDamage = 0;
 	float DirectDamage = 0;
@@ -293,12 +301,12 @@ void ASGGameMode::HandleBeginAttack(const FMessage_Gameplay_EnemyBeginAttack& Me
 		UE_LOG(LogSGame, Log, TEXT("Enemy will cause %f shield damage, and %f direct damage "), ShiledDamage, DirectDamage);
 
 		// Send player pawn take damage message
-		FMessage_Gameplay_PlayerTakeDamage* PlayerTakeDamageMessage = new FMessage_Gameplay_PlayerTakeDamage{ 0 };
-		PlayerTakeDamageMessage->ShiledDamage = ShiledDamage;
-		PlayerTakeDamageMessage->DirectDamage = DirectDamage;
+		FMessage_Gameplay_PlayerTakeDamage PlayerTakeDamageMessage{ 0 };
+		PlayerTakeDamageMessage.ShiledDamage = ShiledDamage;
+		PlayerTakeDamageMessage.DirectDamage = DirectDamage;
 
-		checkSlow(MessageEndpoint.IsValid());
-		MessageEndpoint->Publish(PlayerTakeDamageMessage, EMessageScope::Process);
+		checkSlow(EventBus != nullptr);
+		EventBus->Publish(PlayerTakeDamageMessage);
 
 		CurrentGrid->StartAttackFadeAnimation();
 	}
@@ -308,46 +316,17 @@ bool ASGGameMode::CalculateEnemyDamageToPlayer(float& outDamageCanBeShield, floa
 {
 	checkSlow(CurrentGrid);
 
-	// Iterate the grid to find the enemy tiles
-	TArray<FTileDamageInfo> EnemyCauseDamageInfoArray;
-	const TArray<ASGTileBase*>& GridTiles = CurrentGrid->GetGridTiles();
-	for (int i = 0; i < GridTiles.Num(); i++)
-	{
-		const ASGEnemyTileBase* EnemyTile = Cast<ASGEnemyTileBase>(GridTiles[i]);
-		if (EnemyTile != nullptr)
-		{
-			EnemyCauseDamageInfoArray.Add(EnemyTile->Data.CauseDamageInfo);
-		}
-	}
-
-	if (EnemyCauseDamageInfoArray.Num() == 0)
-	{
-		// We don't find enemy tiles, so return false, means that there is no pending attack
-		return false;
-	}
-
-	// Iterate the damage info array, calculate the final
-	for (int i = 0; i < EnemyCauseDamageInfoArray.Num(); i++)
-	{
-		outDamageCanBeShield += EnemyCauseDamageInfoArray[i].InitialDamage * (1 - EnemyCauseDamageInfoArray[i].PiercingArmorRatio);
-		outDamageDirectToHP += EnemyCauseDamageInfoArray[i].InitialDamage * (EnemyCauseDamageInfoArray[i].PiercingArmorRatio);
-	}
-
-	return true;
+	// Sum up the attack of the enemy tiles in the grid tile store, false means that there is no pending attack
+	return CurrentGrid->GetTileStore().SumEnemyAttackDamage(outDamageCanBeShield, outDamageDirectToHP);
 }
 
-TArray<FTileDamageInfo> ASGGameMode::CaculateLinkLineDamage(TArray<ASGTileBase*>& CauseDamageTiles)
+FSGMessageDamageInfoArray ASGGameMode::CaculateLinkLineDamage(const FSGMessageTileArray& CauseDamageAddresses)
 {
 	// We can do complex damage calculation here
 	// But currently, we just simply retrieve the damage info
-	TArray<FTileDamageInfo> ResultDamageInfo;
-	for (int i = 0; i < CauseDamageTiles.Num(); i++)
-	{
-		const ASGTileBase* Tile = CauseDamageTiles[i];
-		checkSlow(Tile);
-
-		ResultDamageInfo.Add(Tile->Data.CauseDamageInfo);
-	}
+	checkSlow(CurrentGrid);
+	FSGMessageDamageInfoArray ResultDamageInfo;
+	CurrentGrid->GetTileStore().BuildLinkDamageInfos(CauseDamageAddresses, ResultDamageInfo);
 
 	return ResultDamageInfo;
 }
@@ -363,7 +342,7 @@ void ASGGameMode::CalculateLinkLine()
 	{
 		checkSlow(CurrentLinkLine->LinkLineTiles[i]);
 		ASGTileBase* Tile = CurrentLinkLine->LinkLineTiles[i];
-		if (Tile->Abilities.bCanTakeDamage == true && Tile->Abilities.bEnemyTile)
+		if (FSGBoardRules::IsLinkDamageTarget(Tile->GetAbilities()) == true)
 		{
 			TakeDamageTiles.Add(Tile);
 		}
@@ -378,39 +357,54 @@ void ASGGameMode::CalculateLinkLine()
 	if (TakeDamageTiles.Num() > 0)
 	{
 		// If it contains the take damage tiles, we should calculate the damage then
-		TArray<ASGTileBase*> CauseDamageTiles;
+		FSGMessageTileArray CauseDamageAddresses;
 		for (int i = 0; i < CurrentLinkLine->LinkLineTiles.Num(); i++)
 		{
 			checkSlow(CurrentLinkLine->LinkLineTiles[i]);
 			ASGTileBase* Tile = CurrentLinkLine->LinkLineTiles[i];
-			if (Tile->Abilities.bCanCauseDamage == true && Tile->Abilities.bEnemyTile == false)
+			if (FSGBoardRules::IsLinkDamageSource(Tile->GetAbilities()) == true)
 			{
-				CauseDamageTiles.Add(Tile);
+				CauseDamageAddresses.Add(Tile->GetGridAddress());
 			}
 		}
 
 		// Calculate the linked tiles damage
-		TArray<FTileDamageInfo> DamageInfos = CaculateLinkLineDamage(CauseDamageTiles);
+		const FSGMessageDamageInfoArray DamageInfos = CaculateLinkLineDamage(CauseDamageAddresses);
 
-		// Then instigate the damage to the take damage tiles
+		// Apply the damage to all the take damage tiles in the grid tile store at once, the dead ones are in the target order
+		FSGMessageTileArray TakeDamageAddresses;
 		for (int i = 0; i < TakeDamageTiles.Num(); i++)
 		{
 			checkSlow(TakeDamageTiles[i]);
+			TakeDamageAddresses.Add(TakeDamageTiles[i]->GetGridAddress());
+		}
+		FSGMessageTileArray DeadAddresses;
+		checkSlow(CurrentGrid);
+		CurrentGrid->GetTileStore().ApplyLinkDamage(TakeDamageAddresses, DamageInfos, DeadAddresses);
+
+		// Then instigate the damage to the take damage tiles
+		int32 DeadIndex = 0;
+		for (int i = 0; i < TakeDamageTiles.Num(); i++)
+		{
 			ASGTileBase* Tile = TakeDamageTiles[i];
 
-			// Evaluate if the tile can suirve, for add the tile to collect tile array
-			if (Tile->EvaluateDamageToTile(DamageInfos) == true)
+			// The dead tile is added to collect tile array
+			const bool bDead = DeadIndex < DeadAddresses.Num() && DeadAddresses[DeadIndex] == TakeDamageAddresses[i];
+			if (bDead == true)
 			{
 				CollectedTiles.Add(Tile);
+				DeadIndex++;
 			}
 
-			// Send the harm message to the tile
-			FMessage_Gameplay_DamageToTile* Message = new FMessage_Gameplay_DamageToTile{ 0 };
-			Message->TileID = Tile->GetTileID();
-			Message->DamageInfos = DamageInfos;
-			if (MessageEndpoint.IsValid() == true)
+			// Send the damage result to the tile, the tile store has the only tile life
+			if (EventBus != nullptr)
 			{
-				MessageEndpoint->Publish(Message, EMessageScope::Process);
+				FMessage_Gameplay_DamageToTile Message;
+				Message.TileID = Tile->GetTileID();
+				Message.CurrentLife = CurrentGrid->GetTileStore().GetLife(TakeDamageAddresses[i]);
+				Message.CurrentArmor = CurrentGrid->GetTileStore().GetArmor(TakeDamageAddresses[i]);
+				Message.bDead = bDead;
+				EventBus->Send(Message, Tile);
 			}
 		}
 	}
@@ -445,29 +439,22 @@ bool ASGGameMode::CanLinkToLastTile(const ASGTileBase* inTestTile)
 
 	// Check the current tile can be linked with the last tile
 	const ASGTileBase* LastTile = CurrentLinkLine->LinkLineTiles.Last();
-	checkSlow(LastTile != nullptr);
+	return CanLinkTiles(LastTile, inTestTile);
+}
+
+bool ASGGameMode::CanLinkTiles(const ASGTileBase* inLastTile, const ASGTileBase* inTestTile) const
+{
+	checkSlow(inTestTile);
+	checkSlow(inLastTile != nullptr);
 
 	// Currently only the neighbor tiles can be selected
 	checkSlow(CurrentGrid);
-	if (CurrentGrid->AreAddressesNeighbors(inTestTile->GetGridAddress(), LastTile->GetGridAddress()) == false)
+	if (CurrentGrid->AreAddressesNeighbors(inTestTile->GetGridAddress(), inLastTile->GetGridAddress()) == false)
 	{
 		return false;
 	}
 
-	// Same tile type can always link together
-	if (LastTile->Data.TileType == inTestTile->Data.TileType)
-	{
-		return true;
-	}
-
-	// Enemy links 
-	if ((LastTile->Abilities.bCanLinkEnemy == true && inTestTile->Abilities.bEnemyTile == true) ||
-		(LastTile->Abilities.bEnemyTile == true && inTestTile->Abilities.bCanLinkEnemy == true))
-	{
-		return true;
-	}
-
-	return false;
+	return FSGBoardRules::CanLinkTiles(inLastTile->GetTileType(), inLastTile->GetAbilities(), inTestTile->GetTileType(), inTestTile->GetAbilities());
 }
 
 ASGSkillBase* ASGGameMode::CreatePlayerSkilkByName(FString inSkillName)
@@ -476,21 +463,84 @@ ASGSkillBase* ASGGameMode::CreatePlayerSkilkByName(FString inSkillName)
 	return PlayerSkillManager->CreateSkillByName(this, inSkillName);
 }
 
-void ASGGameMode::HandleGameStart(const FMessage_Gameplay_GameStart& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGGameMode::HandleGameStart(const FMessage_Gameplay_GameStart& Message)
 {
-	UE_LOG(LogSGameProcedure, Log, TEXT("Game start!"));
+	// Seed the match, log the seed so the match can be replayed
+	MatchRandomSeed = Message.bUseFixedSeed ? Message.RandomSeed : FMath::Rand();
+	MatchRandomStream.Initialize(MatchRandomSeed);
+	CurrentRound = 0;
+	UE_LOG(LogSGameProcedure, Log, TEXT("Game start! Match seed %d"), MatchRandomSeed);
 
-	// Tell the grid to initialize the grid
+	// Tell the grid to initialize the grid, the tiles left from the last match are removed first
 	checkSlow(CurrentGrid);
-	CurrentGrid->RefillGrid();
+	CurrentGrid->ResetGrid();
+	UE_LOG(LogSGameProcedure, Log, TEXT("Start board checksum %08x"), CurrentGrid->GetBitBoard().GetChecksum());
 
 	// Then add the refilled tiles to the all tiles array
 	
 }
 
-void ASGGameMode::HandleGameStatusUpdate(const FMessage_Gameplay_GameStatusUpdate& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGGameMode::HandleGameStatusUpdate(const FMessage_Gameplay_GameStatusUpdate& Message)
+{
+	ChangeGameStatus(Message.NewGameStatus);
+}
+
+void ASGGameMode::ChangeGameStatus(ESGGameStatus inNewGameStatus)
 {
-	CurrentGameGameStatus = Message.NewGameStatus;
+	FSGPendingGameStatus& PendingGameStatus = PendingGameStatuses[PendingGameStatuses.AddUninitialized()];
+	PendingGameStatus.GameStatus = inNewGameStatus;
+	PendingGameStatus.RequestCycles = FPlatformTime::Cycles64();
+
+	// Requested by a running stage, the loop below picks it up when the stage returns
+	if (bRunningStageMachine == true)
+	{
+		return;
+	}
+
+	// Run the stages until one of them waits for the animations or the input, which means it doesn't change the status
+	bRunningStageMachine = true;
+	while (PendingGameStatuses.Num() > 0)
+	{
+		const FSGPendingGameStatus NextGameStatus = PendingGameStatuses[0];
+		PendingGameStatuses.RemoveAt(0, 1, false);
+		RunGameStatusStage(NextGameStatus.GameStatus, NextGameStatus.RequestCycles);
+	}
+	bRunningStageMachine = false;
+}
+
+void ASGGameMode::RunGameStatusStage(ESGGameStatus inGameStatus, uint64 inRequestCycles)
+{
+	const uint64 EnterCycles = FPlatformTime::Cycles64();
+
+	// Close the stage we leave
+	if (CurrentStageEnterCycles != 0)
+	{
+		FSGGameStageTiming& LeftStageTiming = StageTimings[static_cast<int32>(CurrentGameGameStatus)];
+		LeftStageTiming.LastStageSeconds = FPlatformTime::ToSeconds64(EnterCycles - CurrentStageEnterCycles);
+		LeftStageTiming.TotalStageSeconds += LeftStageTiming.LastStageSeconds;
+	}
+	CurrentStageEnterCycles = EnterCycles;
+
+	// The turn handoff is from the round end to the player can input again
+	if (inGameStatus == ESGGameStatus::EGS_RoundEnd)
+	{
+		RoundEndEnterCycles = EnterCycles;
+	}
+	else if (inGameStatus == ESGGameStatus::EGS_PlayerBeginInput && RoundEndEnterCycles != 0)
+	{
+		LastTurnHandoffSeconds = FPlatformTime::ToSeconds64(EnterCycles - RoundEndEnterCycles);
+		RoundEndEnterCycles = 0;
+		UE_LOG(LogSGameProcedure, Log, TEXT("Turn handoff took %.3f ms"), LastTurnHandoffSeconds * 1000.0);
+	}
+
+	FSGGameStageTiming& StageTiming = StageTimings[static_cast<int32>(inGameStatus)];
+	const double LatencySeconds = FPlatformTime::ToSeconds64(EnterCycles - inRequestCycles);
+	StageTiming.EnterNum++;
+	StageTiming.TotalLatencySeconds += LatencySeconds;
+	StageTiming.MaxLatencySeconds = FMath::Max(StageTiming.MaxLatencySeconds, LatencySeconds);
+
+	SCOPE_CYCLE_COUNTER(STAT_SGGameStage);
+	CurrentGameGameStatus = inGameStatus;
 	switch (CurrentGameGameStatus)
 	{
 	case ESGGameStatus::EGS_RondBegin:
@@ -527,17 +577,16 @@ void ASGGameMode::HandleGameStatusUpdate(const FMessage_Gameplay_GameStatusUpdat
 		UE_LOG(LogSGameProcedure, Error, TEXT("Unhandled game status!"));
 		break;
 	}
+
+	StageTiming.TotalExecuteSeconds += FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - EnterCycles);
 }
 
-void ASGGameMode::HandleAllTileFinishMoving(const FMessage_Gameplay_AllTileFinishMove& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGGameMode::HandleAllTileFinishMoving(const FMessage_Gameplay_AllTileFinishMove& Message)
 {
 	if (CurrentGameGameStatus == ESGGameStatus::EGS_PlayerEndInput)
 	{
 		// Send to enemy attack stage
-		checkSlow(MessageEndpoint.IsValid());
-		FMessage_Gameplay_GameStatusUpdate* GameStatusUpdateMesssage = new FMessage_Gameplay_GameStatusUpdate();
-		GameStatusUpdateMesssage->NewGameStatus = ESGGameStatus::EGS_EnemyAttack;
-		MessageEndpoint->Publish(GameStatusUpdateMesssage, EMessageScope::Process);
+		ChangeGameStatus(ESGGameStatus::EGS_EnemyAttack);
 	}
 }
 
@@ -545,19 +594,17 @@ void ASGGameMode::OnEnemyAttackStage()
 {
 	UE_LOG(LogSGameProcedure, Log, TEXT("Enemy attack stage!"));
 
-	checkSlow(MessageEndpoint.IsValid());
+	checkSlow(EventBus != nullptr);
 
 	// Enemy attack stage
-	FMessage_Gameplay_EnemyBeginAttack* Message = new FMessage_Gameplay_EnemyBeginAttack();
-	MessageEndpoint->Publish(Message, EMessageScope::Process);
+	FMessage_Gameplay_EnemyBeginAttack Message;
+	EventBus->Publish(Message);
 
 	// Send next stage to round end
-	FMessage_Gameplay_GameStatusUpdate* GameStatusUpdateMesssage = new FMessage_Gameplay_GameStatusUpdate();
-	GameStatusUpdateMesssage->NewGameStatus = ESGGameStatus::EGS_RoundEnd;
-	MessageEndpoint->Publish(GameStatusUpdateMesssage, EMessageScope::Process);
+	ChangeGameStatus(ESGGameStatus::EGS_RoundEnd);
 }
 
-void ASGGameMode::HandleNewTileIsPicked(const FMessage_Gameplay_NewTilePicked& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGGameMode::HandleNewTileIsPicked(const FMessage_Gameplay_NewTilePicked& Message)
 {
 	UE_LOG(LogSGame, Log, TEXT("Player Build Path with TileID: %d"), Message.TileID);
 
@@ -586,6 +633,116 @@ void ASGGameMode::HandleNewTileIsPicked(const FMessage_Gameplay_NewTilePicked& M
 
 		// Refresh the grid state
 		CurrentGrid->RefreshGridState();
+
+		// Follow the drag, the hint cache answers the link lines already searched
+		if (bShowLinkHint == true && bBotPlayer == false)
+		{
+			RequestLinkHint();
+		}
+	}
+}
+
+void ASGGameMode::RequestLinkHint()
+{
+	// The hint is only for the player input, on a board which is not moving
+	if (CurrentGameGameStatus != ESGGameStatus::EGS_PlayerBeginInput || CurrentGrid == nullptr || CurrentGrid->IsSomeTileFalling() == true)
+	{
+		return;
+	}
+
+	// One search at a time, when the running one is done a result for a stale board or link line requests again
+	if (bHintTaskRunning == true)
+	{
+		return;
+	}
+
+	if (HintTask.IsValid() == false)
+	{
+		HintTask = MakeUnique<FAsyncTask<FSGHintSearchTask>>(&HintSearch);
+	}
+
+	// The task works on copies, the game thread can change the board while it searches
+	FSGHintSearchTask& Task = HintTask->GetTask();
+	CurrentGrid->BuildBoardState(Task.Board);
+	BuildLinkLineAddresses(Task.Prefix);
+	Task.Settings.MinimumLength = MinimunLengthLinkLineRequired;
+	Task.Settings.MaxLength = FMath::Max(HintMaxLinkLength, MinimunLengthLinkLineRequired);
+	Task.Settings.MaxSearchStepNum = HintMaxSearchStepNum;
+	Task.BoardChecksum = CurrentGrid->GetBitBoard().GetChecksum();
+
+	HintTask->StartBackgroundTask();
+	bHintTaskRunning = true;
+}
+
+void ASGGameMode::PollLinkHint()
+{
+	if (bHintTaskRunning == false || HintTask->IsDone() == false)
+	{
+		return;
+	}
+	bHintTaskRunning = false;
+
+	const FSGHintSearchTask& Task = HintTask->GetTask();
+	TArray<int32> LinkLineAddresses;
+	BuildLinkLineAddresses(LinkLineAddresses);
+	if (CurrentGameGameStatus != ESGGameStatus::EGS_PlayerBeginInput || CurrentGrid == nullptr ||
+		Task.BoardChecksum != CurrentGrid->GetBitBoard().GetChecksum() || Task.Prefix != LinkLineAddresses)
+	{
+		UE_LOG(LogSGameAsyncTask, Verbose, TEXT("The board or the link line changed while searching the hint, the result is dropped"));
+		RequestLinkHint();
+		return;
+	}
+
+	LastLinkHint = Task.Result;
+	UE_LOG(LogSGameAsyncTask, Log, TEXT("Link hint of length %d, value %f, %d kills, %s in %.3f ms with %d steps"),
+		LastLinkHint.LinkAddresses.Num(), LastLinkHint.Value, LastLinkHint.KillNum,
+		HintSearch.WasLastQueryCached() ? TEXT("cached") : (LastLinkHint.bComplete ? TEXT("searched") : TEXT("searched partly")),
+		Task.SearchSeconds * 1000.0, HintSearch.GetLastSearchStepNum());
+
+	if (bBotPlayer == true)
+	{
+		PlayBotLinkLine(LastLinkHint);
+	}
+	else if (bShowLinkHint == true)
+	{
+		CurrentGrid->ShowLinkHint(LastLinkHint.LinkAddresses);
+	}
+}
+
+void ASGGameMode::PlayBotLinkLine(const FSGHintResult& inHint)
+{
+	if (inHint.LinkAddresses.Num() < MinimunLengthLinkLineRequired)
+	{
+		UE_LOG(LogSGame, Warning, TEXT("The bot finds no link line to play"));
+		return;
+	}
+
+	// Pick the tiles like the tile input, then release
+	checkSlow(EventBus != nullptr);
+	for (const int32 GridAddress : inHint.LinkAddresses)
+	{
+		const ASGTileBase* Tile = CurrentGrid->GetTileFromGridAddress(GridAddress);
+		checkSlow(Tile != nullptr);
+
+		FMessage_Gameplay_NewTilePicked TilePickedMessage;
+		TilePickedMessage.TileID = Tile->GetTileID();
+		EventBus->Publish(TilePickedMessage);
+	}
+
+	FMessage_Gameplay_GameStatusUpdate GameStatusUpdateMessage;
+	GameStatusUpdateMessage.NewGameStatus = ESGGameStatus::EGS_PlayerEndBuildPath;
+	EventBus->Publish(GameStatusUpdateMessage);
+}
+
+void ASGGameMode::BuildLinkLineAddresses(TArray<int32>& OutAddresses) const
+{
+	OutAddresses.Reset();
+	if (CurrentLinkLine != nullptr)
+	{
+		for (const ASGTileBase* Tile : CurrentLinkLine->LinkLineTiles)
+		{
+			OutAddresses.Add(Tile->GetGridAddress());
+		}
 	}
 }
 
@@ -594,22 +751,16 @@ void ASGGameMode::OnRoundEndStage()
 {
 	UE_LOG(LogSGameProcedure, Log, TEXT("Round end!"));
 
-	checkSlow(MessageEndpoint.IsValid());
-
 	// Check if game over
 	if (CheckGameOver() == true)
 	{
 		// If then, send next state to game over
-		FMessage_Gameplay_GameStatusUpdate* GameStatusUpdateMesssage = new FMessage_Gameplay_GameStatusUpdate();
-		GameStatusUpdateMesssage->NewGameStatus = ESGGameStatus::EGS_GameOver;
-		MessageEndpoint->Publish(GameStatusUpdateMesssage, EMessageScope::Process);
+		ChangeGameStatus(ESGGameStatus::EGS_GameOver);
 	}
 	else
 	{
 		// If not, start a new round
-		FMessage_Gameplay_GameStatusUpdate* GameStatusUpdateMesssage = new FMessage_Gameplay_GameStatusUpdate();
-		GameStatusUpdateMesssage->NewGameStatus = ESGGameStatus::EGS_RondBegin;
-		MessageEndpoint->Publish(GameStatusUpdateMesssage, EMessageScope::Process);
+		ChangeGameStatus(ESGGameStatus::EGS_RondBegin);
 	}
 }
 
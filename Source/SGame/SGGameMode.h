@@ -3,17 +3,44 @@
 #pragma once
 
 #include "GameFramework/GameMode.h"
-#include "MessageEndpoint.h"
-#include "MessageEndpointBuilder.h"
 #include "SGTileBase.h"
 #include "SGameMessages.h"
+#include "SGGameplayEventBus.h"
 #include "SGLinkLine.h"
 #include "SGGrid.h"
 #include "SGSpritePawn.h"
 #include "SGPlayerSkillManager.h"
+#include "SGHintSearch.h"
 
 #include "SGGameMode.generated.h"
 
+/** Timings of one game status stage */
+struct FSGGameStageTiming
+{
+	FSGGameStageTiming()
+		: EnterNum(0)
+		, TotalLatencySeconds(0)
+		, MaxLatencySeconds(0)
+		, TotalExecuteSeconds(0)
+		, TotalStageSeconds(0)
+		, LastStageSeconds(0)
+	{}
+
+	/** How many times the stage was entered */
+	int32 EnterNum;
+
+	/** Time from the status change request to the stage running */
+	double TotalLatencySeconds;
+	double MaxLatencySeconds;
+
+	/** Time spent in the stage function */
+	double TotalExecuteSeconds;
+
+	/** Time from entering the stage to entering the next one, includes waiting for the animations or the input */
+	double TotalStageSeconds;
+	double LastStageSeconds;
+};
+
 /**
  * The Gameplay mode
  */
@@ -28,10 +55,27 @@ public:
 	/** Called when the game starts. */
 	virtual void BeginPlay() override;
 
+	/** Called when the game ends. */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	/** Initialize the tiles on the grid*/
 	UFUNCTION(BlueprintCallable, Category = Game)
 	ESGGameStatus GetCurrentGameStatus();
 
+	/**
+	* Move the stage machine to the new status.
+	* The stages which don't wait run one after another in the same call, the stage machine only stops on the stages waiting for the animations or the input.
+	* Called from a stage, the new status runs after the current stage returns.
+	*/
+	UFUNCTION(BlueprintCallable, Category = Game)
+	void ChangeGameStatus(ESGGameStatus inNewGameStatus);
+
+	/** The recorded timings of the stage */
+	const FSGGameStageTiming& GetStageTiming(ESGGameStatus inGameStatus) const { return StageTimings[static_cast<int32>(inGameStatus)]; }
+
+	/** Time from the round end to the player can input again, in the last round */
+	double GetLastTurnHandoffSeconds() const { return LastTurnHandoffSeconds; }
+
 	/** Begin the new round */
 	UFUNCTION(BlueprintCallable, Category = Game)
 	void OnBeginRound();
@@ -87,15 +131,26 @@ public:
 
 	int32 GetCurrentRound() const { return CurrentRound; }
 
+	/** Random stream of the current match, every gameplay draw should use it so the match can be replayed from the seed */
+	FRandomStream& GetMatchRandomStream() { return MatchRandomStream; }
+
+	/** Seed the current match started from */
+	int32 GetMatchRandomSeed() const { return MatchRandomSeed; }
+
 	UFUNCTION(BlueprintCallable, Category = Game)
 	bool IsLinkLineValid();
 
 	bool ShouldReplayLinkAnimation() const { return bShouldReplayLinkAnimation; }
 
+	int32 GetMinimumLinkLineLength() const { return MinimunLengthLinkLineRequired; }
+
 	/** Tell wheter can link to test tile */
 	UFUNCTION(BlueprintCallable, Category = Tile)
 	bool CanLinkToLastTile(const ASGTileBase* inTestTile);
 
+	/** Tell wheter the test tile can be linked after the last tile */
+	bool CanLinkTiles(const ASGTileBase* inLastTile, const ASGTileBase* inTestTile) const;
+
 	/** Collect a array of tiles*/
 	UFUNCTION(BlueprintCallable, Category = Tile)
 	bool CollectTileArray(TArray<ASGTileBase*> inTileArrayToCollect);
@@ -117,6 +172,16 @@ public:
 	UFUNCTION(BlueprintCallable, Category = LinkLine)
 	void CalculateLinkLine();
 
+	/**
+	* Search the most valuable link line from the current link line on a worker thread
+	* The result is shown as the hint, or played by the bot, on the tick it is found
+	*/
+	UFUNCTION(BlueprintCallable, Category = Hint)
+	void RequestLinkHint();
+
+	/** The last link hint found for the current board and link line */
+	const FSGHintResult& GetLastLinkHint() const { return LastLinkHint; }
+
 protected:
 
 	/** The minum lenth require for on valid link line*/
@@ -135,41 +200,106 @@ protected:
 	UPROPERTY(BlueprintReadOnly, Category = Game)
 	ASGGrid*			CurrentGrid;
 
+	/** Show the most valuable link line to the player while building the link line */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Hint)
+	bool bShowLinkHint;
+
+	/** The bot plays the link hint instead of waiting for the player input */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Hint)
+	bool bBotPlayer;
+
+	/** The longest link line the hint search tries */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Hint)
+	int32 HintMaxLinkLength;
+
+	/** Search steps before the hint search returns the best link line found so far */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Hint)
+	int32 HintMaxSearchStepNum;
+
 	/**
 	* Calculate the linkline damage
 	*/
-	TArray<FTileDamageInfo> CaculateLinkLineDamage(TArray<ASGTileBase*>& CauseDamageTiles);
+	FSGMessageDamageInfoArray CaculateLinkLineDamage(const FSGMessageTileArray& CauseDamageAddresses);
 private:
 	/** Handles Game start messages. */
-	void HandleGameStart(const FMessage_Gameplay_GameStart& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleGameStart(const FMessage_Gameplay_GameStart& Message);
 
 	/** Handles the game status update messages. */
-	void HandleGameStatusUpdate(const FMessage_Gameplay_GameStatusUpdate& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleGameStatusUpdate(const FMessage_Gameplay_GameStatusUpdate& Message);
 
 	/** Handle all tile has finish moving message, push the game procesdure to next stage */
-	void HandleAllTileFinishMoving(const FMessage_Gameplay_AllTileFinishMove& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleAllTileFinishMoving(const FMessage_Gameplay_AllTileFinishMove& Message);
 
 	/** Handle begin attack event*/
-	void HandleBeginAttack(const FMessage_Gameplay_EnemyBeginAttack& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleBeginAttack(const FMessage_Gameplay_EnemyBeginAttack& Message);
 
 	/** Handle collect the link line*/
-	void HandleCollectLinkLine(const FMessage_Gameplay_CollectLinkLine& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleCollectLinkLine(const FMessage_Gameplay_CollectLinkLine& Message);
 
 	/** Handles the player picked new tile*/
-	void HandleNewTileIsPicked(const FMessage_Gameplay_NewTilePicked& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleNewTileIsPicked(const FMessage_Gameplay_NewTilePicked& Message);
+
+	/** Run the stage function of the status and record its timings */
+	void RunGameStatusStage(ESGGameStatus inGameStatus, uint64 inRequestCycles);
+
+	/** Take the result of the finished hint search, drop it if the board or the link line changed meanwhile */
+	void PollLinkHint();
+
+	/** Play the hint link line through the same messages as the tile input */
+	void PlayBotLinkLine(const FSGHintResult& inHint);
+
+	/** Grid addresses of the current link line */
+	void BuildLinkLineAddresses(TArray<int32>& OutAddresses) const;
 
 	/** Current game status for this mode*/
 	ESGGameStatus CurrentGameGameStatus;
 
-	// Holds the messaging endpoint.
-	TSharedPtr<FMessageEndpoint, ESPMode::ThreadSafe> MessageEndpoint;
+	/** Status change requested while a stage is running */
+	struct FSGPendingGameStatus
+	{
+		ESGGameStatus GameStatus;
+		uint64 RequestCycles;
+	};
+	TArray<FSGPendingGameStatus, TInlineAllocator<4>> PendingGameStatuses;
+
+	/** The stage machine is running the stages, new status waits in the pending array */
+	bool bRunningStageMachine;
+
+	/** Timings for every game status, indexed by the status */
+	TArray<FSGGameStageTiming> StageTimings;
+
+	/** When the current stage was entered */
+	uint64 CurrentStageEnterCycles;
+
+	/** When the last round end stage was entered, for the turn handoff time */
+	uint64 RoundEndEnterCycles;
+
+	double LastTurnHandoffSeconds;
+
+	// Holds the gameplay event bus.
+	FSGGameplayEventBus* EventBus;
 
 	/** Current round number*/
 	int32				CurrentRound;
 
+	/** Seeded at the game start, the same seed and the same input give the same boards */
+	FRandomStream		MatchRandomStream;
+	int32				MatchRandomSeed;
+
 	/** Current link line */
 	ASGLinkLine*		CurrentLinkLine;
 
 	/** Current player pawn (master) */
 	ASGSpritePawn*		CurrentPlayerPawn;
+
+	/** Used by one hint task at a time, keeps the hint cache between the searches */
+	FSGHintSearch		HintSearch;
+
+	/** The hint search task, reused for every request */
+	TUniquePtr<FAsyncTask<FSGHintSearchTask>> HintTask;
+
+	/** The hint task is searching, or its result is not read yet */
+	bool				bHintTaskRunning;
+
+	FSGHintResult		LastLinkHint;
 };
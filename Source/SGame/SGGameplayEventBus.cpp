@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SGame.h"
+#include "SGGameplayEventBus.h"
+
+DECLARE_CYCLE_STAT(TEXT("Dispatch Deferred Events"), STAT_SGDispatchDeferredEvents, STATGROUP_SGame);
+
+FSGGameplayEventBus::FSGGameplayEventBus()
+{
+}
+
+int32 FSGGameplayEventBus::AllocateChannelIndex()
+{
+	// Only called once for every event type, from the game thread
+	static int32 NextChannelIndex = 0;
+	return NextChannelIndex++;
+}
+
+void FSGGameplayEventBus::UnsubscribeAll(const void* Handler)
+{
+	for (const TUniquePtr<FSGEventChannelBase>& Channel : Channels)
+	{
+		if (Channel.IsValid() == true)
+		{
+			Channel->RemoveSubscriber(Handler);
+		}
+	}
+}
+
+void FSGGameplayEventBus::DispatchDeferredEvents()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SGDispatchDeferredEvents);
+
+	// Only dispatch the events queued before this call
+	const int32 QueuedEventNum = DeferredChannelQueue.Num();
+	for (int32 i = 0; i < QueuedEventNum; i++)
+	{
+		DeferredChannelQueue[i]->DispatchNextDeferred();
+	}
+	DeferredChannelQueue.RemoveAt(0, QueuedEventNum, false);
+}
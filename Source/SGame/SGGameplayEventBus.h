@@ -0,0 +1,322 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SGame.h"
+
+/** When the subscriber handles the event */
+enum class ESGEventDelivery : uint8
+{
+	Immediate,		// Handled inside the publish call
+	Deferred,		// Queued, handled when the deferred events are dispatched, like the message inbox
+};
+
+/** Type erased channel, so the bus can keep all the typed channels in one array */
+class SGAME_API FSGEventChannelBase
+{
+public:
+	virtual ~FSGEventChannelBase() {}
+
+	/** Remove all the subscriptions of the handler */
+	virtual void RemoveSubscriber(const void* Handler) = 0;
+
+	/** Deliver the oldest queued event to the deferred subscribers */
+	virtual void DispatchNextDeferred() = 0;
+};
+
+/**
+ * Subscribers of one event type, kept in a contiguous array.
+ * Subscriptions removed while dispatching leave a tombstone, removed after the outermost dispatch.
+ * A removed slot takes the last subscriber of the array, so the handlers are not called in the subscribe order.
+ * The slots of every handler are indexed, so an addressed event goes to its recipient without walking the array.
+ */
+template<typename EventType>
+class TSGEventChannel : public FSGEventChannelBase
+{
+public:
+	typedef void(*FHandlerThunk)(void* Handler, const EventType& Event);
+
+	TSGEventChannel()
+		: DispatchDepth(0)
+		, DeferredSubscriberNum(0)
+		, DeferredEventHead(0)
+	{}
+
+	void AddSubscriber(void* Handler, FHandlerThunk Thunk, ESGEventDelivery Delivery)
+	{
+		checkSlow(Handler != nullptr && Thunk != nullptr);
+		const int32 SubscriberIndex = Subscribers.AddUninitialized();
+		FSubscriber& Subscriber = Subscribers[SubscriberIndex];
+		Subscriber.Handler = Handler;
+		Subscriber.Thunk = Thunk;
+		Subscriber.Delivery = Delivery;
+		RecipientSlots.Add(Handler, SubscriberIndex);
+		if (Delivery == ESGEventDelivery::Deferred)
+		{
+			DeferredSubscriberNum++;
+		}
+	}
+
+	virtual void RemoveSubscriber(const void* Handler) override
+	{
+		TArray<int32, TInlineAllocator<2>> Slots;
+		RecipientSlots.MultiFind(Handler, Slots);
+		if (Slots.Num() == 0)
+		{
+			return;
+		}
+		RecipientSlots.Remove(Handler);
+
+		for (int32 SubscriberIndex : Slots)
+		{
+			FSubscriber& Subscriber = Subscribers[SubscriberIndex];
+			checkSlow(Subscriber.Handler == Handler);
+			if (Subscriber.Delivery == ESGEventDelivery::Deferred)
+			{
+				DeferredSubscriberNum--;
+			}
+
+			// Leave a tombstone, so the running dispatch can go on with the array
+			Subscriber.Handler = nullptr;
+			TombstoneSlots.Add(SubscriberIndex);
+		}
+
+		if (DispatchDepth == 0)
+		{
+			RemoveTombstones();
+		}
+	}
+
+	/**
+	* Call the handlers of the delivery mode
+	*
+	* @param Event		the event
+	* @param Delivery	only call the subscribers with this delivery mode
+	* @param Recipient	only call this handler, null means all the handlers
+	*/
+	void Dispatch(const EventType& Event, ESGEventDelivery Delivery, const void* Recipient)
+	{
+		DispatchDepth++;
+
+		if (Recipient != nullptr)
+		{
+			// Only the slots of the recipient, copied as the handler may subscribe and change the index
+			TArray<int32, TInlineAllocator<2>> Slots;
+			RecipientSlots.MultiFind(Recipient, Slots, true);
+			for (int32 SubscriberIndex : Slots)
+			{
+				const FSubscriber Subscriber = Subscribers[SubscriberIndex];
+				if (Subscriber.Handler != nullptr && Subscriber.Delivery == Delivery)
+				{
+					Subscriber.Thunk(Subscriber.Handler, Event);
+				}
+			}
+		}
+		else
+		{
+			// The subscribers added by the handlers don't get the current event
+			const int32 SubscriberNum = Subscribers.Num();
+			for (int32 i = 0; i < SubscriberNum; i++)
+			{
+				// Copy the entry, the handler may add subscribers and grow the array
+				const FSubscriber Subscriber = Subscribers[i];
+				if (Subscriber.Handler != nullptr && Subscriber.Delivery == Delivery)
+				{
+					Subscriber.Thunk(Subscriber.Handler, Event);
+				}
+			}
+		}
+
+		DispatchDepth--;
+		if (DispatchDepth == 0 && TombstoneSlots.Num() > 0)
+		{
+			RemoveTombstones();
+		}
+	}
+
+	bool HasDeferredSubscribers() const { return DeferredSubscriberNum > 0; }
+
+	/** Queue the event for the deferred subscribers */
+	void QueueDeferred(const EventType& Event, const void* Recipient)
+	{
+		FDeferredEvent& DeferredEvent = DeferredEvents[DeferredEvents.AddDefaulted()];
+		DeferredEvent.Event = Event;
+		DeferredEvent.Recipient = Recipient;
+	}
+
+	virtual void DispatchNextDeferred() override
+	{
+		checkSlow(DeferredEvents.IsValidIndex(DeferredEventHead));
+
+		// Move the event out, the handlers may queue new events and grow the array
+		const EventType Event = MoveTemp(DeferredEvents[DeferredEventHead].Event);
+		const void* Recipient = DeferredEvents[DeferredEventHead].Recipient;
+		DeferredEventHead++;
+		if (DeferredEventHead == DeferredEvents.Num())
+		{
+			DeferredEvents.Reset();
+			DeferredEventHead = 0;
+		}
+
+		Dispatch(Event, ESGEventDelivery::Deferred, Recipient);
+	}
+
+private:
+	struct FSubscriber
+	{
+		void* Handler;
+		FHandlerThunk Thunk;
+		ESGEventDelivery Delivery;
+	};
+
+	struct FDeferredEvent
+	{
+		EventType Event;
+		const void* Recipient;
+	};
+
+	void RemoveTombstones()
+	{
+		// From the last slot, so the subscriber moved into a removed slot is always a live one
+		TombstoneSlots.Sort(TGreater<int32>());
+		for (int32 SubscriberIndex : TombstoneSlots)
+		{
+			checkSlow(Subscribers[SubscriberIndex].Handler == nullptr);
+			const int32 LastIndex = Subscribers.Num() - 1;
+			if (SubscriberIndex != LastIndex)
+			{
+				// Only the moved subscriber changes its slot
+				const void* MovedHandler = Subscribers[LastIndex].Handler;
+				checkSlow(MovedHandler != nullptr);
+				RecipientSlots.RemoveSingle(MovedHandler, LastIndex);
+				RecipientSlots.Add(MovedHandler, SubscriberIndex);
+			}
+			Subscribers.RemoveAtSwap(SubscriberIndex, 1, false);
+		}
+		TombstoneSlots.Reset();
+	}
+
+	TArray<FSubscriber> Subscribers;
+
+	/** Slots of every live handler */
+	TMultiMap<const void*, int32> RecipientSlots;
+
+	/** Slots of the removed subscribers, waiting for the outermost dispatch to end */
+	TArray<int32, TInlineAllocator<8>> TombstoneSlots;
+
+	/** Nested dispatch depth, the handler can publish the same event again */
+	int32 DispatchDepth;
+
+	int32 DeferredSubscriberNum;
+
+	/** Queued events, from the head index */
+	TArray<FDeferredEvent> DeferredEvents;
+	int32 DeferredEventHead;
+};
+
+/**
+ * Game thread event bus for the gameplay messages.
+ * Every event type has its own channel, found by a per type index instead of a name or a hash.
+ * The handlers are called directly, there is no message context or router thread involved.
+ */
+class SGAME_API FSGGameplayEventBus
+{
+public:
+	FSGGameplayEventBus();
+
+	/**
+	* Subscribe the member function to the event type
+	*
+	* @param Handler	the handler object, also the recipient address for Send
+	* @param Delivery	handle the event inside the publish call or when the deferred events are dispatched
+	*/
+	template<typename EventType, typename HandlerType, void (HandlerType::*HandlerFunc)(const EventType&)>
+	void Subscribe(HandlerType* Handler, ESGEventDelivery Delivery = ESGEventDelivery::Immediate)
+	{
+		GetChannel<EventType>().AddSubscriber(Handler, &CallHandler<EventType, HandlerType, HandlerFunc>, Delivery);
+	}
+
+	/** Remove the handler from the event type */
+	template<typename EventType>
+	void Unsubscribe(const void* Handler)
+	{
+		GetChannel<EventType>().RemoveSubscriber(Handler);
+	}
+
+	/** Remove the handler from all the event types */
+	void UnsubscribeAll(const void* Handler);
+
+	/** Deliver the event to all the subscribers */
+	template<typename EventType>
+	void Publish(const EventType& Event)
+	{
+		DeliverEvent(Event, nullptr);
+	}
+
+	/** Deliver the event only to the recipient, it should be the same object pointer used to subscribe */
+	template<typename EventType>
+	void Send(const EventType& Event, const void* Recipient)
+	{
+		checkSlow(Recipient != nullptr);
+		DeliverEvent(Event, Recipient);
+	}
+
+	/**
+	* Dispatch the deferred events in the publish order.
+	* Events queued by the handlers wait for the next call, like the message inbox.
+	*/
+	void DispatchDeferredEvents();
+
+	/** How many events wait for the deferred dispatch */
+	int32 GetDeferredEventNum() const { return DeferredChannelQueue.Num(); }
+
+private:
+	template<typename EventType, typename HandlerType, void (HandlerType::*HandlerFunc)(const EventType&)>
+	static void CallHandler(void* Handler, const EventType& Event)
+	{
+		(static_cast<HandlerType*>(Handler)->*HandlerFunc)(Event);
+	}
+
+	/** The channel index of the event type, the same for every bus */
+	template<typename EventType>
+	static int32 GetChannelIndex()
+	{
+		static const int32 ChannelIndex = AllocateChannelIndex();
+		return ChannelIndex;
+	}
+
+	static int32 AllocateChannelIndex();
+
+	template<typename EventType>
+	TSGEventChannel<EventType>& GetChannel()
+	{
+		const int32 ChannelIndex = GetChannelIndex<EventType>();
+		if (ChannelIndex >= Channels.Num())
+		{
+			Channels.SetNum(ChannelIndex + 1);
+		}
+		if (Channels[ChannelIndex].IsValid() == false)
+		{
+			Channels[ChannelIndex] = MakeUnique<TSGEventChannel<EventType>>();
+		}
+		return static_cast<TSGEventChannel<EventType>&>(*Channels[ChannelIndex]);
+	}
+
+	template<typename EventType>
+	void DeliverEvent(const EventType& Event, const void* Recipient)
+	{
+		TSGEventChannel<EventType>& Channel = GetChannel<EventType>();
+		Channel.Dispatch(Event, ESGEventDelivery::Immediate, Recipient);
+		if (Channel.HasDeferredSubscribers() == true)
+		{
+			Channel.QueueDeferred(Event, Recipient);
+			DeferredChannelQueue.Add(&Channel);
+		}
+	}
+
+	/** Channels indexed by the channel index, the channel address never changes */
+	TArray<TUniquePtr<FSGEventChannelBase>> Channels;
+
+	/** The channel of every queued deferred event, in the publish order */
+	TArray<FSGEventChannelBase*> DeferredChannelQueue;
+};
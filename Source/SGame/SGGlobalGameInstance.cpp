@@ -5,5 +5,16 @@
 
 USGGlobalGameInstance::USGGlobalGameInstance()
 {
-	MessageEndpoint = FMessageEndpoint::Builder("GlobalGameInstance");
+}
+
+FSGGameplayEventBus* USGGlobalGameInstance::GetEventBus(const UObject* WorldContextObject)
+{
+	USGGlobalGameInstance* GameInstance = Cast<USGGlobalGameInstance>(UGameplayStatics::GetGameInstance(WorldContextObject));
+	if (GameInstance == nullptr)
+	{
+		UE_LOG(LogSGame, Error, TEXT("The game instance is not a SGGlobalGameInstance, no gameplay event bus"));
+		return nullptr;
+	}
+
+	return &GameInstance->GetGameplayEventBus();
 }
\ No newline at end of file
@@ -3,9 +3,8 @@
 #pragma once
 
 #include "Engine/GameInstance.h"
-#include "MessageEndpoint.h"
-#include "MessageEndpointBuilder.h"
 #include "SGameMessages.h"
+#include "SGGameplayEventBus.h"
 #include "SGGlobalGameInstance.generated.h"
 
 /**
@@ -19,8 +18,14 @@ class SGAME_API USGGlobalGameInstance : public UGameInstance
 public:
 	USGGlobalGameInstance();
 
+	/** The gameplay event bus */
+	FSGGameplayEventBus& GetGameplayEventBus() { return GameplayEventBus; }
+
+	/** Helper to get the gameplay event bus from the game instance of the world context object, null if there is not */
+	static FSGGameplayEventBus* GetEventBus(const UObject* WorldContextObject);
+
 private:
 	
-	// Holds the messaging endpoint.
-	TSharedPtr<FMessageEndpoint, ESPMode::ThreadSafe> MessageEndpoint;
+	// Holds the gameplay event bus, all the gameplay messages go through it
+	FSGGameplayEventBus GameplayEventBus;
 };
@@ -6,6 +6,15 @@
 #include "SGGrid.h"
 #include "SGGameMode.h"
 #include "SGEnemyTileBase.h"
+#include "SGGlobalGameInstance.h"
+
+DECLARE_CYCLE_STAT(TEXT("Grid Condense"), STAT_SGGridCondense, STATGROUP_SGame);
+DECLARE_CYCLE_STAT(TEXT("Grid Refill"), STAT_SGGridRefill, STATGROUP_SGame);
+DECLARE_CYCLE_STAT(TEXT("Grid Link Components"), STAT_SGGridLinkComponents, STATGROUP_SGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tile Status Changes"), STAT_SGTileStatusChanges, STATGROUP_SGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tile Status Messages Published"), STAT_SGTileStatusMessagesPublished, STATGROUP_SGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tile Status Messages Saved"), STAT_SGTileStatusMessagesSaved, STATGROUP_SGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Link Step Message Heap Allocations"), STAT_SGLinkStepMessageHeapAllocations, STATGROUP_SGame);
 
 // Sets default values
 ASGGrid::ASGGrid(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
@@ -14,8 +23,16 @@ ASGGrid::ASGGrid(const FObjectInitializer& ObjectInitializer) : Super(ObjectInit
 	PrimaryActorTick.bCanEverTick = true;
 
 	LevelTileManager = nullptr;
+	EventBus = nullptr;
 	TileSize.Set(106.67f, 106.67f);
 	CurrentFallingTileNum = 0;
+	DragRefreshNum = 0;
+	DragStatusMessageNum = 0;
+	DragSavedStatusMessageNum = 0;
+	DragMessageHeapAllocationNum = 0;
+	MaxDeadlockReshuffleNum = 8;
+	bDeadlockPending = false;
+	MinimumLinkLineLength = 3;
 }
 
 // Called when the game starts or when spawned
@@ -23,22 +40,29 @@ void ASGGrid::BeginPlay()
 {
 	Super::BeginPlay();
 	
-	MessageEndpoint = FMessageEndpoint::Builder("Gameplay_Grid")
-		.Handling<FMessage_Gameplay_LinkedTilesCollect>(this, &ASGGrid::HandleTileArrayCollect)
-		.Handling<FMessage_Gameplay_TileBeginMove>(this, &ASGGrid::HandleTileBeginMove)
-		.Handling<FMessage_Gameplay_TileEndMove>(this, &ASGGrid::HandleTileEndMove);
-	if (MessageEndpoint.IsValid() == true)
+	EventBus = USGGlobalGameInstance::GetEventBus(this);
+	if (EventBus != nullptr)
 	{
 		// Subscribe the grid needed messages
-		MessageEndpoint->Subscribe<FMessage_Gameplay_LinkedTilesCollect>();
-		MessageEndpoint->Subscribe<FMessage_Gameplay_NewTilePicked>();
-		MessageEndpoint->Subscribe<FMessage_Gameplay_TileBeginMove>();
-		MessageEndpoint->Subscribe<FMessage_Gameplay_TileEndMove>();
+		EventBus->Subscribe<FMessage_Gameplay_LinkedTilesCollect, ASGGrid, &ASGGrid::HandleTileArrayCollect>(this);
+		EventBus->Subscribe<FMessage_Gameplay_TileEndMove, ASGGrid, &ASGGrid::HandleTileEndMove>(this);
 	}
 
 	// Initialize the grid
 	GridTiles.Empty(GridWidth * GridHeight);
 	GridTiles.AddZeroed(GridWidth * GridHeight);
+	Geometry.Init(GridWidth, GridHeight);
+	Geometry.InitLocations(TileSize);
+	BitBoard.Init(GridWidth, GridHeight);
+	TileStore.Init(GridWidth * GridHeight);
+	SelectableMask.Init(GridWidth * GridHeight);
+	PublishedSelectableMask.Init(GridWidth * GridHeight);
+	PublishedLinkedMask.Init(GridWidth * GridHeight);
+	SelectableChangeMask.Init(GridWidth * GridHeight);
+	LinkedChangeMask.Init(GridWidth * GridHeight);
+	StatusChangeMask.Init(GridWidth * GridHeight);
+	ComponentDirtyMask.Init(GridWidth * GridHeight);
+	LinkComponents.Build(BitBoard);
 
 	// Spawn the tile manager
 	checkSlow(GetWorld());
@@ -49,6 +73,9 @@ void ASGGrid::BeginPlay()
 	SpawnParams.Instigator = nullptr;
 	LevelTileManager = GetWorld()->SpawnActor<ASGLevelTileManager>(LevelTileManagerClass, SpawnParams);
 	checkSlow(LevelTileManager);
+
+	// Spawn the tiles of the first fill now, the refills reuse the collected tiles
+	LevelTileManager->PrewarmTilePool(this, GridWidth * GridHeight);
 	
 	// Find the link line actor in the world
 	CurrentLinkLine = nullptr;
@@ -66,6 +93,17 @@ void ASGGrid::BeginPlay()
 	checkSlow(CurrentLinkLine);
 }
 
+void ASGGrid::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (EventBus != nullptr)
+	{
+		EventBus->UnsubscribeAll(this);
+		EventBus = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called every frame
 void ASGGrid::Tick( float DeltaTime )
 {
@@ -81,13 +119,20 @@ void ASGGrid::ResetGrid()
 		{
 			// If it is hole already, pass it
 			int gridAddress = ColumnRowToGridAddress(columnIndex, rowIndex);
-			
+			if (GridTiles[gridAddress] == nullptr)
+			{
+				continue;
+			}
+
 			// Destroy the tile
-			checkSlow(GridTiles[gridAddress] && GetTileManager());
+			checkSlow(GetTileManager());
 			GetTileManager()->DestroyTileWithID(GridTiles[gridAddress]->GetTileID());
 
 			// Empty the current grid tile
 			GridTiles[gridAddress] = nullptr;
+			BitBoard.ClearTile(gridAddress);
+			TileStore.ClearTile(gridAddress);
+			ComponentDirtyMask.Set(gridAddress);
 		}
 	}
 
@@ -97,80 +142,64 @@ void ASGGrid::ResetGrid()
 
 void ASGGrid::Condense()
 {
-	TMap<int32, int32> GridHoleNumMap;
+	SCOPE_CYCLE_COUNTER(STAT_SGGridCondense);
 
-	// Iterate the each colum of grid tiles arry, find the holes
-	for (int columnIndex = 0; columnIndex < GridWidth; columnIndex++)
-	{
-		for (int rowIndex = 0; rowIndex < GridHeight; rowIndex++)
-		{
-			// If it is hole already, pass it
-			int gridAddress = ColumnRowToGridAddress(columnIndex, rowIndex);
-			if (GridTiles[gridAddress] == nullptr)
-			{
-				continue;
-			}
+	// One sweep per column, find out the tile moves and the holes left on top
+	BuildCondenseMoveList(GridTiles, GridWidth, GridHeight, CondenseMoveList, ColumnRefillNums);
 
-			int currentGridHoleNum = 0;
-			// Search below, to find if there is any NULL tiles
-			for (int j = rowIndex + 1; j < GridHeight; j++)
-			{
-				int testAddress = ColumnRowToGridAddress(columnIndex, j);
-				if (GridTiles[testAddress] == nullptr)
-				{
-					currentGridHoleNum++;
-				}
-			}
-
-			if (currentGridHoleNum > 0)
-			{
-				// Insert it into the map
-				GridHoleNumMap.Add(ColumnRowToGridAddress(columnIndex, rowIndex), currentGridHoleNum);
-
-				UE_LOG(LogSGame, Log, TEXT("Tile Address: %d will move down %d"), ColumnRowToGridAddress(columnIndex, rowIndex), currentGridHoleNum);
-			}
-		}
+	// Move down the tiles, the list is from bottom to up in every column, so the new address is always empty
+	for (const FSGTileMove& TileMove : CondenseMoveList)
+	{
+		checkSlow(TileMove.Tile);
+		UE_LOG(LogSGame, Log, TEXT("Tile Address: %d will move to %d"), TileMove.OldTileAddress, TileMove.NewTileAddress);
+
+		// Send tile move message to the tile
+		SendTileBeginMove(TileMove.Tile, TileMove.OldTileAddress, TileMove.NewTileAddress);
+
+		// Upate the grid address, keep the tile address in sync for the tile id lookup
+		GridTiles[TileMove.NewTileAddress] = TileMove.Tile;
+		GridTiles[TileMove.OldTileAddress] = nullptr;
+		TileMove.Tile->SetGridAddress(TileMove.NewTileAddress);
+		BitBoard.MoveTile(TileMove.OldTileAddress, TileMove.NewTileAddress);
+		TileStore.MoveTile(TileMove.OldTileAddress, TileMove.NewTileAddress);
+		ComponentDirtyMask.Set(TileMove.OldTileAddress);
+		ComponentDirtyMask.Set(TileMove.NewTileAddress);
 	}
 
-	// Iterate the each column of grid tiles arry, move down the tiles
-	for (int columnIndex = 0; columnIndex < GridWidth; columnIndex++)
+	// Refill the top empty holes, the hole num comes from the same pass
+	for (int32 Col = 0; Col < GridWidth; ++Col)
 	{
-		// From down to up
-		for (int rowIndex = GridHeight - 1; rowIndex >= 0; rowIndex--)
+		if (ColumnRefillNums[Col] > 0)
 		{
-			int testAddress = ColumnRowToGridAddress(columnIndex, rowIndex);
-			if (GridHoleNumMap.Find(testAddress) == nullptr)
-			{
-				// No holes below, continue,
-				continue;
-			}
+			RefillColumn(Col, ColumnRefillNums[Col]);
+		}
+	}
 
-			int MoveDownNum = GridHoleNumMap[testAddress];
+	// After all reset the tile state
+	ResetTileLinkInfo();
+	ResetTileSelectInfo();
 
-			// Send tile move message to the tile
-			ASGTileBase* testTile = GridTiles[testAddress];
-			checkSlow(testTile);
+	UpdateLinkComponents();
+	CheckDeadlock();
+}
 
-			// Update the tile new address
-			FMessage_Gameplay_TileBeginMove* TileMoveMessage = new FMessage_Gameplay_TileBeginMove();
-			TileMoveMessage->TileID = testTile->GetTileID();
-			TileMoveMessage->OldTileAddress = testTile->GetGridAddress();
-			TileMoveMessage->NewTileAddress = ColumnRowToGridAddress(columnIndex, rowIndex + MoveDownNum);
+void ASGGrid::BuildCondenseMoveList(const TArray<ASGTileBase*>& inGridTiles, int32 inGridWidth, int32 inGridHeight, TArray<FSGTileMove>& OutMoves, TArray<int32>& OutColumnRefillNums)
+{
+	checkSlow(inGridTiles.Num() == inGridWidth * inGridHeight);
 
-			// Publish the message
-			if (MessageEndpoint.IsValid() == true)
-			{
-				MessageEndpoint->Publish(TileMoveMessage, EMessageScope::Process);
-			}
-			
-			// Upate the grid address
-			GridTiles[TileMoveMessage->NewTileAddress] = testTile;
-			GridTiles[TileMoveMessage->OldTileAddress] = nullptr;
-		}
-	}
+	// Keep the allocation, the lists are reused every condense
+	OutMoves.Reset();
 
-	// Refill the top empty holes
-	RefillGrid();
+	FSGBoardRules::BuildCondenseMoves(inGridWidth, inGridHeight,
+		[&inGridTiles](int32 GridAddress) { return inGridTiles[GridAddress] != nullptr; },
+		[&inGridTiles, &OutMoves](int32 OldGridAddress, int32 NewGridAddress)
+		{
+			FSGTileMove& TileMove = OutMoves[OutMoves.AddUninitialized()];
+			TileMove.Tile = inGridTiles[OldGridAddress];
+			TileMove.OldTileAddress = OldGridAddress;
+			TileMove.NewTileAddress = NewGridAddress;
+		},
+		OutColumnRefillNums);
 }
 
 void ASGGrid::RefillGrid()
@@ -187,20 +216,7 @@ void ASGGrid::RefillGrid()
 		}
 
 		// Find how many empty space we have
-		int32 RowNum = 0;
-		while (RowNum < GridHeight)
-		{
-			int32 NewGridAddress = ColumnRowToGridAddress(Col, RowNum);
-			const ASGTileBase* CurrentTile = GetTileFromGridAddress(NewGridAddress);
-			if (CurrentTile == nullptr)
-			{
-				++RowNum;
-			}
-			else
-			{
-				break;
-			}
-		}
+		const int32 RowNum = FSGBoardRules::CountColumnRefillNum(GridWidth, GridHeight, Col, [this](int32 GridAddress) { return GridTiles[GridAddress] != nullptr; });
 
 		if (RowNum > 0)
 		{
@@ -217,19 +233,137 @@ void ASGGrid::RefillGrid()
 	// After all reset the tile state
 	ResetTileLinkInfo();
 	ResetTileSelectInfo();
+
+	UpdateLinkComponents();
+	CheckDeadlock();
+}
+
+void ASGGrid::UpdateLinkComponents()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SGGridLinkComponents);
+
+	// Only the groups around the changes are labelled again
+	LinkComponents.Update(BitBoard, ComponentDirtyMask);
+	ComponentDirtyMask.Reset();
+
+	// The quality sums walk all the groups, only when somebody reads them
+	if (UE_LOG_ACTIVE(LogSGame, Verbose))
+	{
+		UE_LOG(LogSGame, Verbose, TEXT("Board quality: %d linkable groups, the biggest has %d tiles, %d tiles can make a link line, labelled %d addresses"),
+			LinkComponents.GetComponentNum(), LinkComponents.GetLargestComponentSize(), LinkComponents.CountTilesInComponents(MinimumLinkLineLength), LinkComponents.GetLastLabelledNum());
+	}
+}
+
+int32 ASGGrid::GetLinkComponentSize(int32 GridAddress) const
+{
+	if (GridTiles.IsValidIndex(GridAddress) == false)
+	{
+		return 0;
+	}
+	return LinkComponents.GetComponentSize(GridAddress);
+}
+
+TArray<int32> ASGGrid::GetLinkComponentAddresses(int32 GridAddress) const
+{
+	TArray<int32> ComponentAddresses;
+	if (GridTiles.IsValidIndex(GridAddress) == false || LinkComponents.GetComponent(GridAddress) == INDEX_NONE)
+	{
+		return ComponentAddresses;
+	}
+
+	const FSGBoardMask& ComponentMask = LinkComponents.GetComponentMask(LinkComponents.GetComponent(GridAddress));
+	ComponentAddresses.Reserve(LinkComponents.GetComponentSize(GridAddress));
+	ComponentMask.ForEachSetBit([&ComponentAddresses](int32 MemberAddress) { ComponentAddresses.Add(MemberAddress); });
+	return ComponentAddresses;
+}
+
+void ASGGrid::CheckDeadlock()
+{
+	LinkSolver.BuildFromBitBoard(BitBoard);
+	bDeadlockPending = (LinkSolver.FindLinkLine(MinimumLinkLineLength) == false);
+	if (bDeadlockPending == true && CurrentFallingTileNum == 0)
+	{
+		ResolveDeadlock();
+	}
+}
+
+void ASGGrid::ResolveDeadlock()
+{
+	ASGGameMode* GameMode = Cast<ASGGameMode>(UGameplayStatics::GetGameMode(this));
+	checkSlow(GameMode);
+	FRandomStream& MatchRandomStream = GameMode->GetMatchRandomStream();
+	bDeadlockPending = false;
+
+	// Shuffle a copy first, the tiles only move when the shuffled board has a link line
+	TArray<ASGTileBase*, TInlineAllocator<64>> ShuffledTiles(GridTiles);
+	for (int32 Attempt = 0; Attempt < MaxDeadlockReshuffleNum; Attempt++)
+	{
+		FSGBoardRules::ShuffleAddresses(ShuffledTiles.Num(), MatchRandomStream, [&ShuffledTiles](int32 GridAddressA, int32 GridAddressB) { Swap(ShuffledTiles[GridAddressA], ShuffledTiles[GridAddressB]); });
+
+		ShuffleBitBoard.Init(GridWidth, GridHeight);
+		for (int32 GridAddress = 0; GridAddress < ShuffledTiles.Num(); GridAddress++)
+		{
+			if (ShuffledTiles[GridAddress] != nullptr)
+			{
+				ShuffleBitBoard.SetTile(GridAddress, ShuffledTiles[GridAddress]->GetTileType(), ShuffledTiles[GridAddress]->GetAbilities());
+			}
+		}
+
+		LinkSolver.BuildFromBitBoard(ShuffleBitBoard);
+		if (LinkSolver.FindLinkLine(MinimumLinkLineLength) == true)
+		{
+			UE_LOG(LogSGame, Log, TEXT("No link line on the board, reshuffled %d times"), Attempt + 1);
+
+			// The tile store keeps the tile life, read it from the old addresses before they are overwritten
+			TArray<FSGBoardTile> ShuffledBoardTiles;
+			ShuffledBoardTiles.SetNum(ShuffledTiles.Num());
+			for (int32 GridAddress = 0; GridAddress < ShuffledTiles.Num(); GridAddress++)
+			{
+				if (ShuffledTiles[GridAddress] != nullptr)
+				{
+					BuildStoreBoardTile(ShuffledTiles[GridAddress]->GetGridAddress(), ShuffledTiles[GridAddress], ShuffledBoardTiles[GridAddress]);
+				}
+			}
+
+			// Move every tile to its shuffled address
+			for (int32 GridAddress = 0; GridAddress < ShuffledTiles.Num(); GridAddress++)
+			{
+				ASGTileBase* Tile = ShuffledTiles[GridAddress];
+				GridTiles[GridAddress] = Tile;
+				if (Tile != nullptr && Tile->GetGridAddress() != GridAddress)
+				{
+					SendTileBeginMove(Tile, Tile->GetGridAddress(), GridAddress);
+				}
+				TileStore.SetTile(GridAddress, ShuffledBoardTiles[GridAddress]);
+			}
+			BitBoard = ShuffleBitBoard;
+
+			// Every tile moved, label the groups from scratch
+			LinkComponents.Build(BitBoard);
+			ComponentDirtyMask.Reset();
+			return;
+		}
+	}
+
+	// No luck with the tiles, replace them with new ones, the refill checks the new board again
+	UE_LOG(LogSGame, Warning, TEXT("No link line after %d reshuffles, regenerate the board"), MaxDeadlockReshuffleNum);
+	ResetGrid();
 }
 
 void ASGGrid::RefillColumn(int32 inColumnIndex, int32 inNum)
 {
+	SCOPE_CYCLE_COUNTER(STAT_SGGridRefill);
+
 	ASGGameMode* GameMode = Cast<ASGGameMode>(UGameplayStatics::GetGameMode(this));
 	checkSlow(GameMode);
 	int CurrentRound = GameMode->GetCurrentRound();
+	FRandomStream& MatchRandomStream = GameMode->GetMatchRandomStream();
 	
 	// We always start fill the first row [0 index row]
 	for (int startRow = 0; startRow < inNum; startRow++)
 	{
 		// Calculate the new grid address
-		int32 TileID = GetTileManager()->SelectTileFromLibrary();
+		int32 TileID = GetTileManager()->SelectTileFromLibrary(MatchRandomStream, CurrentRound);
 		int32 GridAddress;
 		FVector SpawnLocation;
 		GridAddress = ColumnRowToGridAddress(inColumnIndex, startRow);
@@ -256,22 +390,45 @@ void ASGGrid::RefillGridAddressWithTile(int32 inGridAddress, ASGTileBase* inTile
 	checkSlow(inTile != nullptr);
 
 	// Send the tile move message to the tile
-	FMessage_Gameplay_TileBeginMove* TileMoveMessage = new FMessage_Gameplay_TileBeginMove();
-	TileMoveMessage->TileID = inTile->GetTileID();
-	TileMoveMessage->OldTileAddress = -1;
-	TileMoveMessage->NewTileAddress = inGridAddress;
+	SendTileBeginMove(inTile, -1, inGridAddress);
+
+	GridTiles[inGridAddress] = inTile;
+	BitBoard.SetTile(inGridAddress, inTile->GetTileType(), inTile->GetAbilities());
+	SetStoreTile(inGridAddress, inTile);
+	ComponentDirtyMask.Set(inGridAddress);
+}
 
-	// Publish the message
-	if (MessageEndpoint.IsValid() == true)
+void ASGGrid::SetStoreTile(int32 inGridAddress, const ASGTileBase* inTile)
+{
+	if (inTile == nullptr)
 	{
-		MessageEndpoint->Publish(TileMoveMessage, EMessageScope::Process);
+		TileStore.ClearTile(inGridAddress);
+		return;
 	}
 
-	GridTiles[inGridAddress] = inTile;
+	// The new tile has the archetype life, from now on the tile store keeps it
+	TileStore.SetTile(inGridAddress, inTile->GetArchetype());
+}
+
+void ASGGrid::BuildStoreBoardTile(int32 inGridAddress, const ASGTileBase* inTile, FSGBoardTile& OutBoardTile) const
+{
+	checkSlow(inTile != nullptr && TileStore.IsEmpty(inGridAddress) == false);
+	OutBoardTile = inTile->GetArchetype();
+	OutBoardTile.LifeArmorInfo.CurrentLife = TileStore.GetLife(inGridAddress);
+	OutBoardTile.LifeArmorInfo.CurrentArmor = TileStore.GetArmor(inGridAddress);
 }
 
 void ASGGrid::ResetTiles()
 {
+	if (DragRefreshNum > 0)
+	{
+		UE_LOG(LogSGame, Log, TEXT("Last drag refreshed the grid %d times, delivered %d tile status messages, saved %d messages, %d message heap allocations"), DragRefreshNum, DragStatusMessageNum, DragSavedStatusMessageNum, DragMessageHeapAllocationNum);
+	}
+	DragRefreshNum = 0;
+	DragStatusMessageNum = 0;
+	DragSavedStatusMessageNum = 0;
+	DragMessageHeapAllocationNum = 0;
+
 	ResetTileLinkInfo();
 	ResetTileSelectInfo();
 }
@@ -291,12 +448,11 @@ ASGTileBase* ASGGrid::GetTileFromGridAddress(int32 GridAddress)
 
 ASGTileBase* ASGGrid::GetTileFromTileID(int32 inTileID)
 {
-	for (int i = 0; i < GridTiles.Num(); i++)
+	// The tile manager index the tiles by id, then make sure the tile is on the grid
+	ASGTileBase* Tile = GetTileManager()->GetTileFromTileID(inTileID);
+	if (Tile != nullptr && GridTiles.IsValidIndex(Tile->GetGridAddress()) && GridTiles[Tile->GetGridAddress()] == Tile)
 	{
-		if (GridTiles[i] != nullptr && GridTiles[i]->GetTileID() == inTileID)
-		{
-			return GridTiles[i];
-		}
+		return Tile;
 	}
 
 	return nullptr;
@@ -304,61 +460,34 @@ ASGTileBase* ASGGrid::GetTileFromTileID(int32 inTileID)
 
 FVector ASGGrid::GetLocationFromGridAddress(int32 GridAddress, bool bNeedYOffset)
 {
-	checkSlow(TileSize.X > 0.0f);
-	checkSlow(TileSize.Y > 0.0f);
-	checkSlow(GridWidth > 0);
-	checkSlow(GridHeight > 0);
-	FVector Center = GetActorLocation();
-	FVector OutLocation = FVector(-(GridWidth / 2.0f) * TileSize.X + (TileSize.X * 0.5f), 0.0f, -(GridHeight / 2.0f) * TileSize.Y + (TileSize.Y * 0.5f));
-	OutLocation.X += TileSize.X * (float)(GridAddress % GridWidth);
-	OutLocation.Z += TileSize.Y * (float)(GridAddress / GridWidth);
+	checkSlow(Geometry.IsValidAddress(GridAddress));
+
+	// The tile locations are built with the geometry, only the grid location is added
+	FVector OutLocation = GetActorLocation() + Geometry.GetLocalLocation(GridAddress);
 	if (bNeedYOffset == true)
 	{
-		OutLocation.Y = 10;
+		OutLocation.Y += 10;
 	}
 
-	OutLocation += Center;
-
 	return OutLocation;
 }
 
 bool ASGGrid::GetGridAddressWithOffset(int32 InitialGridAddress, int32 XOffset, int32 YOffset, int32 &ReturnGridAddress)
 {
-	checkSlow(TileSize.X > 0.0f);
-	checkSlow(TileSize.Y > 0.0f);
-	checkSlow(GridWidth > 0);
-	checkSlow(GridHeight > 0);
-	int32 NewAxisValue;
-
-	// Initialize to an invalid address.
-	ReturnGridAddress = -1;
-
-	// Check for going off the map in the X direction.
-	NewAxisValue = (InitialGridAddress % GridWidth) + XOffset;
-	if (NewAxisValue != FMath::Clamp(NewAxisValue, 0, (GridWidth - 1)))
-	{
-		return false;
-	}
-
-	// Check for going off the map in the Y direction.
-	NewAxisValue = (InitialGridAddress / GridWidth) + YOffset;
-	if (NewAxisValue != FMath::Clamp(NewAxisValue, 0, (GridHeight - 1)))
-	{
-		return false;
-	}
-
-	ReturnGridAddress = (InitialGridAddress + XOffset + (YOffset * GridWidth));
-	checkSlow(ReturnGridAddress >= 0);
-	checkSlow(ReturnGridAddress < (GridWidth * GridHeight));
-	return true;
+	checkSlow(Geometry.IsValidAddress(InitialGridAddress));
+	return Geometry.GetAddressWithOffset(InitialGridAddress, XOffset, YOffset, ReturnGridAddress);
 }
 
 ASGTileBase* ASGGrid::GetTileFromColumnAndRow(int32 inColumn, int32 inRow)
 {
-	int32 GridAddress;
-	GridAddress = ColumnRowToGridAddress(inColumn, inRow);
+	// Called from blueprints, the column and row may be off the board or the geometry not built yet
+	if (Geometry.IsValidColumnRow(inColumn, inRow) == false)
+	{
+		UE_LOG(LogSGame, Log, TEXT("Invalid column %d row %d, will return null tile"), inColumn, inRow);
+		return nullptr;
+	}
 
-	return GetTileFromGridAddress(GridAddress);
+	return GetTileFromGridAddress(ColumnRowToGridAddress(inColumn, inRow));
 }
 
 TArray<ASGTileBase*> ASGGrid::GetTileSquareFromColumnAndRow(int32 inColumn, int32 inRow)
@@ -381,6 +510,12 @@ TArray<ASGTileBase*> ASGGrid::GetTileSquareFromColumnAndRow(int32 inColumn, int3
 	return ResultTileArray;
 }
 
+int32 ASGGrid::GetGridAddressFromLocation(const FVector& inWorldLocation, float inHitRatio) const
+{
+	// Same space as the tile locations, only the grid location is removed
+	return Geometry.GetAddressFromLocalLocation(inWorldLocation - GetActorLocation(), inHitRatio);
+}
+
 bool ASGGrid::AreAddressesNeighbors(int32 GridAddressA, int32 GridAddressB)
 {
 	if (GridAddressA == GridAddressB)
@@ -389,82 +524,133 @@ bool ASGGrid::AreAddressesNeighbors(int32 GridAddressA, int32 GridAddressB)
 		return true;
 	}
 
-	else if ((FMath::Min(GridAddressA, GridAddressB) < 0) || (FMath::Max(GridAddressA, GridAddressB) >= (GridWidth * GridHeight)))
+	else if (Geometry.IsValidAddress(GridAddressA) == false || Geometry.IsValidAddress(GridAddressB) == false)
 	{
 		UE_LOG(LogSGame, Warning, TEXT("Pass in the invalid addresses"));
 		return false;
 	}
 
-	auto AddressARow = GridAddressA / GridWidth;
-	auto AddressAColumn = GridAddressA % GridWidth;
-	auto AddressBRow = GridAddressB / GridWidth;
-	auto AddressBColumn = GridAddressB % GridWidth;
+	return Geometry.AreNeighbors(GridAddressA, GridAddressB);
+}
 
-	// The two address are neighbors only if there row and column distance less than 1
-	if (FMath::Abs(AddressARow - AddressBRow) <= 1 && FMath::Abs(AddressAColumn - AddressBColumn) <= 1)
+void ASGGrid::BuildBoardState(FSGBoardState& OutBoardState) const
+{
+	OutBoardState.Init(GridWidth, GridHeight);
+	for (int32 GridAddress = 0; GridAddress < GridTiles.Num(); GridAddress++)
 	{
-		return true;
+		if (GridTiles[GridAddress] != nullptr)
+		{
+			BuildStoreBoardTile(GridAddress, GridTiles[GridAddress], OutBoardState.GetTile(GridAddress));
+		}
 	}
-
-	return false;
 }
 
 void ASGGrid::RefreshGridState()
 {
+	const int32 StartHeapAllocationNum = FSGMessageHeapAllocator::GetHeapAllocationNum();
+
 	// Update the tile select state 
 	UpdateTileSelectState();
 
 	// Update the tile link state
 	UpdateTileLinkState();
+
+	// Only tell the tiles whose status changed
+	PublishTileStatusChanges();
+
+	// The message payloads of a link step stay inline, the count is not exact when other threads build messages at the same time
+	const int32 HeapAllocationNum = FSGMessageHeapAllocator::GetHeapAllocationNum() - StartHeapAllocationNum;
+	DragMessageHeapAllocationNum += HeapAllocationNum;
+	INC_DWORD_STAT_BY(STAT_SGLinkStepMessageHeapAllocations, HeapAllocationNum);
+	ensureMsgf(HeapAllocationNum == 0 || GridTiles.Num() > SG_MESSAGE_INLINE_TILE_NUM, TEXT("Link step allocated %d message payloads on the heap"), HeapAllocationNum);
+}
+
+void ASGGrid::SetTileLinkedStatus(int32 inGridAddress, bool bLinked)
+{
+	checkSlow(GridTiles.IsValidIndex(inGridAddress) && GridTiles[inGridAddress] != nullptr);
+	if (PublishedLinkedMask.Test(inGridAddress) == bLinked)
+	{
+		// The tile already shows the status
+		return;
+	}
+	PublishedLinkedMask.SetTo(inGridAddress, bLinked);
+
+	if (EventBus != nullptr)
+	{
+		FMessage_Gameplay_TileLinkedStatusChange LinkStatusChangeMessage;
+		LinkStatusChangeMessage.TileID = GridTiles[inGridAddress]->GetTileID();
+		LinkStatusChangeMessage.NewLinkStatus = bLinked;
+		EventBus->Send(LinkStatusChangeMessage, GridTiles[inGridAddress]);
+	}
 }
 
 bool ASGGrid::IsThreePointsSameLine(int32 Point1, int32 Point2, int32 Point3)
 {
-	return ((Point1 - Point2) * (Point1 % GridWidth - Point3 % GridWidth) == (Point1 - Point3) * (Point1 % GridWidth - Point2 % GridWidth));
+	return Geometry.IsThreePointsSameLine(Point1, Point2, Point3);
 }
 
-void ASGGrid::HandleTileArrayCollect(const FMessage_Gameplay_LinkedTilesCollect& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGGrid::HandleTileArrayCollect(const FMessage_Gameplay_LinkedTilesCollect& Message)
 {
 	for (int i = 0; i < Message.TilesAddressToCollect.Num(); i++)
 	{
 		int32 disappearTileAddress = Message.TilesAddressToCollect[i];
 		checkSlow(GridTiles[disappearTileAddress] != nullptr);
 
-		// Tell the tiles, it was collected
-		FMessage_Gameplay_TileCollect* CollectMessage = new FMessage_Gameplay_TileCollect{ 0 };
-		CollectMessage->TileID = GridTiles[disappearTileAddress]->GetTileID();
-		if (MessageEndpoint.IsValid() == true)
+		// Tell the tile, it was collected
+		if (EventBus != nullptr)
 		{
-			MessageEndpoint->Publish(CollectMessage, EMessageScope::Process);
+			FMessage_Gameplay_TileCollect CollectMessage;
+			CollectMessage.TileID = GridTiles[disappearTileAddress]->GetTileID();
+			EventBus->Send(CollectMessage, GridTiles[disappearTileAddress]);
 		}
 
 		// Set null to the grid tiles array
 		GridTiles[disappearTileAddress] = nullptr;
+		BitBoard.ClearTile(disappearTileAddress);
+		TileStore.ClearTile(disappearTileAddress);
+		ComponentDirtyMask.Set(disappearTileAddress);
 	}
 
 	// Condense the grid
 	Condense();
 }
 
-void ASGGrid::HandleTileBeginMove(const FMessage_Gameplay_TileBeginMove& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGGrid::SendTileBeginMove(ASGTileBase* inTile, int32 inOldTileAddress, int32 inNewTileAddress)
 {
+	checkSlow(inTile);
 	checkSlow(CurrentFallingTileNum >= 0);
 
+	// Count the falling tile here, the message only goes to the moving tile
 	CurrentFallingTileNum++;
+
+	if (EventBus != nullptr)
+	{
+		FMessage_Gameplay_TileBeginMove TileMoveMessage;
+		TileMoveMessage.TileID = inTile->GetTileID();
+		TileMoveMessage.OldTileAddress = inOldTileAddress;
+		TileMoveMessage.NewTileAddress = inNewTileAddress;
+		EventBus->Send(TileMoveMessage, inTile);
+	}
 }
 
-void ASGGrid::HandleTileEndMove(const FMessage_Gameplay_TileEndMove& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGGrid::HandleTileEndMove(const FMessage_Gameplay_TileEndMove& Message)
 {
 	checkSlow(CurrentFallingTileNum > 0);
 
 	CurrentFallingTileNum--;
+
+	// The dead board is reshuffled after the tiles stop, the shuffle moves the tiles again
+	if (CurrentFallingTileNum == 0 && bDeadlockPending == true)
+	{
+		ResolveDeadlock();
+	}
+
 	if (CurrentFallingTileNum == 0)
 	{
 		// Send the message indicate that all the tiles have finished falling
-		if (MessageEndpoint.IsValid() == true)
+		if (EventBus != nullptr)
 		{
-			FMessage_Gameplay_AllTileFinishMove* FinishMoveMessage = new FMessage_Gameplay_AllTileFinishMove();
-			MessageEndpoint->Publish(FinishMoveMessage, EMessageScope::Process);
+			EventBus->Publish(FMessage_Gameplay_AllTileFinishMove());
 		}
 	}
 }
@@ -473,90 +659,103 @@ void ASGGrid::UpdateTileSelectState()
 {
 	checkSlow(CurrentLinkLine != nullptr);
 
-	if (CurrentLinkLine->LinkLineTiles.Num() == 0)
-	{
-		// No tile in the link line, so all the tiles become selectable
-		ResetTileSelectInfo();
-		return;
-	}
-
-	// Iterator all the grid tiles, update the tile selectable status
-	for (int32 i = 0; i < 36; i++)
+	// Query the selectable addresses from the bitboard, no tile in the link line means all the tiles are selectable
+	int32 HeadGridAddress = INDEX_NONE;
+	if (CurrentLinkLine->LinkLineTiles.Num() > 0)
 	{
-		const ASGTileBase* testTile = GetTileFromGridAddress(i);
-		checkSlow(testTile);
-
-		FMessage_Gameplay_TileSelectableStatusChange* SelectableMessage = new FMessage_Gameplay_TileSelectableStatusChange{ 0 };
-		SelectableMessage->TileID = testTile->GetTileID();
-		
-		ASGGameMode* GameMode = Cast<ASGGameMode>(UGameplayStatics::GetGameMode(this));
-		checkSlow(GameMode);
-		if (GameMode->CanLinkToLastTile(testTile) == true)
-		{
-			// The neighbor tile become selectable
-			SelectableMessage->NewSelectableStatus = true;
-			MessageEndpoint->Publish(SelectableMessage, EMessageScope::Process);
-		}
-		else
-		{
-			// The other tile become unselectable
-			SelectableMessage->NewSelectableStatus = false;
-			MessageEndpoint->Publish(SelectableMessage, EMessageScope::Process);
-		}
+		const ASGTileBase* HeadTile = CurrentLinkLine->LinkLineTiles.Last();
+		checkSlow(HeadTile);
+		HeadGridAddress = HeadTile->GetGridAddress();
 	}
+	BitBoard.BuildSelectableMask(HeadGridAddress, SelectableMask);
 }
 
 void ASGGrid::ResetTileSelectInfo()
 {
 	// Tell all the tiles that they can be selected
-	if (MessageEndpoint.IsValid() == true)
+	if (EventBus != nullptr)
 	{
-		FMessage_Gameplay_TileSelectableStatusChange* SelectableMessage = new FMessage_Gameplay_TileSelectableStatusChange{ 0 };
+		FMessage_Gameplay_TileSelectableStatusChange SelectableMessage;
 
 		// Set the target address to all
-		SelectableMessage->TileID = -1;
-		SelectableMessage->NewSelectableStatus = true;
-		MessageEndpoint->Publish(SelectableMessage, EMessageScope::Process);
+		SelectableMessage.TileID = -1;
+		SelectableMessage.NewSelectableStatus = true;
+		EventBus->Publish(SelectableMessage);
 	}
+	PublishedSelectableMask.SetAll();
 }
 
 void ASGGrid::UpdateTileLinkState()
 {
 	checkSlow(CurrentLinkLine != nullptr);
 
-	// Iterator all the grid tiles, only the neighbor tile between the head can be selected
-	checkSlow(CurrentGrid != nullptr);
-	for (int32 i = 0; i < 36; i++)
+	// Sync the linked mask with the link line
+	BitBoard.ResetLinked();
+	for (const ASGTileBase* LinkedTile : CurrentLinkLine->LinkLineTiles)
 	{
-		const ASGTileBase* testTile = GetTileFromGridAddress(i);
-		checkSlow(testTile);
-		FMessage_Gameplay_TileLinkedStatusChange* SelectableMessage = new FMessage_Gameplay_TileLinkedStatusChange{ 0 };
-		SelectableMessage->TileID = testTile->GetTileID();
-		if (CurrentLinkLine->ContainsTileAddress(i) == true)
-		{
-			// Current line is linked
-			SelectableMessage->NewLinkStatus = true;
-			MessageEndpoint->Publish(SelectableMessage, EMessageScope::Process);
-		}
-		else
+		checkSlow(LinkedTile);
+		BitBoard.SetLinked(LinkedTile->GetGridAddress(), true);
+	}
+}
+
+void ASGGrid::PublishTileStatusChanges()
+{
+	// The changed addresses are the difference between the new status and the published status
+	SelectableChangeMask.CopyFrom(SelectableMask);
+	SelectableChangeMask ^= PublishedSelectableMask;
+	LinkedChangeMask.CopyFrom(BitBoard.GetLinkedMask());
+	LinkedChangeMask ^= PublishedLinkedMask;
+
+	StatusChangeMask.CopyFrom(SelectableChangeMask);
+	StatusChangeMask |= LinkedChangeMask;
+
+	const int32 StatusChangeNum = SelectableChangeMask.CountBits() + LinkedChangeMask.CountBits();
+	const int32 StatusMessageNum = EventBus != nullptr ? StatusChangeMask.CountBits() : 0;
+
+	// Before it was one selectable and one link message for every tile
+	DragRefreshNum++;
+	DragStatusMessageNum += StatusMessageNum;
+	DragSavedStatusMessageNum += GridTiles.Num() * 2 - StatusMessageNum;
+	INC_DWORD_STAT_BY(STAT_SGTileStatusChanges, StatusChangeNum);
+	INC_DWORD_STAT_BY(STAT_SGTileStatusMessagesPublished, StatusMessageNum);
+	INC_DWORD_STAT_BY(STAT_SGTileStatusMessagesSaved, GridTiles.Num() * 2 - StatusMessageNum);
+
+	if (StatusMessageNum > 0)
+	{
+		// One message for every changed tile, with only its own status
+		StatusChangeMask.ForEachSetBit([this](int32 GridAddress)
 		{
-			// Current line is not linked
-			SelectableMessage->NewLinkStatus = false;
-			MessageEndpoint->Publish(SelectableMessage, EMessageScope::Process);
-		}
+			ASGTileBase* ChangedTile = GridTiles[GridAddress];
+			checkSlow(ChangedTile);
+
+			FMessage_Gameplay_TileStatusChange StatusMessage;
+			StatusMessage.TileID = ChangedTile->GetTileID();
+			StatusMessage.bSelectableChanged = SelectableChangeMask.Test(GridAddress);
+			StatusMessage.NewSelectableStatus = SelectableMask.Test(GridAddress);
+			StatusMessage.bLinkedChanged = LinkedChangeMask.Test(GridAddress);
+			StatusMessage.NewLinkStatus = BitBoard.GetLinkedMask().Test(GridAddress);
+			EventBus->Send(StatusMessage, ChangedTile);
+		});
 	}
+
+	// Remember what the tiles show now
+	PublishedSelectableMask.CopyFrom(SelectableMask);
+	PublishedLinkedMask.CopyFrom(BitBoard.GetLinkedMask());
 }
 
 void ASGGrid::ResetTileLinkInfo()
 {
+	BitBoard.ResetLinked();
+	PublishedLinkedMask.Reset();
+
 	// Tell all the tiles that they can be selected
-	if (MessageEndpoint.IsValid() == true)
+	if (EventBus != nullptr)
 	{
-		FMessage_Gameplay_TileLinkedStatusChange* LinkStatusChangeMessage = new FMessage_Gameplay_TileLinkedStatusChange{ 0 };
+		FMessage_Gameplay_TileLinkedStatusChange LinkStatusChangeMessage;
 
 		// Set the target address to all
-		LinkStatusChangeMessage->TileID = -1;
-		LinkStatusChangeMessage->NewLinkStatus = false;
-		MessageEndpoint->Publish(LinkStatusChangeMessage, EMessageScope::Process);
+		LinkStatusChangeMessage.TileID = -1;
+		LinkStatusChangeMessage.NewLinkStatus = false;
+		EventBus->Publish(LinkStatusChangeMessage);
 	}
 }
\ No newline at end of file
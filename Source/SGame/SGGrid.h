@@ -5,14 +5,31 @@
 #include "GameFramework/Actor.h"
 
 #include "SGTileBase.h"
-#include "MessageEndpoint.h"
-#include "MessageEndpointBuilder.h"
 #include "SGameMessages.h"
+#include "SGGameplayEventBus.h"
 #include "SGLevelTileManager.h"
 #include "SGLinkLine.h"
+#include "SGBitBoard.h"
+#include "SGBoardGeometry.h"
+#include "SGTileStore.h"
+#include "SGLinkSolver.h"
+#include "SGLinkComponents.h"
 
 #include "SGGrid.generated.h"
 
+/** One tile move produced by the condense pass */
+struct FSGTileMove
+{
+	/** The moving tile */
+	ASGTileBase* Tile;
+
+	/** The old grid address */
+	int32 OldTileAddress;
+
+	/** The new grid address */
+	int32 NewTileAddress;
+};
+
 UCLASS()
 class SGAME_API ASGGrid : public AActor
 {
@@ -22,6 +39,9 @@ public:
 
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+
+	// Called when the level ends
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 	// Called every frame
 	virtual void Tick( float DeltaSeconds ) override;
@@ -47,6 +67,10 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Tile)
 	FVector GetLocationFromGridAddress(int32 GridAddress, bool bNeedYOffset = false);
 
+	/** Get the grid address under a world location, the depth is ignored. INDEX_NONE if it is off the board or in the gap out of the hit ratio of the tile size */
+	UFUNCTION(BlueprintCallable, Category = Tile)
+	int32 GetGridAddressFromLocation(const FVector& inWorldLocation, float inHitRatio = 1.0f) const;
+
 	/** Get a grid address relative to another grid address. Offset between addresses is measured in tiles. */
 	UFUNCTION(BlueprintCallable, Category = Tile)
 	bool GetGridAddressWithOffset(int32 InitialGridAddress, int32 XOffset, int32 YOffset, int32 &ReturnGridAddress);
@@ -60,12 +84,17 @@ public:
 	TArray<ASGTileBase*> GetTileSquareFromColumnAndRow(int32 inColumn, int32 inRow);
 
 	/** Take into the column and row, return the grid address*/
-	int32 ColumnRowToGridAddress(int columnIndex, int32 rowIndex)
+	int32 ColumnRowToGridAddress(int columnIndex, int32 rowIndex) const
 	{
-		checkSlow(columnIndex < GridWidth && rowIndex < GridHeight);
-		return (GridHeight - rowIndex - 1) * GridWidth + columnIndex;
+		return Geometry.ColumnRowToGridAddress(columnIndex, rowIndex);
 	}
 
+	/** Set by the game mode, the shortest link line the deadlock check and the board quality look for */
+	void SetMinimumLinkLineLength(int32 inMinimumLinkLineLength) { MinimumLinkLineLength = inMinimumLinkLineLength; }
+
+	/** Address tables and tile locations of the grid size, built on begin play */
+	const FSGBoardGeometry& GetGeometry() const { return Geometry; }
+
 	/** Helper to get tile manager */
 	ASGLevelTileManager* GetTileManager() const 
 	{  
@@ -73,6 +102,10 @@ public:
 		return LevelTileManager; 
 	}
 
+	int32 GetGridWidth() const { return GridWidth; }
+	int32 GetGridHeight() const { return GridHeight; }
+	const FVector2D& GetTileSize() const { return TileSize; }
+
 	/** Is some tile is moving */
 	UFUNCTION(BlueprintCallable, Category = Tile)
 	bool IsSomeTileFalling() { return CurrentFallingTileNum > 0; }
@@ -85,16 +118,56 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Grid)
 	void RefreshGridState();
 
+	/** Show the tile on the address as linked or not, only publish when the shown status changes */
+	UFUNCTION(BlueprintCallable, Category = Grid)
+	void SetTileLinkedStatus(int32 inGridAddress, bool bLinked);
+
 	// Start Attack, using BP function to implement, since it is more convenient to polish
 	UFUNCTION(BlueprintImplementableEvent)
 	void StartAttackFadeAnimation();
 
+	// Show the link hint from the first tile, using BP function to implement like the attack animation
+	UFUNCTION(BlueprintImplementableEvent)
+	void ShowLinkHint(const TArray<int32>& HintAddresses);
+
 	/** Calculate if the two address are neighbor, the link is 8 directions*/
 	UFUNCTION(BlueprintCallable, Category = Grid)
 	bool IsThreePointsSameLine(int32 Point1, int32 Point2, int32 Point3);
 
 	const TArray<ASGTileBase*>& GetGridTiles() { return GridTiles; }
 
+	/** How many tiles are in the linkable group of the tile on the address, for highlighting the groups */
+	UFUNCTION(BlueprintCallable, Category = Grid)
+	int32 GetLinkComponentSize(int32 GridAddress) const;
+
+	/** The addresses of the linkable group of the tile on the address, empty if the address is empty */
+	UFUNCTION(BlueprintCallable, Category = Grid)
+	TArray<int32> GetLinkComponentAddresses(int32 GridAddress) const;
+
+	/** The linkable groups of the tiles, updated after every refill */
+	const FSGLinkComponents& GetLinkComponents() const { return LinkComponents; }
+
+	/**
+	* Gravity pass of the condense, one sweep per column from bottom to top
+	*
+	* @param inGridTiles			the grid tiles, null means hole
+	* @param inGridWidth			the grid width
+	* @param inGridHeight			the grid height
+	* @param OutMoves				the tile moves, in the order they can be applied
+	* @param OutColumnRefillNums	how many tiles should be refilled on top of every column
+	*/
+	static void BuildCondenseMoveList(const TArray<ASGTileBase*>& inGridTiles, int32 inGridWidth, int32 inGridHeight, TArray<FSGTileMove>& OutMoves, TArray<int32>& OutColumnRefillNums);
+
+	/** Bitboard model of the grid tiles, for the fast link queries */
+	const FSGBitBoard& GetBitBoard() const { return BitBoard; }
+
+	/** Gameplay data of the grid tiles by the address, for the resource and damage sums */
+	FSGTileStore& GetTileStore() { return TileStore; }
+	const FSGTileStore& GetTileStore() const { return TileStore; }
+
+	/** Copy the grid tiles into the headless board state */
+	void BuildBoardState(FSGBoardState& OutBoardState) const;
+
 protected:
 	/** Contains the tile only on the grid */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
@@ -148,21 +221,102 @@ protected:
 	/** Actual level tile manager class for this grid*/
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TileManager)
 	ASGLevelTileManager* LevelTileManager;
+
+	/** How many shuffles to try on a board without any link line, the tiles are replaced after that */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Refill)
+	int32 MaxDeadlockReshuffleNum;
 private:
-	// Holds the messaging endpoint.
-	TSharedPtr<FMessageEndpoint, ESPMode::ThreadSafe> MessageEndpoint;
+	// Holds the gameplay event bus.
+	FSGGameplayEventBus* EventBus;
 
 	/** Handle tile grid event*/
-	void HandleTileArrayCollect(const FMessage_Gameplay_LinkedTilesCollect& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleTileArrayCollect(const FMessage_Gameplay_LinkedTilesCollect& Message);
 
-	/** Handle when some tile begin move, just increase the count*/
-	void HandleTileBeginMove(const FMessage_Gameplay_TileBeginMove& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	/** Send the move message to the tile and count it as falling */
+	void SendTileBeginMove(ASGTileBase* inTile, int32 inOldTileAddress, int32 inNewTileAddress);
 
 	/** Handle when some tile end move, just decrease the count*/
-	void HandleTileEndMove(const FMessage_Gameplay_TileEndMove& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleTileEndMove(const FMessage_Gameplay_TileEndMove& Message);
+
+	/** Check the board still has a link line after the refill, the dead board is reshuffled once the tiles stop */
+	void CheckDeadlock();
+
+	/** The shortest link line of the game mode, cached so the refill doesn't look up the game mode */
+	int32 MinimumLinkLineLength;
+
+	/** Shuffle the tiles until there is a link line, or replace them with new ones */
+	void ResolveDeadlock();
 
 	void UpdateTileSelectState();
 	void UpdateTileLinkState();
+
+	/** Publish the tiles whose status differs from the last published one, in one batched message */
+	void PublishTileStatusChanges();
 	
 	ASGLinkLine* CurrentLinkLine;
+
+	/** Bitboard kept in sync with the GridTiles */
+	FSGBitBoard BitBoard;
+
+	/** Tile data store kept in sync with the GridTiles */
+	FSGTileStore TileStore;
+
+	/** Place the new tile into the tile store, with the life of its archetype */
+	void SetStoreTile(int32 inGridAddress, const ASGTileBase* inTile);
+
+	/** The archetype of the tile on the board, with the life the tile store keeps on its address */
+	void BuildStoreBoardTile(int32 inGridAddress, const ASGTileBase* inTile, FSGBoardTile& OutBoardTile) const;
+
+	/** Geometry of the grid size, serves the address helpers */
+	FSGBoardGeometry Geometry;
+
+	/** Scratch mask for the selectable query, to avoid allocating every link step */
+	FSGBoardMask SelectableMask;
+
+	/** The selectable status last published to the tiles */
+	FSGBoardMask PublishedSelectableMask;
+
+	/** The link status last published to the tiles */
+	FSGBoardMask PublishedLinkedMask;
+
+	/** Scratch masks for the status changes, and the tiles with any change */
+	FSGBoardMask SelectableChangeMask;
+	FSGBoardMask LinkedChangeMask;
+	FSGBoardMask StatusChangeMask;
+
+	/** Grid state refresh num of the current drag */
+	int32 DragRefreshNum;
+
+	/** Tile status messages delivered in the current drag, one for every changed tile */
+	int32 DragStatusMessageNum;
+
+	/** Tile status messages saved in the current drag, compared to one message per tile per status */
+	int32 DragSavedStatusMessageNum;
+
+	/** Message payload heap allocations in the current drag, should stay 0 */
+	int32 DragMessageHeapAllocationNum;
+
+	/** Moves of the last condense, reused to avoid allocating every collect */
+	TArray<FSGTileMove> CondenseMoveList;
+
+	/** Refill num of every column of the last condense */
+	TArray<int32> ColumnRefillNums;
+
+	/** Finds the link lines on the bitboard, reused to keep its allocations */
+	FSGLinkSolver LinkSolver;
+
+	/** Bitboard of the shuffled tiles, tested before the tiles move */
+	FSGBitBoard ShuffleBitBoard;
+
+	/** The board has no link line, reshuffle when the tiles stop moving */
+	bool bDeadlockPending;
+
+	/** Linkable groups of the tiles */
+	FSGLinkComponents LinkComponents;
+
+	/** Addresses changed since the last group update, from the collect, the condense moves and the refill */
+	FSGBoardMask ComponentDirtyMask;
+
+	/** Label the groups again around the changed addresses, the board quality is only computed for the verbose log */
+	void UpdateLinkComponents();
 };
@@ -0,0 +1,399 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SGame.h"
+#include "SGHintSearch.h"
+
+DECLARE_CYCLE_STAT(TEXT("Hint Search"), STAT_SGHintSearch, STATGROUP_SGame);
+
+/** The hint results of one board, enough for the drags back and forth of a turn */
+static const int32 MaxCachedHintResultNum = 256;
+
+FSGHintSettings::FSGHintSettings()
+{
+	MinimumLength = 3;
+	MaxLength = 8;
+	MaxSearchStepNum = 100000;
+	for (int32 ResourceIndex = 0; ResourceIndex < static_cast<int32>(ESGResourceType::ETT_MAX); ResourceIndex++)
+	{
+		ResourceValues[ResourceIndex] = 1.0f;
+	}
+	DamageValue = 1.0f;
+	KillValue = 10.0f;
+}
+
+FSGHintResult::FSGHintResult()
+{
+	Reset();
+}
+
+void FSGHintResult::Reset()
+{
+	LinkAddresses.Reset();
+	Value = 0;
+	Resources.Reset();
+	Resources.AddZeroed(static_cast<int32>(ESGResourceType::ETT_MAX));
+	Damage = 0;
+	KillNum = 0;
+	bComplete = false;
+	BoardKey = 0;
+}
+
+FSGHintSearch::FSGHintSearch()
+{
+	KeyAddressNum = 0;
+	KeyTileTypeNum = 0;
+	CachedBoardKey = 0;
+	Board = nullptr;
+	BestValue = 0;
+	BestDamage = 0;
+	SearchStepNum = 0;
+	bSearchComplete = false;
+	bLastQueryCached = false;
+}
+
+void FSGHintSearch::InitKeys(int32 inAddressNum, int32 inTileTypeNum)
+{
+	if (inAddressNum <= KeyAddressNum && inTileTypeNum <= KeyTileTypeNum)
+	{
+		return;
+	}
+
+	// Fixed seed, the same board always gets the same key
+	KeyAddressNum = FMath::Max(inAddressNum, KeyAddressNum);
+	KeyTileTypeNum = FMath::Max(FMath::Max(inTileTypeNum, KeyTileTypeNum), 16);
+	FRandomStream KeyStream(0x5347);
+	auto NextKey = [&KeyStream]()
+	{
+		const uint64 HighBits = KeyStream.GetUnsignedInt();
+		const uint64 LowBits = KeyStream.GetUnsignedInt();
+		return (HighBits << 32) | LowBits;
+	};
+
+	TileTypeKeys.SetNumUninitialized(KeyAddressNum * KeyTileTypeNum);
+	for (uint64& Key : TileTypeKeys)
+	{
+		Key = NextKey();
+	}
+	TileLifeKeys.SetNumUninitialized(KeyAddressNum);
+	PathKeys.SetNumUninitialized(KeyAddressNum);
+	HeadKeys.SetNumUninitialized(KeyAddressNum);
+	for (int32 GridAddress = 0; GridAddress < KeyAddressNum; GridAddress++)
+	{
+		TileLifeKeys[GridAddress] = NextKey();
+		PathKeys[GridAddress] = NextKey();
+		HeadKeys[GridAddress] = NextKey();
+	}
+
+	// The old keys are gone
+	ResetCache();
+}
+
+uint64 FSGHintSearch::HashBoard(const FSGBoardState& inBoard)
+{
+	int32 TileTypeNum = 0;
+	for (int32 GridAddress = 0; GridAddress < inBoard.Num(); GridAddress++)
+	{
+		TileTypeNum = FMath::Max(TileTypeNum, inBoard.GetTile(GridAddress).TileTypeID + 1);
+	}
+	InitKeys(inBoard.Num(), TileTypeNum);
+
+	uint64 BoardKey = 0;
+	for (int32 GridAddress = 0; GridAddress < inBoard.Num(); GridAddress++)
+	{
+		const FSGBoardTile& Tile = inBoard.GetTile(GridAddress);
+		if (Tile.IsEmpty() == true)
+		{
+			continue;
+		}
+
+		BoardKey ^= TileTypeKeys[GridAddress * KeyTileTypeNum + Tile.TileTypeID];
+
+		// The damaged enemies may die from a different link damage
+		if (Tile.Abilities.bCanTakeDamage == true)
+		{
+			const uint64 LifeHash = HashCombine(GetTypeHash(Tile.LifeArmorInfo.CurrentLife), GetTypeHash(Tile.LifeArmorInfo.CurrentArmor));
+			BoardKey ^= TileLifeKeys[GridAddress] * (LifeHash * 2 + 1);
+		}
+	}
+	return BoardKey;
+}
+
+uint64 FSGHintSearch::HashLinkLine(const TArray<int32>& inLinkAddresses) const
+{
+	if (inLinkAddresses.Num() == 0)
+	{
+		return 0;
+	}
+
+	uint64 LinkLineKey = HeadKeys[inLinkAddresses.Last()];
+	for (const int32 GridAddress : inLinkAddresses)
+	{
+		LinkLineKey ^= PathKeys[GridAddress];
+	}
+	return LinkLineKey;
+}
+
+void FSGHintSearch::ResetCache()
+{
+	ResultCache.Reset();
+	CachedBoardKey = 0;
+}
+
+void FSGHintSearch::CacheResult(uint64 inQueryKey, const FSGHintResult& inResult)
+{
+	if (ResultCache.Num() >= MaxCachedHintResultNum)
+	{
+		ResultCache.Reset();
+	}
+	ResultCache.Add(inQueryKey, inResult);
+}
+
+bool FSGHintSearch::Search(const FSGBoardState& inBoard, const TArray<int32>& inPrefix, const FSGHintSettings& inSettings, FSGHintResult& OutResult)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SGHintSearch);
+
+	OutResult.Reset();
+	SearchStepNum = 0;
+	bLastQueryCached = false;
+	if (inPrefix.Num() > 0 && FSGBoardRules::IsValidLinkLine(inBoard, inPrefix, 0) == false)
+	{
+		return false;
+	}
+
+	const uint64 BoardKey = HashBoard(inBoard);
+	if (BoardKey != CachedBoardKey)
+	{
+		ResultCache.Reset();
+		CachedBoardKey = BoardKey;
+	}
+
+	// The cached line may have built the same tiles in another order, the player's order is kept
+	const uint64 QueryKey = HashLinkLine(inPrefix);
+	const FSGHintResult* CachedResult = ResultCache.Find(QueryKey);
+	if (CachedResult == nullptr && inPrefix.Num() > 0)
+	{
+		// The best line of the shorter link line is still the best one if the player follows it
+		const int32 HeadAddress = inPrefix.Last();
+		const uint64 ParentQueryKey = QueryKey ^ PathKeys[HeadAddress] ^ HeadKeys[HeadAddress] ^ (inPrefix.Num() > 1 ? HeadKeys[inPrefix[inPrefix.Num() - 2]] : 0);
+		const FSGHintResult* ParentResult = ResultCache.Find(ParentQueryKey);
+		if (ParentResult != nullptr && ParentResult->bComplete == true &&
+			ParentResult->LinkAddresses.Num() >= inPrefix.Num() && ParentResult->LinkAddresses[inPrefix.Num() - 1] == HeadAddress)
+		{
+			const FSGHintResult FollowedResult = *ParentResult;
+			CacheResult(QueryKey, FollowedResult);
+			CachedResult = ResultCache.Find(QueryKey);
+		}
+	}
+	if (CachedResult != nullptr)
+	{
+		OutResult = *CachedResult;
+		for (int32 i = 0; i < inPrefix.Num() && i < OutResult.LinkAddresses.Num(); i++)
+		{
+			OutResult.LinkAddresses[i] = inPrefix[i];
+		}
+		bLastQueryCached = true;
+		return OutResult.LinkAddresses.Num() > 0;
+	}
+
+	// Search the board
+	Board = &inBoard;
+	Settings = inSettings;
+	Solver.BuildFromBoardState(inBoard);
+	PathMask.Init(inBoard.Num());
+	PathAddresses.Reset();
+	TargetAddresses.Reset();
+	SourceDamageInfos.Reset();
+	PathResources.Reset();
+	PathResources.AddZeroed(static_cast<int32>(ESGResourceType::ETT_MAX));
+	BestAddresses.Reset();
+	BestValue = 0;
+	BestDamage = 0;
+	VisitedStates.Reset();
+	bSearchComplete = true;
+
+	if (inPrefix.Num() > 0)
+	{
+		for (const int32 GridAddress : inPrefix)
+		{
+			PushPathTile(GridAddress);
+		}
+		SearchFrom(inPrefix.Last(), QueryKey ^ HeadKeys[inPrefix.Last()]);
+	}
+	else
+	{
+		for (int32 GridAddress = 0; GridAddress < inBoard.Num(); GridAddress++)
+		{
+			if (inBoard.IsEmpty(GridAddress) == false)
+			{
+				PushPathTile(GridAddress);
+				SearchFrom(GridAddress, PathKeys[GridAddress]);
+				PopPathTile(GridAddress);
+			}
+		}
+	}
+	Board = nullptr;
+
+	OutResult.BoardKey = BoardKey;
+	OutResult.bComplete = bSearchComplete;
+	if (BestAddresses.Num() > 0)
+	{
+		OutResult.LinkAddresses = BestAddresses;
+		OutResult.Value = BestValue;
+		OutResult.Damage = BestDamage;
+
+		// Resolve the line on a copy like the game mode does, for the collected resources and the kills
+		FSGBoardState ResolvedBoard = inBoard;
+		FSGLinkResult LinkResult;
+		FSGBoardRules::ResolveLinkLine(ResolvedBoard, BestAddresses, LinkResult);
+		OutResult.Resources = LinkResult.Resources;
+		for (const int32 GridAddress : LinkResult.DamagedAddresses)
+		{
+			OutResult.KillNum += LinkResult.CollectedAddresses.Contains(GridAddress) ? 1 : 0;
+		}
+	}
+
+	CacheResult(QueryKey, OutResult);
+	return OutResult.LinkAddresses.Num() > 0;
+}
+
+void FSGHintSearch::SearchFrom(int32 inHeadAddress, uint64 inPathKey)
+{
+	if (SearchStepNum >= Settings.MaxSearchStepNum)
+	{
+		bSearchComplete = false;
+		return;
+	}
+	SearchStepNum++;
+
+	// The same tiles with the same head were searched in another order
+	bool bAlreadyVisited = false;
+	VisitedStates.Add(inPathKey ^ HeadKeys[inHeadAddress], &bAlreadyVisited);
+	if (bAlreadyVisited == true)
+	{
+		return;
+	}
+
+	if (PathAddresses.Num() >= Settings.MinimumLength)
+	{
+		EvaluatePath();
+	}
+	if (PathAddresses.Num() >= Settings.MaxLength)
+	{
+		return;
+	}
+
+	const FSGBoardMask& LinkableMask = Solver.GetLinkableMask(inHeadAddress);
+	for (int32 WordIndex = 0; WordIndex < LinkableMask.NumWords(); WordIndex++)
+	{
+		uint64 Word = LinkableMask.GetWord(WordIndex) & ~PathMask.GetWord(WordIndex);
+		while (Word != 0)
+		{
+			const int32 NextAddress = (WordIndex << 6) + FSGBoardMask::LowestBitIndex(Word);
+			Word &= Word - 1;
+
+			PushPathTile(NextAddress);
+			SearchFrom(NextAddress, inPathKey ^ PathKeys[NextAddress]);
+			PopPathTile(NextAddress);
+		}
+	}
+}
+
+void FSGHintSearch::PushPathTile(int32 inGridAddress)
+{
+	const FSGBoardTile& Tile = Board->GetTile(inGridAddress);
+	PathMask.Set(inGridAddress);
+	PathAddresses.Add(inGridAddress);
+	if (FSGBoardRules::IsLinkDamageTarget(Tile.Abilities) == true)
+	{
+		TargetAddresses.Add(inGridAddress);
+	}
+	else
+	{
+		FSGBoardRules::AddTileResources(Tile.Resources, PathResources);
+	}
+	if (FSGBoardRules::IsLinkDamageSource(Tile.Abilities) == true)
+	{
+		SourceDamageInfos.Add(Tile.CauseDamageInfo);
+	}
+}
+
+void FSGHintSearch::PopPathTile(int32 inGridAddress)
+{
+	const FSGBoardTile& Tile = Board->GetTile(inGridAddress);
+	PathMask.Clear(inGridAddress);
+	PathAddresses.Pop(false);
+	if (FSGBoardRules::IsLinkDamageTarget(Tile.Abilities) == true)
+	{
+		TargetAddresses.Pop(false);
+	}
+	else
+	{
+		for (const FTileResourceUnit& Resource : Tile.Resources)
+		{
+			PathResources[static_cast<int32>(Resource.ResourceType)] -= Resource.ResourceAmount;
+		}
+	}
+	if (FSGBoardRules::IsLinkDamageSource(Tile.Abilities) == true)
+	{
+		SourceDamageInfos.Pop(false);
+	}
+}
+
+void FSGHintSearch::EvaluatePath()
+{
+	float Value = 0;
+	for (int32 ResourceIndex = 0; ResourceIndex < PathResources.Num(); ResourceIndex++)
+	{
+		Value += PathResources[ResourceIndex] * Settings.ResourceValues[ResourceIndex];
+	}
+
+	// Same as the game mode, every enemy in the link line takes the damage of all the damage tiles
+	float Damage = 0;
+	if (TargetAddresses.Num() > 0)
+	{
+		for (const FTileDamageInfo& DamageInfo : SourceDamageInfos)
+		{
+			Damage += DamageInfo.InitialDamage;
+		}
+		Damage *= TargetAddresses.Num();
+		Value += Damage * Settings.DamageValue;
+
+		// The killed enemies are collected too
+		for (const int32 GridAddress : TargetAddresses)
+		{
+			const FSGBoardTile& Tile = Board->GetTile(GridAddress);
+			FTileLifeArmorInfo LifeArmorInfo = Tile.LifeArmorInfo;
+			if (FSGBoardRules::ApplyTileDamage(SourceDamageInfos, LifeArmorInfo) == true)
+			{
+				Value += Settings.KillValue;
+				for (const FTileResourceUnit& Resource : Tile.Resources)
+				{
+					Value += Resource.ResourceAmount * Settings.ResourceValues[static_cast<int32>(Resource.ResourceType)];
+				}
+			}
+		}
+	}
+
+	if (BestAddresses.Num() == 0 || Value > BestValue)
+	{
+		BestAddresses = PathAddresses;
+		BestValue = Value;
+		BestDamage = Damage;
+	}
+}
+
+FSGHintSearchTask::FSGHintSearchTask(FSGHintSearch* inSearch)
+	: BoardChecksum(0)
+	, SearchSeconds(0)
+	, Search(inSearch)
+{
+}
+
+void FSGHintSearchTask::DoWork()
+{
+	checkSlow(Search != nullptr);
+
+	const double StartTime = FPlatformTime::Seconds();
+	Search->Search(Board, Prefix, Settings, Result);
+	SearchSeconds = FPlatformTime::Seconds() - StartTime;
+}
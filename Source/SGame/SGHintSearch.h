@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SGame.h"
+#include "SGBoardRules.h"
+#include "SGLinkSolver.h"
+
+/** How the hint search values a link line */
+struct SGAME_API FSGHintSettings
+{
+	FSGHintSettings();
+
+	/** The shortest link line the player can collect */
+	int32 MinimumLength;
+
+	/** The longest link line to try, the search grows fast with the length */
+	int32 MaxLength;
+
+	/** Stop after this many search steps and return the best link line found so far */
+	int32 MaxSearchStepNum;
+
+	/** Value of one unit of every resource, using the resource type as index */
+	float ResourceValues[static_cast<int32>(ESGResourceType::ETT_MAX)];
+
+	/** Value of one damage point to one enemy */
+	float DamageValue;
+
+	/** Value of killing one enemy, the resources of the killed enemy count too */
+	float KillValue;
+};
+
+/** The best link line the hint search found */
+struct SGAME_API FSGHintResult
+{
+	FSGHintResult();
+
+	void Reset();
+
+	/** The link line from the first tile, empty if there is no link line */
+	TArray<int32> LinkAddresses;
+
+	float Value;
+
+	/** Collected resources including the killed enemies, using the resource type as index */
+	FSGMessageResourceArray Resources;
+
+	/** Link line damage times the enemies in the link line */
+	float Damage;
+
+	int32 KillNum;
+
+	/** Every link line within the max length was tried, false if the search ran out of steps */
+	bool bComplete;
+
+	/** Zobrist key of the searched board */
+	uint64 BoardKey;
+};
+
+/**
+ * Finds the most valuable link line on the board: the collected resources, the link damage and the killed enemies.
+ * The value of a link line only depends on its tiles, and the extensions only on its tiles and its head,
+ * so a search state reached again in another order is skipped through a Zobrist keyed transposition set.
+ * The results are cached by the board key and the built link line, the repeated queries during a drag are answered from the cache,
+ * and the player following the hint gets the same line without a search.
+ * Not thread safe, but a search can run on any thread.
+ */
+class SGAME_API FSGHintSearch
+{
+public:
+	FSGHintSearch();
+
+	/**
+	* Find the most valuable link line which starts with the built link line
+	*
+	* @param inBoard		the board, copied from the grid
+	* @param inPrefix		the link line the player has built, may be empty
+	* @param inSettings		the search limits and the values
+	* @param OutResult		the best link line
+	* @return false if there is no link line long enough
+	*/
+	bool Search(const FSGBoardState& inBoard, const TArray<int32>& inPrefix, const FSGHintSettings& inSettings, FSGHintResult& OutResult);
+
+	/** Zobrist key of the tile type and the life on every address */
+	uint64 HashBoard(const FSGBoardState& inBoard);
+
+	/** Forget the cached results */
+	void ResetCache();
+
+	/** How many search steps the last query took, 0 if it came from the cache */
+	int32 GetLastSearchStepNum() const { return SearchStepNum; }
+
+	/** Whether the last query came from the cache */
+	bool WasLastQueryCached() const { return bLastQueryCached; }
+
+private:
+	/** Make sure there are keys for the address num and the tile type ID */
+	void InitKeys(int32 inAddressNum, int32 inTileTypeNum);
+
+	/** Key of the built link line, the tiles and the head */
+	uint64 HashLinkLine(const TArray<int32>& inLinkAddresses) const;
+
+	/** Depth first search from the head of the path */
+	void SearchFrom(int32 inHeadAddress, uint64 inPathKey);
+
+	/** Add the tile to the path and its resources or damage to the sums */
+	void PushPathTile(int32 inGridAddress);
+	void PopPathTile(int32 inGridAddress);
+
+	/** Value the current path and keep it if it is the best */
+	void EvaluatePath();
+
+	/** Store the result, the cache is dropped when it grows too big */
+	void CacheResult(uint64 inQueryKey, const FSGHintResult& inResult);
+
+	/** Zobrist keys, one for every address and tile type ID, and one for the life of every address */
+	TArray<uint64> TileTypeKeys;
+	TArray<uint64> TileLifeKeys;
+
+	/** Keys of the addresses in the link line, and of the link line head */
+	TArray<uint64> PathKeys;
+	TArray<uint64> HeadKeys;
+
+	int32 KeyAddressNum;
+	int32 KeyTileTypeNum;
+
+	/** Results of the board with the CachedBoardKey, keyed by the built link line */
+	TMap<uint64, FSGHintResult> ResultCache;
+	uint64 CachedBoardKey;
+
+	/** Search states visited by the current search */
+	TSet<uint64> VisitedStates;
+
+	/** Linkable neighbor masks of the searched board */
+	FSGLinkSolver Solver;
+
+	/** State of the current search */
+	const FSGBoardState* Board;
+	FSGHintSettings Settings;
+	FSGBoardMask PathMask;
+	TArray<int32> PathAddresses;
+	TArray<int32, TInlineAllocator<16>> TargetAddresses;
+	FSGMessageDamageInfoArray SourceDamageInfos;
+	FSGMessageResourceArray PathResources;
+
+	/** Best path of the current search */
+	TArray<int32> BestAddresses;
+	float BestValue;
+	float BestDamage;
+
+	int32 SearchStepNum;
+	bool bSearchComplete;
+	bool bLastQueryCached;
+};
+
+/**
+ * Runs the hint search on a worker thread.
+ * The board and the built link line are copied in, so the game thread never waits for the search.
+ */
+class SGAME_API FSGHintSearchTask : public FNonAbandonableTask
+{
+	friend class FAsyncTask<FSGHintSearchTask>;
+
+public:
+	explicit FSGHintSearchTask(FSGHintSearch* inSearch);
+
+	void DoWork();
+
+	FORCEINLINE TStatId GetStatId() const
+	{
+		RETURN_QUICK_DECLARE_CYCLE_STAT(FSGHintSearchTask, STATGROUP_ThreadPoolAsyncTasks);
+	}
+
+	/** Input of the search, filled before the task starts */
+	FSGBoardState Board;
+	TArray<int32> Prefix;
+	FSGHintSettings Settings;
+
+	/** Checksum of the grid bitboard when the task started, to drop the result if the board changed */
+	uint32 BoardChecksum;
+
+	/** Output of the search, read after the task is done */
+	FSGHintResult Result;
+	double SearchSeconds;
+
+private:
+	FSGHintSearch* Search;
+};
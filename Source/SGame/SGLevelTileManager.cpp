@@ -3,7 +3,12 @@
 #include "SGame.h"
 #include "SGLevelTileManager.h"
 #include "PaperSpriteComponent.h"
+#include "Curves/CurveFloat.h"
 
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tile Pool Hits"), STAT_SGTilePoolHits, STATGROUP_SGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tile Pool Misses"), STAT_SGTilePoolMisses, STATGROUP_SGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Tiles"), STAT_SGPooledTiles, STATGROUP_SGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Tiles Peak"), STAT_SGPooledTilesPeak, STATGROUP_SGame);
 
 // Sets default values
 ASGLevelTileManager::ASGLevelTileManager()
@@ -11,6 +16,11 @@ ASGLevelTileManager::ASGLevelTileManager()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	RoundTableNum = 20;
+	PooledTileNum = 0;
+	PeakPooledTileNum = 0;
+	PoolHitNum = 0;
+	PoolMissNum = 0;
 }
 
 // Called when the game starts or when spawned
@@ -20,6 +30,19 @@ void ASGLevelTileManager::BeginPlay()
 
 	// Make sure the transient tiles is deleted!
 	AllTiles.Empty();
+	FreeTileSlots.Empty();
+	TileSlotSerials.Empty();
+	TilePools.Empty();
+
+	// Compile the library once, the draws only read the tables
+	CompileTileLibrary();
+}
+
+void ASGLevelTileManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UE_LOG(LogSGame, Log, TEXT("Tile pool: %d hits, %d misses, peak %d pooled tiles"), PoolHitNum, PoolMissNum, PeakPooledTileNum);
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -35,99 +58,244 @@ ASGTileBase* ASGLevelTileManager::CreateTile(AActor* inOwner, FVector SpawnLocat
 	checkSlow(TileLibrary[TileTypeID]);
 	checkSlow(TileLibrary[TileTypeID].TileClass);
 
+	const FSGTileType& TileType = TileLibrary[TileTypeID];
+	UClass* const TileClass = TileType.TileClass;
+
+	// Reuse the pooled tile first
+	ASGTileBase* NewTile = nullptr;
+	FSGTilePool* TilePool = TilePools.Find(TileClass);
+	if (TilePool != nullptr && TilePool->Tiles.Num() > 0)
+	{
+		NewTile = TilePool->Tiles.Pop(false);
+		NewTile->SetActorLocation(SpawnLocation, false, nullptr, ETeleportType::TeleportPhysics);
+		PooledTileNum--;
+		PoolHitNum++;
+		INC_DWORD_STAT(STAT_SGTilePoolHits);
+		SET_DWORD_STAT(STAT_SGPooledTiles, PooledTileNum);
+	}
+	else
+	{
+		NewTile = SpawnTile(inOwner, TileClass, SpawnLocation);
+		if (NewTile == nullptr)
+		{
+			return nullptr;
+		}
+		PoolMissNum++;
+		INC_DWORD_STAT(STAT_SGTilePoolMisses);
+	}
+
+	// The tile reads the shared archetype of the library entry, only its own state is reset
+	checkSlow(TileArchetypes.IsValidIndex(TileTypeID));
+	NewTile->State = FSGTileState();
+	NewTile->State.LifeArmorInfo = TileArchetypes[TileTypeID].LifeArmorInfo;
+
+	// Take a free slot in the global tile array
+	int32 TileSlot;
+	if (FreeTileSlots.Num() > 0)
+	{
+		TileSlot = FreeTileSlots.Pop(false);
+		TileSlotSerials[TileSlot] = (TileSlotSerials[TileSlot] + 1) & TileSerialMask;
+		AllTiles[TileSlot] = NewTile;
+	}
+	else
+	{
+		TileSlot = AllTiles.Add(NewTile);
+		TileSlotSerials.Add(0);
+		check(TileSlot <= TileSlotMask);
+	}
+
+	NewTile->TileTypeID = TileTypeID;
+	NewTile->SetGridAddress(SpawnGridAddress);
+	NewTile->SetTileID((TileSlotSerials[TileSlot] << TileSlotBits) | TileSlot);
+	NewTile->SetSpawnedRound(CurrentRound);
+
+	// Ready to receive the events
+	NewTile->ActivateTile();
+
+	return NewTile;
+}
+
+ASGTileBase* ASGLevelTileManager::SpawnTile(AActor* inOwner, UClass* inTileClass, const FVector& SpawnLocation)
+{
 	// Check for a valid World:
 	UWorld* const World = inOwner->GetWorld();
-	if (World)
+	if (World == nullptr)
 	{
-		// Set the spawn parameters.
-		FActorSpawnParameters SpawnParams;
-		SpawnParams.Owner = inOwner;
-		SpawnParams.Instigator = nullptr;
+		return nullptr;
+	}
 
-		// Tiles never rotate
-		FRotator SpawnRotation = FRotator(0.0f, 0.0f, 0.0f);
+	// Set the spawn parameters.
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Owner = inOwner;
+	SpawnParams.Instigator = nullptr;
 
-		// Spawn the tile.
-		ASGTileBase* const NewTile = World->SpawnActor<ASGTileBase>(TileLibrary[TileTypeID].TileClass, SpawnLocation, SpawnRotation, SpawnParams);
+	// Tiles never rotate
+	FRotator SpawnRotation = FRotator(0.0f, 0.0f, 0.0f);
 
-		// Override the base tile data and abilities
-		if (TileLibrary[TileTypeID].OverrideBaseAbilities == true)
-		{
-			NewTile->Abilities = TileLibrary[TileTypeID].Abilities;
-		}
-		if (TileLibrary[TileTypeID].OverrideBaseData == true)
-		{
-			NewTile->Data = TileLibrary[TileTypeID].Data;
-		}
+	// Spawn the tile.
+	ASGTileBase* const NewTile = World->SpawnActor<ASGTileBase>(inTileClass, SpawnLocation, SpawnRotation, SpawnParams);
+	if (NewTile == nullptr)
+	{
+		return nullptr;
+	}
 
-		// Of course we want to move the tile
-		NewTile->GetRenderComponent()->SetMobility(EComponentMobility::Movable);
+	// Of course we want to move the tile
+	NewTile->GetRenderComponent()->SetMobility(EComponentMobility::Movable);
 
-		NewTile->TileTypeID = TileTypeID;
-		NewTile->SetGridAddress(SpawnGridAddress);
-		NewTile->SetTileID(NextTileID);
-		NewTile->SetSpawnedRound(CurrentRound);
+	return NewTile;
+}
 
-		check(NextTileID < INTMAX_MAX - 1);
-		NextTileID++;
+void ASGLevelTileManager::AddTileToPool(ASGTileBase* inTile)
+{
+	TilePools.FindOrAdd(inTile->GetClass()).Tiles.Push(inTile);
+	PooledTileNum++;
+	PeakPooledTileNum = FMath::Max(PeakPooledTileNum, PooledTileNum);
+	SET_DWORD_STAT(STAT_SGPooledTiles, PooledTileNum);
+	SET_DWORD_STAT(STAT_SGPooledTilesPeak, PeakPooledTileNum);
+}
 
-		// Add the gamemode to the global tile array
-		AllTiles.AddUnique(NewTile);
+void ASGLevelTileManager::PrewarmTilePool(AActor* inOwner, int32 inTileNum)
+{
+	checkSlow(inOwner);
 
-		// Cache the world pointter for delete the tile
-		CachedWorld = World;
+	// Sum up the probability of every tile class, the same class may appear in several library entries
+	float TotalProbability = 0;
+	TMap<UClass*, float> ClassProbabilities;
+	for (const FSGTileType& TileType : TileLibrary)
+	{
+		if (TileType.TileClass != nullptr && TileType.Probability > 0)
+		{
+			ClassProbabilities.FindOrAdd(TileType.TileClass) += TileType.Probability;
+			TotalProbability += TileType.Probability;
+		}
+	}
+	if (TotalProbability <= 0)
+	{
+		return;
+	}
 
-		return NewTile;
+	// The board holds the expected share of every class, the unlucky refills spawn the rest
+	for (const TPair<UClass*, float>& ClassProbability : ClassProbabilities)
+	{
+		const int32 PrewarmNum = FMath::CeilToInt(inTileNum * ClassProbability.Value / TotalProbability);
+		const FSGTilePool* TilePool = TilePools.Find(ClassProbability.Key);
+		for (int32 i = TilePool != nullptr ? TilePool->Tiles.Num() : 0; i < PrewarmNum; i++)
+		{
+			ASGTileBase* NewTile = SpawnTile(inOwner, ClassProbability.Key, inOwner->GetActorLocation());
+			if (NewTile == nullptr)
+			{
+				UE_LOG(LogSGame, Warning, TEXT("Cannot prewarm the tile class %s"), *ClassProbability.Key->GetName());
+				break;
+			}
+			NewTile->DeactivateTile();
+			AddTileToPool(NewTile);
+		}
+	}
+
+	UE_LOG(LogSGame, Log, TEXT("Prewarmed %d tiles for %d tile classes"), PooledTileNum, ClassProbabilities.Num());
+}
+
+int32 ASGLevelTileManager::SelectTileFromLibrary(FRandomStream& RandomStream, int32 inRound)
+{
+	if (RoundTileTables.Num() == 0)
+	{
+		CompileTileLibrary();
 	}
 
-	return nullptr;
+	return GetRoundTileTable(inRound).Draw(RandomStream);
+}
+
+void ASGLevelTileManager::CompileTileLibrary()
+{
+	BuildRoundTileTables(RoundTileTables);
+	BuildTileArchetypes(TileArchetypes);
 }
 
-int32 ASGLevelTileManager::SelectTileFromLibrary()
+void ASGLevelTileManager::BuildRoundTileTables(TArray<FSGAliasTable>& OutRoundTileTables) const
 {
-	float NormalizingFactor = 0;
-	for (auto& TileBase : TileLibrary)
+	bool bHasRoundCurve = false;
+	for (const FSGTileType& TileType : TileLibrary)
 	{
-		NormalizingFactor += TileBase.Probability;
+		bHasRoundCurve |= (TileType.RoundProbabilityCurve != nullptr);
 	}
-	float TestNumber = FMath::FRandRange(0.0f, NormalizingFactor);
-	float CompareTo = 0;
-	for (int32 ArrayChecked = 0; ArrayChecked != TileLibrary.Num(); ArrayChecked++)
+
+	// Evaluate the curves once for every round here, not for every draw
+	const int32 TableNum = bHasRoundCurve ? FMath::Max(RoundTableNum, 0) + 1 : 1;
+	OutRoundTileTables.Reset();
+	OutRoundTileTables.SetNum(TableNum);
+	TArray<float> Weights;
+	Weights.SetNumUninitialized(TileLibrary.Num());
+	for (int32 Round = 0; Round < TableNum; Round++)
 	{
-		CompareTo += TileLibrary[ArrayChecked].Probability;
-		if (TestNumber <= CompareTo)
+		for (int32 i = 0; i < TileLibrary.Num(); i++)
 		{
-			return ArrayChecked;
+			const FSGTileType& TileType = TileLibrary[i];
+			Weights[i] = TileType.Probability;
+			if (TileType.RoundProbabilityCurve != nullptr)
+			{
+				Weights[i] *= TileType.RoundProbabilityCurve->GetFloatValue(Round);
+			}
+		}
+
+		if (OutRoundTileTables[Round].Build(Weights) == false)
+		{
+			UE_LOG(LogSGame, Warning, TEXT("No tile in the library can be picked in round %d, the first tile type is used"), Round);
 		}
 	}
-	return 0;
 }
 
-bool ASGLevelTileManager::DestroyTileWithID(int32 TileIDToDelete)
+void ASGLevelTileManager::BuildTileArchetypes(TArray<FSGBoardTile>& OutTileArchetypes) const
 {
-	checkSlow(CachedWorld);
-
-	ASGTileBase* TileToDelete = nullptr;
-	for (int i = 0; i < AllTiles.Num(); i++)
+	OutTileArchetypes.Reset();
+	OutTileArchetypes.SetNum(TileLibrary.Num());
+	for (int32 i = 0; i < TileLibrary.Num(); i++)
 	{
-		checkSlow(AllTiles[i] != nullptr);
-		if (AllTiles[i]->GetTileID() == TileIDToDelete)
+		const FSGTileType& TileType = TileLibrary[i];
+		if (TileType.TileClass == nullptr)
 		{
-			TileToDelete = AllTiles[i];
-			break;
+			continue;
 		}
+
+		// The library entry overrides the class defaults
+		const ASGTileBase* TileDefaults = TileType.TileClass->GetDefaultObject<ASGTileBase>();
+		const FSGTileData& TileData = TileType.OverrideBaseData ? TileType.Data : TileDefaults->Data;
+		FSGBoardTile& Archetype = OutTileArchetypes[i];
+		Archetype.TileTypeID = i;
+		Archetype.TileType = TileData.TileType;
+		Archetype.Abilities = TileType.OverrideBaseAbilities ? TileType.Abilities : TileDefaults->Abilities;
+		Archetype.CauseDamageInfo = TileData.CauseDamageInfo;
+		Archetype.LifeArmorInfo = TileData.LifeArmorInfo;
+		Archetype.Resources.Append(TileData.TileResourceArray);
 	}
+}
+
+#if WITH_EDITOR
+void ASGLevelTileManager::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// Recompile when the library is edited, the draw tables and the archetypes must stay in step
+	CompileTileLibrary();
+}
+#endif
+
+bool ASGLevelTileManager::DestroyTileWithID(int32 TileIDToDelete)
+{
+	ASGTileBase* TileToDelete = GetTileFromTileID(TileIDToDelete);
 	if (TileToDelete == nullptr)
 	{
 		UE_LOG(LogSGame, Warning, TEXT("Cannot find tile id %d in the global tile array"), TileIDToDelete);
 		return false;
 	}
 
-	// Destroy the tile actor
-	CachedWorld->DestroyActor(TileToDelete);
+	// Keep the tile actor for the next refill
+	TileToDelete->DeactivateTile();
+	AddTileToPool(TileToDelete);
 
-	// Move it out of global tile array
-	AllTiles.Remove(TileToDelete);
+	// Move it out of global tile array, and free the slot for the next tile
+	const int32 TileSlot = TileIDToDelete & TileSlotMask;
+	AllTiles[TileSlot] = nullptr;
+	FreeTileSlots.Push(TileSlot);
 
 	return true;
 }
@@ -4,9 +4,20 @@
 
 #include "GameFramework/Actor.h"
 #include "SGTileBase.h"
+#include "SGAliasTable.h"
 
 #include "SGLevelTileManager.generated.h"
 
+/** The deactivated tiles of one tile class, ready for reuse */
+USTRUCT()
+struct FSGTilePool
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	TArray<ASGTileBase*> Tiles;
+};
+
 UCLASS()
 class SGAME_API ASGLevelTileManager : public AActor
 {
@@ -19,24 +30,132 @@ public:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 	
+	// Called when the level ends
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	// Called every frame
 	virtual void Tick( float DeltaSeconds ) override;
 
+	/** Take a tile of the tile type from the pool, or spawn one when the pool is empty */
 	ASGTileBase* CreateTile(AActor* inOwner, FVector SpawnLocation, int32 SpawnGridAddress, int32 TileTypeID, int32 CurrentRound);
-	int32 SelectTileFromLibrary();
+
+	/**
+	* Draw a tile type from the library, in constant time
+	*
+	* @param RandomStream	the stream to draw from, the same stream state gives the same tile type
+	* @param inRound		the round, picks the table of the round probability curves
+	* @return the index in the tile library
+	*/
+	int32 SelectTileFromLibrary(FRandomStream& RandomStream, int32 inRound);
+
+	/** Compile the tile library into the alias tables and the tile archetypes, call it after changing the library */
+	UFUNCTION(BlueprintCallable, Category = TileManager)
+	void CompileTileLibrary();
+
+	/** Compile the tile library into the given tables, one for every round from round 0, or a single table without the round curves */
+	void BuildRoundTileTables(TArray<FSGAliasTable>& OutRoundTileTables) const;
+
+	/** The alias table used for the round */
+	const FSGAliasTable& GetRoundTileTable(int32 inRound) const
+	{
+		checkSlow(RoundTileTables.Num() > 0);
+		return RoundTileTables[FMath::Clamp(inRound, 0, RoundTileTables.Num() - 1)];
+	}
+
+	/** The board tile every library entry creates, indexed like the library, for the headless board simulation */
+	void BuildTileArchetypes(TArray<FSGBoardTile>& OutTileArchetypes) const;
+
+	/** The compiled archetype of the library entry, shared by all the tiles of the entry */
+	const FSGBoardTile& GetTileArchetype(int32 inTileTypeID) const
+	{
+		checkSlow(TileArchetypes.IsValidIndex(inTileTypeID));
+		return TileArchetypes[inTileTypeID];
+	}
+
+	/** Deactivate the tile and put it back to the pool of its class */
 	bool DestroyTileWithID(int32 TileIDToDelete);
 
+	/**
+	* Spawn the deactivated tiles before the game needs them, every tile class gets its share by the library probability
+	*
+	* @param inOwner	the owner of the tiles, the grid
+	* @param inTileNum	how many tiles are on the board at the same time
+	*/
+	void PrewarmTilePool(AActor* inOwner, int32 inTileNum);
+
+	/** Pool statistics */
+	int32 GetPoolHitNum() const { return PoolHitNum; }
+	int32 GetPoolMissNum() const { return PoolMissNum; }
+	int32 GetPeakPooledTileNum() const { return PeakPooledTileNum; }
+
+	/** Get the tile by the tile id, return null if the tile is already destroyed */
+	ASGTileBase* GetTileFromTileID(int32 inTileID) const
+	{
+		const int32 TileSlot = inTileID & TileSlotMask;
+		if (inTileID < 0 || AllTiles.IsValidIndex(TileSlot) == false)
+		{
+			return nullptr;
+		}
+
+		// The slot may be reused by another tile, the serial in the id tells
+		ASGTileBase* Tile = AllTiles[TileSlot];
+		return (Tile != nullptr && Tile->GetTileID() == inTileID) ? Tile : nullptr;
+	}
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TileManager)
 	TArray<FSGTileType> TileLibrary;
 
+	/** Rounds with their own precomputed table when the library has round probability curves, the later rounds use the last table */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TileManager)
+	int32 RoundTableNum;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
 	void Initialize();
 
 protected:
-	/** Contains all the tiles in the game, including the disappering tiles */
+	/** 
+	 * Contains all the tiles in the game, including the disappering tiles.
+	 * Indexed by the tile slot, the destroyed tile leaves a null slot for reuse
+	 */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 	TArray<ASGTileBase*> AllTiles;
 
+	/** The deactivated tiles, by the tile class */
+	UPROPERTY()
+	TMap<UClass*, FSGTilePool> TilePools;
+
 private:
-	int32		NextTileID;
-	UWorld*		CachedWorld;
+	/** The tile id is made of the slot serial and the slot index in AllTiles */
+	static const int32 TileSlotBits = 16;
+	static const int32 TileSlotMask = (1 << TileSlotBits) - 1;
+	static const int32 TileSerialMask = 0x7FFF;
+
+	/** The compiled tile library, one table for every round from round 0, or a single table without the round curves */
+	TArray<FSGAliasTable> RoundTileTables;
+
+	/** The compiled tile data of every library entry, the tiles keep only their changing state */
+	TArray<FSGBoardTile> TileArchetypes;
+
+	/** Free slots in AllTiles */
+	TArray<int32> FreeTileSlots;
+
+	/** How many times every slot has been used, so the reused slot gets a new tile id */
+	TArray<uint16> TileSlotSerials;
+
+	/** Spawn a new tile actor, it is activated by the caller */
+	ASGTileBase* SpawnTile(AActor* inOwner, UClass* inTileClass, const FVector& SpawnLocation);
+
+	/** Put the deactivated tile into the pool */
+	void AddTileToPool(ASGTileBase* inTile);
+
+	/** Tiles in all the pools now, and the peak of it */
+	int32 PooledTileNum;
+	int32 PeakPooledTileNum;
+
+	/** Tiles taken from the pool, and the tiles spawned because the pool was empty */
+	int32 PoolHitNum;
+	int32 PoolMissNum;
 };
@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SGame.h"
+#include "SGLinkComponents.h"
+
+FSGLinkComponents::FSGLinkComponents()
+{
+	ComponentNum = 0;
+	LastLabelledNum = 0;
+}
+
+void FSGLinkComponents::Build(const FSGBitBoard& inBitBoard)
+{
+	const int32 AddressNum = inBitBoard.GetGridWidth() * inBitBoard.GetGridHeight();
+	Labels.Init(INDEX_NONE, AddressNum);
+	ComponentMasks.Reset();
+	ComponentSizes.Reset();
+	FreeComponentIDs.Reset();
+	ComponentNum = 0;
+	LastLabelledNum = 0;
+
+	RelabelMask.Init(AddressNum);
+	FrontierMask.Init(AddressNum);
+	NextFrontierMask.Init(AddressNum);
+	NeighborMask.Init(AddressNum);
+
+	inBitBoard.GetOccupiedMask().ForEachSetBit([this, &inBitBoard](int32 GridAddress)
+	{
+		if (Labels[GridAddress] == INDEX_NONE)
+		{
+			FloodComponent(inBitBoard, GridAddress);
+		}
+	});
+}
+
+void FSGLinkComponents::Update(const FSGBitBoard& inBitBoard, const FSGBoardMask& inDirtyMask)
+{
+	if (Labels.Num() != inDirtyMask.Num())
+	{
+		Build(inBitBoard);
+		return;
+	}
+	LastLabelledNum = 0;
+
+	// The groups touching the changes may split, forget them and label their tiles again
+	RelabelMask.CopyFrom(inDirtyMask);
+	inDirtyMask.ForEachSetBit([this](int32 GridAddress)
+	{
+		const int32 ComponentID = Labels[GridAddress];
+		if (ComponentID != INDEX_NONE && ComponentSizes[ComponentID] > 0)
+		{
+			RelabelMask |= ComponentMasks[ComponentID];
+			FreeComponent(ComponentID);
+		}
+	});
+	RelabelMask.ForEachSetBit([this](int32 GridAddress)
+	{
+		Labels[GridAddress] = INDEX_NONE;
+	});
+
+	// The new groups may also merge the untouched groups next to the changes, the flood fill takes them in
+	RelabelMask &= inBitBoard.GetOccupiedMask();
+	RelabelMask.ForEachSetBit([this, &inBitBoard](int32 GridAddress)
+	{
+		if (Labels[GridAddress] == INDEX_NONE)
+		{
+			FloodComponent(inBitBoard, GridAddress);
+		}
+	});
+}
+
+void FSGLinkComponents::FloodComponent(const FSGBitBoard& inBitBoard, int32 inSeedAddress)
+{
+	const int32 ComponentID = AllocateComponent(Labels.Num());
+	FSGBoardMask& ComponentMask = ComponentMasks[ComponentID];
+
+	ComponentMask.Set(inSeedAddress);
+	FrontierMask.Reset();
+	FrontierMask.Set(inSeedAddress);
+	while (FrontierMask.IsEmpty() == false)
+	{
+		NextFrontierMask.Reset();
+		FrontierMask.ForEachSetBit([this, &inBitBoard, ComponentID](int32 GridAddress)
+		{
+			// An untouched group reached by the flood is merged into the new one
+			const int32 OldComponentID = Labels[GridAddress];
+			if (OldComponentID != INDEX_NONE && OldComponentID != ComponentID && ComponentSizes[OldComponentID] > 0)
+			{
+				FreeComponent(OldComponentID);
+			}
+			Labels[GridAddress] = ComponentID;
+			LastLabelledNum++;
+
+			// The linkable neighbors, the link rule is symmetric so they link back
+			inBitBoard.BuildSelectableMask(GridAddress, NeighborMask);
+			NextFrontierMask |= NeighborMask;
+		});
+
+		// Only the addresses not in the group yet
+		for (int32 WordIndex = 0; WordIndex < NextFrontierMask.NumWords(); WordIndex++)
+		{
+			NextFrontierMask.SetWord(WordIndex, NextFrontierMask.GetWord(WordIndex) & ~ComponentMask.GetWord(WordIndex));
+		}
+		ComponentMask |= NextFrontierMask;
+		FrontierMask.CopyFrom(NextFrontierMask);
+	}
+
+	ComponentSizes[ComponentID] = ComponentMask.CountBits();
+}
+
+int32 FSGLinkComponents::AllocateComponent(int32 inAddressNum)
+{
+	int32 ComponentID;
+	if (FreeComponentIDs.Num() > 0)
+	{
+		ComponentID = FreeComponentIDs.Pop(false);
+		ComponentMasks[ComponentID].Reset();
+	}
+	else
+	{
+		ComponentID = ComponentMasks.Add(FSGBoardMask(inAddressNum));
+		ComponentSizes.Add(0);
+	}
+
+	ComponentNum++;
+	return ComponentID;
+}
+
+void FSGLinkComponents::FreeComponent(int32 ComponentID)
+{
+	checkSlow(ComponentSizes[ComponentID] > 0);
+	ComponentSizes[ComponentID] = 0;
+	FreeComponentIDs.Push(ComponentID);
+	ComponentNum--;
+}
+
+int32 FSGLinkComponents::GetLargestComponentSize() const
+{
+	int32 LargestSize = 0;
+	for (int32 Size : ComponentSizes)
+	{
+		LargestSize = FMath::Max(LargestSize, Size);
+	}
+	return LargestSize;
+}
+
+int32 FSGLinkComponents::CountTilesInComponents(int32 inMinimumSize) const
+{
+	int32 TileNum = 0;
+	for (int32 Size : ComponentSizes)
+	{
+		if (Size >= inMinimumSize)
+		{
+			TileNum += Size;
+		}
+	}
+	return TileNum;
+}
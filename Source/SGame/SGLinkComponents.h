@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SGame.h"
+#include "SGBitBoard.h"
+
+/**
+ * Labels the 8 connected groups of tiles which can link to each other, same type tiles and the enemy bridges of the bCanLinkEnemy tiles.
+ * The labels are updated from the changed addresses after every condense and refill,
+ * only the groups touching the changes are labelled again, the others keep their labels.
+ * The group of an address, its size and its members are answered without walking the board.
+ */
+class SGAME_API FSGLinkComponents
+{
+public:
+	FSGLinkComponents();
+
+	/** Label the whole board */
+	void Build(const FSGBitBoard& inBitBoard);
+
+	/**
+	* Label the groups again around the changed addresses
+	*
+	* @param inBitBoard		the board after the change
+	* @param inDirtyMask	every address whose tile was removed, moved away, moved in or refilled, the labels still describe the board before the change
+	*/
+	void Update(const FSGBitBoard& inBitBoard, const FSGBoardMask& inDirtyMask);
+
+	/** The group of the tile on the address, INDEX_NONE if the address is empty */
+	int32 GetComponent(int32 GridAddress) const { return Labels[GridAddress]; }
+
+	/** How many tiles are in the group of the address, 0 if the address is empty */
+	int32 GetComponentSize(int32 GridAddress) const
+	{
+		return Labels[GridAddress] != INDEX_NONE ? ComponentSizes[Labels[GridAddress]] : 0;
+	}
+
+	/** The member addresses of the group */
+	const FSGBoardMask& GetComponentMask(int32 ComponentID) const
+	{
+		checkSlow(ComponentSizes.IsValidIndex(ComponentID) && ComponentSizes[ComponentID] > 0);
+		return ComponentMasks[ComponentID];
+	}
+
+	/** Whether the two tiles are in the same group */
+	bool AreConnected(int32 GridAddressA, int32 GridAddressB) const
+	{
+		return Labels[GridAddressA] != INDEX_NONE && Labels[GridAddressA] == Labels[GridAddressB];
+	}
+
+	int32 GetComponentNum() const { return ComponentNum; }
+
+	/** Size of the biggest group */
+	int32 GetLargestComponentSize() const;
+
+	/** Tiles in the groups at least as big as the size, the board quality for the link line length */
+	int32 CountTilesInComponents(int32 inMinimumSize) const;
+
+	/** How many addresses the last build or update labelled */
+	int32 GetLastLabelledNum() const { return LastLabelledNum; }
+
+private:
+	/** Label the group of the seed address with a new group */
+	void FloodComponent(const FSGBitBoard& inBitBoard, int32 inSeedAddress);
+
+	int32 AllocateComponent(int32 inAddressNum);
+	void FreeComponent(int32 ComponentID);
+
+	/** Group of every address */
+	TArray<int32> Labels;
+
+	/** Members and size of every group, the freed groups have size 0 */
+	TArray<FSGBoardMask> ComponentMasks;
+	TArray<int32> ComponentSizes;
+	TArray<int32> FreeComponentIDs;
+	int32 ComponentNum;
+
+	int32 LastLabelledNum;
+
+	/** Scratch masks of the update and the flood fill */
+	FSGBoardMask RelabelMask;
+	FSGBoardMask FrontierMask;
+	FSGBoardMask NextFrontierMask;
+	FSGBoardMask NeighborMask;
+};
@@ -4,6 +4,7 @@
 #include "SGGameMode.h"
 #include "SGLinkLine.h"
 #include "SGEnemyTileBase.h"
+#include "SGGlobalGameInstance.h"
 #include "Math/UnrealMathUtility.h"
 
 // Sets default values
@@ -25,7 +26,23 @@ ASGLinkLine::ASGLinkLine()
 	TailSpriteRenderComponent->AttachToComponent(RootComponent, FAttachmentTransformRules::KeepRelativeTransform);
 	TailSpriteRenderComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
+	BodySpriteRenderComponent = CreateDefaultSubobject<UPaperGroupedSpriteComponent>(TEXT("LinkLineSpriteComponent-Body"));
+	BodySpriteRenderComponent->Mobility = EComponentMobility::Movable;
+	BodySpriteRenderComponent->AttachToComponent(RootComponent, FAttachmentTransformRules::KeepRelativeTransform);
+	BodySpriteRenderComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	BodyInstanceNum = 0;
+	FirstDirtyLinePoint = 0;
+
+	RibbonSamplesPerTile = 8;
+	RibbonHeadSpeed = 2000.0f;
+	RibbonSampleSpacing = 0.0f;
+	RibbonLength = 0.0f;
+	NextRibbonHit = 0;
+	RibbonHeadDistance = 0.0f;
+
 	LinkLineMode = ELinkLineMode::ELLM_Sprite;
+	LinkLineScale = 1.5f;
+	EventBus = nullptr;
 }
 
 // Called when the game starts or when spawned
@@ -39,8 +56,8 @@ void ASGLinkLine::BeginPlay()
 		return;
 	}
 
-	// Build the link line message endpoint
-	MessageEndpoint = FMessageEndpoint::Builder("Gameplay_LinkLine");
+	// Get the gameplay event bus
+	EventBus = USGGlobalGameInstance::GetEventBus(this);
 
 	// Find the grid actor in the world
 	ParentGrid = nullptr;
@@ -82,6 +99,11 @@ void ASGLinkLine::BeginPlay()
 void ASGLinkLine::Tick( float DeltaTime )
 {
 	Super::Tick( DeltaTime );
+
+	if (LinkLineMode == ELinkLineMode::ELLM_Ribbon && RibbonHeadDistance < RibbonLength)
+	{
+		MoveRibbonHead(RibbonHeadSpeed * DeltaTime);
+	}
 }
 
 bool ASGLinkLine::UpdateLinkLineDisplay()
@@ -95,7 +117,17 @@ bool ASGLinkLine::UpdateLinkLineDisplay()
 	switch (LinkLineMode)
 	{
 	case ELinkLineMode::ELLM_Sprite:
-		bIsStaticLine == true ? UpdateLinkLineSprites(StaticLinePoints) : UpdateLinkLineSprites(LinkLinePoints);
+		if (bIsStaticLine == true)
+		{
+			// The static line is edited directly, draw it from the first point and don't keep it for the link line
+			UpdateLinkLineSprites(StaticLinePoints, 0);
+			FirstDirtyLinePoint = 0;
+		}
+		else
+		{
+			UpdateLinkLineSprites(LinkLinePoints, FirstDirtyLinePoint);
+			FirstDirtyLinePoint = MAX_int32;
+		}
 		break;
 	case ELinkLineMode::ELLM_Ribbon:
 		bIsStaticLine == true ? UpdateLinkLineRibbon(StaticLinePoints) : UpdateLinkLineRibbon(LinkLinePoints);
@@ -108,19 +140,9 @@ bool ASGLinkLine::UpdateLinkLineDisplay()
 	return true;
 }
 
-bool ASGLinkLine::UpdateLinkLineSprites(const TArray<int32>& LinePoints)
+bool ASGLinkLine::UpdateLinkLineSprites(TArrayView<const int32> LinePoints, int32 inFirstDirtyPoint)
 {
-	// Clean the body sprites
-	for (int32 i = 0; i < LinkLineSpriteRendererArray.Num(); i++)
-	{
-		checkSlow(LinkLineSpriteRendererArray[i] != nullptr);
-		// Detach the component
-		LinkLineSpriteRendererArray[i]->DetachFromComponent(FDetachmentTransformRules::KeepRelativeTransform);
-		LinkLineSpriteRendererArray[i]->UnregisterComponent();
-	}
-	LinkLineSpriteRendererArray.Empty();
-
-	if (LinkLinePoints.Num() < 2)
+	if (LinePoints.Num() < 2)
 	{
 		// Only one point cannot become a link line
 
@@ -128,6 +150,12 @@ bool ASGLinkLine::UpdateLinkLineSprites(const TArray<int32>& LinePoints)
 		HeadSpriteRenderComponent->SetVisibility(false);
 		TailSpriteRenderComponent->SetVisibility(false);
 
+		// Nothing drawn to keep
+		DrawnSegmentAngles.Reset();
+		DrawnBodyInstanceEnds.Reset();
+		BodyInstanceNum = 0;
+		FinishBodyInstances();
+
 		return true;
 	}
 	else
@@ -137,153 +165,316 @@ bool ASGLinkLine::UpdateLinkLineSprites(const TArray<int32>& LinePoints)
 		TailSpriteRenderComponent->SetVisibility(true);
 	}
 
-	// The link line should scale to 1.5 to fit the grid
-	RootComponent->SetWorldScale3D(FVector(1.5f, 1.5f, 1.5f));
+	// The link line should scale to fit the grid
+	RootComponent->SetWorldScale3D(FVector(LinkLineScale, LinkLineScale, LinkLineScale));
 
-	// Iterate all points, and generate line between the two points
-	ELinkDirection LastDirection = ELinkDirection::ELD_Begin;
-	for (int32 i = 0; i < LinePoints.Num(); i++)
+	// All the geometry comes from the grid, the sprites are placed in the scaled link line space
+	checkSlow(ParentGrid != nullptr);
+	const FSGBoardGeometry& Geometry = ParentGrid->GetGeometry();
+	const FVector2D SpriteSpacing = ParentGrid->GetTileSize() / LinkLineScale;
+
+	FVector InitialTileCorrds;
+	InitialTileCorrds.X = Geometry.GetColumn(LinePoints[0]);
+	InitialTileCorrds.Y = Geometry.GetRow(LinePoints[0]);
+
+	// The points before the first dirty one are already drawn, only the segments after them are drawn again
+	const int32 KeepPointNum = FMath::Min3(inFirstDirtyPoint, DrawnSegmentAngles.Num(), LinePoints.Num());
+	if (KeepPointNum == 0)
+	{
+		// Set the link line at the head position
+		const FVector HeadTileLocation = ParentGrid->GetLocationFromGridAddress(LinePoints[0]);
+		FVector LinkLineWorldLocation = RootComponent->GetComponentLocation();
+		LinkLineWorldLocation.X = HeadTileLocation.X;
+		LinkLineWorldLocation.Z = HeadTileLocation.Z;
+		RootComponent->SetWorldLocation(LinkLineWorldLocation);
+
+		// The first point has no segment
+		DrawnSegmentAngles.Reset();
+		DrawnBodyInstanceEnds.Reset();
+		DrawnSegmentAngles.Add(0);
+		DrawnBodyInstanceEnds.Add(0);
+	}
+	else
 	{
-		// For the first point, we just mark down the initial position
-		FVector InitialTileCorrds;
-		if (i == 0)
-		{
-			InitialTileCorrds.X = LinePoints[0] % 6;
-			InitialTileCorrds.Y = LinePoints[0] / 6;
-
-			// Set the link line at the head position
-			FVector LinkLineWorldLocation = RootComponent->GetComponentLocation();
-			LinkLineWorldLocation.X = (InitialTileCorrds.X + 0.5f - 3) * 106.0f;
-			LinkLineWorldLocation.Z = (InitialTileCorrds.Y + 0.5f - 3) * 106.0f;
-			RootComponent->SetWorldLocation(LinkLineWorldLocation);
-
-			// Continue from points 1
-			continue;
-		}
+		DrawnSegmentAngles.SetNum(KeepPointNum, false);
+		DrawnBodyInstanceEnds.SetNum(KeepPointNum, false);
+	}
+	BodyInstanceNum = DrawnBodyInstanceEnds.Last();
 
+	// Iterate the new points, and generate line between the two points
+	for (int32 i = DrawnSegmentAngles.Num(); i < LinePoints.Num(); i++)
+	{
 		auto CurrentTileID = LinePoints[i];
 		auto LastTileID = LinePoints[i - 1];
-		FVector CurrentTileCoords, LastTileCorrds;
-		CurrentTileCoords.X = CurrentTileID % 6;
-		CurrentTileCoords.Y = CurrentTileID / 6;
-		LastTileCorrds.X = LastTileID % 6;
-		LastTileCorrds.Y = LastTileID / 6;
+		FVector LastTileCorrds;
+		LastTileCorrds.X = Geometry.GetColumn(LastTileID);
+		LastTileCorrds.Y = Geometry.GetRow(LastTileID);
 
-		UPaperSpriteComponent* NewLineSegmentSprite = nullptr;
-
-		// Caculate the new line body sprite rotation angle
-		int32 NewSpriteAngle = 0;
-		if (CurrentTileCoords.X - LastTileCorrds.X == 1)
-		{
-			if (CurrentTileCoords.Y == LastTileCorrds.Y)
-			{
-				NewSpriteAngle = 0;
-			}
-			else if (CurrentTileCoords.Y - LastTileCorrds.Y == 1)
-			{
-				NewSpriteAngle = 45;
-			}
-			else if (CurrentTileCoords.Y - LastTileCorrds.Y == -1)
-			{
-				NewSpriteAngle = 315;
-			}
-		}
-		else if (CurrentTileCoords.X - LastTileCorrds.X == 0)
-		{
-			if (CurrentTileCoords.Y - LastTileCorrds.Y == 1)
-			{
-				NewSpriteAngle = 90;
-			}
-			if (CurrentTileCoords.Y - LastTileCorrds.Y == -1)
-			{
-				NewSpriteAngle = 270;
-			}
-		}
-		else if (CurrentTileCoords.X - LastTileCorrds.X == -1)
-		{
-			if (CurrentTileCoords.Y == LastTileCorrds.Y)
-			{
-				NewSpriteAngle = 180;
-			}
-			else if (CurrentTileCoords.Y - LastTileCorrds.Y == 1)
-			{
-				NewSpriteAngle = 135;
-			}
-			else if (CurrentTileCoords.Y - LastTileCorrds.Y == -1)
-			{
-				NewSpriteAngle = 225;
-			}
-		}
+		// The new line body sprite rotation angle, the neighbor directions are 45 degree apart from the right
+		const ESGNeighborDirection Direction = Geometry.GetDirection(LastTileID, CurrentTileID);
+		const int32 NewSpriteAngle = Direction != ESGNeighborDirection::None ? static_cast<int32>(Direction) * 45 : 0;
 
 		// Create line corners
 		if (i >= 2)
 		{
 			// Check if the two line in the same direction (positive or negative), if so no corner needed
-			if ((NewSpriteAngle + 360 - m_LastAngle) % 180 != 0)
+			const int32 LastAngle = DrawnSegmentAngles[i - 1];
+			if ((NewSpriteAngle + 360 - LastAngle) % 180 != 0)
 			{
-				UPaperSpriteComponent* NewLineCornerSprite = nullptr;
-				NewLineCornerSprite = CreateLineCorner(NewSpriteAngle, m_LastAngle);
-				if (NewLineCornerSprite == nullptr)
-				{
-					UE_LOG(LogSGame, Warning, TEXT("New corner sprite create failed."));
-					return false;
-				}
-
 				// Set to the last point location
 				FVector CornerPosition;
-				CornerPosition.X = (LastTileCorrds.X - InitialTileCorrds.X) * 70;
+				CornerPosition.X = (LastTileCorrds.X - InitialTileCorrds.X) * SpriteSpacing.X;
 
 				// We want the corner sort infront of lines to 
 				// make the intersection more beautiful
 				CornerPosition.Y = 10;
-				CornerPosition.Z = (LastTileCorrds.Y - InitialTileCorrds.Y) * 70;
-				NewLineCornerSprite->SetRelativeLocation(CornerPosition);
+				CornerPosition.Z = (LastTileCorrds.Y - InitialTileCorrds.Y) * SpriteSpacing.Y;
+				if (AddLineCorner(NewSpriteAngle, LastAngle, CornerPosition) == false)
+				{
+					UE_LOG(LogSGame, Warning, TEXT("New corner sprite create failed."));
+					FinishBodyInstances();
+					return false;
+				}
 			}
 		}
 
-		// For the line head
-		if (i == LinePoints.Num() - 1)
-		{
-			// Set to the current point location
-			FVector HeadPosition;
-			HeadPosition.X = (CurrentTileCoords.X - InitialTileCorrds.X) * 70;
-			// We want the head sort infront of lines to 
-			// make the intersection more beautiful
-			HeadPosition.Y = 10;
-			HeadPosition.Z = (CurrentTileCoords.Y - InitialTileCorrds.Y) * 70;
-			HeadSpriteRenderComponent->SetRelativeLocation(HeadPosition);
-
-			// Set the head rotation
-			HeadSpriteRenderComponent->SetRelativeRotation(FRotator(NewSpriteAngle, 0, 0));
-		}
-
-		// Create the line segment
-		NewLineSegmentSprite = CreateLineSegment(NewSpriteAngle, i == LinePoints.Num() - 1, i == 1);
-		if (NewLineSegmentSprite == NULL)
-		{
-			UE_LOG(LogSGame, Warning, TEXT("New sprite create failed."));
-			return false;
-		}
-
-		// Set to the last point location
+		// Create the line segment at the last point location
 		FVector LineSegmentPosition;
-		LineSegmentPosition.X = (LastTileCorrds.X - InitialTileCorrds.X) * 70;
+		LineSegmentPosition.X = (LastTileCorrds.X - InitialTileCorrds.X) * SpriteSpacing.X;
 		LineSegmentPosition.Y = i == 1 ? -10 : 0;
-		LineSegmentPosition.Z = (LastTileCorrds.Y - InitialTileCorrds.Y) * 70;
-		NewLineSegmentSprite->SetRelativeLocation(LineSegmentPosition);
+		LineSegmentPosition.Z = (LastTileCorrds.Y - InitialTileCorrds.Y) * SpriteSpacing.Y;
+		AddLineSegment(NewSpriteAngle, i == 1, LineSegmentPosition);
+
+		// Mark down current angle and the body instances drawn so far
+		DrawnSegmentAngles.Add(NewSpriteAngle);
+		DrawnBodyInstanceEnds.Add(BodyInstanceNum);
+	}
+
+	// The line head, at the last point with the last segment angle
+	FVector HeadTileCoords;
+	HeadTileCoords.X = Geometry.GetColumn(LinePoints.Last());
+	HeadTileCoords.Y = Geometry.GetRow(LinePoints.Last());
+	FVector HeadPosition;
+	HeadPosition.X = (HeadTileCoords.X - InitialTileCorrds.X) * SpriteSpacing.X;
+	// We want the head sort infront of lines to 
+	// make the intersection more beautiful
+	HeadPosition.Y = 10;
+	HeadPosition.Z = (HeadTileCoords.Y - InitialTileCorrds.Y) * SpriteSpacing.Y;
+	HeadSpriteRenderComponent->SetRelativeLocationAndRotation(HeadPosition, FRotator(DrawnSegmentAngles.Last(), 0, 0));
+
+	FinishBodyInstances();
+	return true;
+}
 
-		// Mark down current angle
-		m_LastAngle = NewSpriteAngle;
+void ASGLinkLine::SetNextBodyInstance(UPaperSprite* inSprite, const FTransform& inTransform)
+{
+	checkSlow(BodySpriteRenderComponent != nullptr);
+	const int32 InstanceIndex = BodyInstanceNum++;
+	if (BodyInstanceSprites.IsValidIndex(InstanceIndex) && BodyInstanceSprites[InstanceIndex] == inSprite)
+	{
+		// Same sprite, move the instance, the batch is sent once the update finishes
+		BodySpriteRenderComponent->UpdateInstanceTransform(InstanceIndex, inTransform, false, false);
+		return;
 	}
 
-	return true;
+	// The grouped sprite cannot change the sprite of an instance, add the instances from here again
+	while (BodyInstanceSprites.Num() > InstanceIndex)
+	{
+		BodySpriteRenderComponent->RemoveInstance(BodyInstanceSprites.Num() - 1);
+		BodyInstanceSprites.Pop(false);
+	}
+	BodySpriteRenderComponent->AddInstance(inTransform, inSprite);
+	BodyInstanceSprites.Add(inSprite);
+}
+
+void ASGLinkLine::FinishBodyInstances()
+{
+	checkSlow(BodySpriteRenderComponent != nullptr);
+
+	// The line became shorter, drop the instances from the end
+	while (BodyInstanceSprites.Num() > BodyInstanceNum)
+	{
+		BodySpriteRenderComponent->RemoveInstance(BodyInstanceSprites.Num() - 1);
+		BodyInstanceSprites.Pop(false);
+	}
+
+	BodySpriteRenderComponent->UpdateBounds();
+	BodySpriteRenderComponent->MarkRenderStateDirty();
 }
 
 bool ASGLinkLine::UpdateLinkLineRibbon(const TArray<int32>& LinePoints)
 {
+	if (LinkLineRibbonEmitter == nullptr)
+	{
+		UE_LOG(LogSGame, Warning, TEXT("Ribbon emitter is empty!"));
+		return false;
+	}
+	UParticleSystemComponent* RibbonPSC = LinkLineRibbonEmitter->GetParticleSystemComponent();
+	checkSlow(RibbonPSC != nullptr);
+
+	if (LinePoints.Num() < 2)
+	{
+		// Only one point cannot become a link line, stop the ribbon
+		RibbonCurve.Reset();
+		RibbonSamples.Reset();
+		RibbonHitAddresses.Reset();
+		RibbonHitDistances.Reset();
+		RibbonLength = 0.0f;
+		RibbonHeadDistance = 0.0f;
+		NextRibbonHit = 0;
+		RibbonPSC->DeactivateSystem();
+		return true;
+	}
+
+	const bool bNewRibbon = RibbonSamples.Num() == 0;
+	BuildRibbonPath(LinePoints);
+
+	if (bNewRibbon == true)
+	{
+		// Start the ribbon at the tail
+		LinkLineRibbonEmitter->SetActorLocation(RibbonSamples[0]);
+		RibbonPSC->ActivateSystem(true);
+		RibbonHeadDistance = 0.0f;
+	}
+	else
+	{
+		// The head keeps running from where it is, back to the end if the line became shorter
+		RibbonHeadDistance = FMath::Min(RibbonHeadDistance, RibbonLength);
+	}
+
+	// The tiles behind the head are already hit
+	NextRibbonHit = 0;
+	while (NextRibbonHit < RibbonHitDistances.Num() && RibbonHitDistances[NextRibbonHit] < RibbonHeadDistance)
+	{
+		NextRibbonHit++;
+	}
+	MoveRibbonHead(0.0f);
+
 	return true;
 }
 
+void ASGLinkLine::BuildRibbonPath(const TArray<int32>& LinePoints)
+{
+	checkSlow(ParentGrid != nullptr && LinePoints.Num() >= 2);
+
+	// The ribbon runs in front of the tiles, at the link line depth
+	const float RibbonDepth = GetActorLocation().Y;
+	auto GetRibbonLocation = [this, RibbonDepth](int32 GridAddress)
+	{
+		FVector Location = ParentGrid->GetLocationFromGridAddress(GridAddress);
+		Location.Y = RibbonDepth;
+		return Location;
+	};
+
+	// Only the turning points are the curve keys, the curve smooths the corners between the straight runs
+	const TArray<int32> KeyPoints = StraightenThePoints(LinePoints);
+	RibbonCurve.Reset();
+	TArray<float> KeyDistances;
+	KeyDistances.Reserve(KeyPoints.Num());
+	for (int32 i = 0; i < KeyPoints.Num(); i++)
+	{
+		const FVector KeyLocation = GetRibbonLocation(KeyPoints[i]);
+		const float KeyDistance = i == 0 ? 0.0f : KeyDistances.Last() + FVector::Dist(RibbonCurve.Points.Last().OutVal, KeyLocation);
+		const int32 KeyIndex = RibbonCurve.AddPoint(KeyDistance, KeyLocation);
+		RibbonCurve.Points[KeyIndex].InterpMode = CIM_CurveAutoClamped;
+		KeyDistances.Add(KeyDistance);
+	}
+	RibbonCurve.AutoSetTangents();
+
+	// Step the curve finely and sum up the arc length at every step
+	const float ChordLength = KeyDistances.Last();
+	RibbonSampleSpacing = ParentGrid->GetTileSize().GetMin() / FMath::Max(RibbonSamplesPerTile, 1);
+	checkSlow(RibbonSampleSpacing > 0);
+	const int32 StepNum = FMath::Max(FMath::CeilToInt(ChordLength / RibbonSampleSpacing) * 4, 1);
+	TArray<float> StepArcLengths;
+	StepArcLengths.Reserve(StepNum + 1);
+	StepArcLengths.Add(0.0f);
+	FVector LastStepLocation = RibbonCurve.Eval(0.0f);
+	for (int32 Step = 1; Step <= StepNum; Step++)
+	{
+		const FVector StepLocation = RibbonCurve.Eval(ChordLength * Step / StepNum);
+		StepArcLengths.Add(StepArcLengths.Last() + FVector::Dist(LastStepLocation, StepLocation));
+		LastStepLocation = StepLocation;
+	}
+	RibbonLength = StepArcLengths.Last();
+
+	// Curve key of an arc length, and arc length of a curve key, both from the step table
+	auto ArcLengthToKey = [&StepArcLengths, ChordLength, StepNum](float ArcLength, int32& InOutStep)
+	{
+		while (InOutStep < StepNum - 1 && StepArcLengths[InOutStep + 1] < ArcLength)
+		{
+			InOutStep++;
+		}
+		const float StepLength = StepArcLengths[InOutStep + 1] - StepArcLengths[InOutStep];
+		const float Alpha = StepLength > 0 ? FMath::Clamp((ArcLength - StepArcLengths[InOutStep]) / StepLength, 0.0f, 1.0f) : 0.0f;
+		return ChordLength * (InOutStep + Alpha) / StepNum;
+	};
+	auto KeyToArcLength = [&StepArcLengths, ChordLength, StepNum](float Key)
+	{
+		const float StepPosition = ChordLength > 0 ? FMath::Clamp(Key / ChordLength * StepNum, 0.0f, static_cast<float>(StepNum)) : 0.0f;
+		const int32 Step = FMath::Min(FMath::FloorToInt(StepPosition), StepNum - 1);
+		return FMath::Lerp(StepArcLengths[Step], StepArcLengths[Step + 1], StepPosition - Step);
+	};
+
+	// Equally spaced samples along the arc length, the head moves between them without evaluating the curve
+	RibbonSamples.Reset();
+	const int32 SpacedSampleNum = FMath::CeilToInt(RibbonLength / RibbonSampleSpacing);
+	RibbonSamples.Reserve(SpacedSampleNum + 1);
+	int32 SampleStep = 0;
+	for (int32 i = 0; i < SpacedSampleNum; i++)
+	{
+		RibbonSamples.Add(RibbonCurve.Eval(ArcLengthToKey(i * RibbonSampleSpacing, SampleStep)));
+	}
+	RibbonSamples.Add(RibbonCurve.Eval(ChordLength));
+
+	// Every link line point lies on the straight run from the key before it, so its curve key is the distance from that key
+	RibbonHitAddresses.Reset();
+	RibbonHitDistances.Reset();
+	int32 KeyIndex = 0;
+	for (int32 i = 0; i < LinePoints.Num(); i++)
+	{
+		if (KeyIndex + 1 < KeyPoints.Num() && LinePoints[i] == KeyPoints[KeyIndex + 1])
+		{
+			KeyIndex++;
+		}
+		const float PointKey = KeyDistances[KeyIndex] + FVector::Dist(RibbonCurve.Points[KeyIndex].OutVal, GetRibbonLocation(LinePoints[i]));
+		RibbonHitAddresses.Add(LinePoints[i]);
+		RibbonHitDistances.Add(KeyToArcLength(PointKey));
+	}
+}
+
+void ASGLinkLine::MoveRibbonHead(float inDeltaDistance)
+{
+	if (RibbonSamples.Num() == 0 || LinkLineRibbonEmitter == nullptr)
+	{
+		return;
+	}
+
+	RibbonHeadDistance = FMath::Min(RibbonHeadDistance + inDeltaDistance, RibbonLength);
+
+	// Between the two samples around the head distance
+	const float SamplePosition = RibbonHeadDistance / RibbonSampleSpacing;
+	const int32 SampleIndex = FMath::Min(FMath::FloorToInt(SamplePosition), RibbonSamples.Num() - 1);
+	FVector HeadLocation = RibbonSamples[SampleIndex];
+	if (SampleIndex + 1 < RibbonSamples.Num())
+	{
+		// The last sample is at the path end, closer than the spacing
+		const float SampleDistance = SampleIndex * RibbonSampleSpacing;
+		const float IntervalLength = FMath::Min(RibbonSampleSpacing, RibbonLength - SampleDistance);
+		const float Alpha = IntervalLength > 0 ? FMath::Clamp((RibbonHeadDistance - SampleDistance) / IntervalLength, 0.0f, 1.0f) : 1.0f;
+		HeadLocation = FMath::Lerp(RibbonSamples[SampleIndex], RibbonSamples[SampleIndex + 1], Alpha);
+	}
+	LinkLineRibbonEmitter->SetActorLocation(HeadLocation);
+
+	// Hit the tiles the head passed
+	checkSlow(ParentGrid != nullptr);
+	while (NextRibbonHit < RibbonHitDistances.Num() && RibbonHitDistances[NextRibbonHit] <= RibbonHeadDistance)
+	{
+		SendEnemyGetHit(ParentGrid->GetTileFromGridAddress(RibbonHitAddresses[NextRibbonHit]));
+		NextRibbonHit++;
+	}
+}
+
 bool ASGLinkLine::Update()
 {
 	UpdateLinkLineDisplay();
@@ -305,11 +496,11 @@ bool ASGLinkLine::GetReferencedContentObjects(TArray<UObject*>& Objects) const
 		Objects.Add(TailSpriteRenderComponent->GetSprite());
 	}
 
-	for (int i = 0; i < LinkLineSpriteRendererArray.Num(); i++)
+	for (UPaperSprite* BodyInstanceSprite : BodyInstanceSprites)
 	{
-		if (LinkLineSpriteRendererArray[i] != nullptr && LinkLineSpriteRendererArray[i]->GetSprite() != nullptr)
+		if (BodyInstanceSprite != nullptr)
 		{
-			Objects.Add(LinkLineSpriteRendererArray[i]->GetSprite());
+			Objects.AddUnique(BodyInstanceSprite);
 		}
 	}
 	return true;
@@ -325,20 +516,9 @@ bool ASGLinkLine::ReplayLinkAnimation(TArray<ASGTileBase*>& CollectTiles)
 {
 	CachedCollectTiles = CollectTiles;
 
-	if (MessageEndpoint.IsValid() == true)
-	{
-		// Reset the tile link status
-		FMessage_Gameplay_TileLinkedStatusChange* LinkStatusChangeMessage = new FMessage_Gameplay_TileLinkedStatusChange{ 0 };
-		LinkStatusChangeMessage->TileID = -1;
-		LinkStatusChangeMessage->NewLinkStatus = false;
-		MessageEndpoint->Publish(LinkStatusChangeMessage, EMessageScope::Process);
-
-		// Reset the tile selectable status
-		FMessage_Gameplay_TileSelectableStatusChange* SelectableMessage = new FMessage_Gameplay_TileSelectableStatusChange{ 0 };
-		SelectableMessage->TileID = -1;
-		SelectableMessage->NewSelectableStatus = true;
-		MessageEndpoint->Publish(SelectableMessage, EMessageScope::Process);
-	}
+	// Reset the tile link and selectable status, through the grid so it knows what the tiles show
+	checkSlow(ParentGrid);
+	ParentGrid->ResetTiles();
 
 	// Kick off the replay
 	BeginReplayLinkAnimation();
@@ -362,9 +542,8 @@ void ASGLinkLine::EndReplayLinkAnimation()
 	else
 	{
 		// We don't need to refill the grid, send tile finish moving message directly
-		checkSlow(MessageEndpoint.IsValid());
-		FMessage_Gameplay_AllTileFinishMove* Message = new FMessage_Gameplay_AllTileFinishMove();
-		MessageEndpoint->Publish(Message, EMessageScope::Process);
+		checkSlow(EventBus);
+		EventBus->Publish(FMessage_Gameplay_AllTileFinishMove());
 	}
 	
 	// Reset the linkline after all
@@ -374,52 +553,47 @@ void ASGLinkLine::EndReplayLinkAnimation()
 void ASGLinkLine::ReplaySingleLinkLineAniamtion(int32 ReplayLength)
 {
 	UE_LOG(LogSGameAsyncTask, Log, TEXT("Starting replay link line anim with length: %d"), ReplayLength);
-	TArray<int32> ReplayingLinkLinePoints;
-
-	// Reconstruct the replay link line points one by one
-	ReplayingLinkLinePoints.Empty();
 
-	// Push back the replayed length
-	for (int i = 0; i <= ReplayLength; i++)
-	{
-		ReplayingLinkLinePoints.Push(LinkLinePoints[i]);
-	}
-
-	// Construct the link line again
-	UpdateLinkLineSprites(ReplayingLinkLinePoints);
+	// Construct the link line again with the replayed length, it is the front of the link line so the drawn segments are kept
+	UpdateLinkLineSprites(MakeArrayView(LinkLinePoints.GetData(), ReplayLength + 1), FirstDirtyLinePoint);
+	FirstDirtyLinePoint = MAX_int32;
 
 	checkSlow(ParentGrid);
-	if (this->MessageEndpoint.IsValid() == true)
+	if (EventBus != nullptr)
 	{
 		if (ReplayLength == 1)
 		{
-			// Send the selected message to the fake tail
-			FMessage_Gameplay_TileLinkedStatusChange* LinkStatusChangeMessage = new FMessage_Gameplay_TileLinkedStatusChange{ 0 };
+			// Show the fake tail as linked
 			const ASGTileBase* FakeSelectedTile = ParentGrid->GetTileFromGridAddress(LinkLinePoints[0]);
-			LinkStatusChangeMessage->TileID = FakeSelectedTile->GetTileID();
-			LinkStatusChangeMessage->NewLinkStatus = true;
-			MessageEndpoint->Publish(LinkStatusChangeMessage, EMessageScope::Process);
+			ParentGrid->SetTileLinkedStatus(LinkLinePoints[0], true);
 
 			// If the tile is an enemy tile, then play hit animation
-			FMessage_Gameplay_EnemyGetHit* HitMessage = new FMessage_Gameplay_EnemyGetHit{ 0 };
-			HitMessage->TileID = FakeSelectedTile->GetTileID();
-			MessageEndpoint->Publish(HitMessage, EMessageScope::Process);
+			SendEnemyGetHit(FakeSelectedTile);
 		}
 
-		// Send the selected message to the fake head
-		FMessage_Gameplay_TileLinkedStatusChange* LinkStatusChangeMessage = new FMessage_Gameplay_TileLinkedStatusChange{ 0 };
+		// Show the fake head as linked
 		const ASGTileBase* FakeSelectedTile = ParentGrid->GetTileFromGridAddress(LinkLinePoints[ReplayLength]);
-		LinkStatusChangeMessage->TileID = FakeSelectedTile->GetTileID();
-		LinkStatusChangeMessage->NewLinkStatus = true;
-		MessageEndpoint->Publish(LinkStatusChangeMessage, EMessageScope::Process);
+		ParentGrid->SetTileLinkedStatus(LinkLinePoints[ReplayLength], true);
 
 		// If the tile is an enemy tile, then play hit animation
-		FMessage_Gameplay_EnemyGetHit* HitMessage = new FMessage_Gameplay_EnemyGetHit{ 0 };
-		HitMessage->TileID = FakeSelectedTile->GetTileID();
-		MessageEndpoint->Publish(HitMessage, EMessageScope::Process);
+		SendEnemyGetHit(FakeSelectedTile);
 	}
 }
 
+void ASGLinkLine::SendEnemyGetHit(const ASGTileBase* inTile)
+{
+	// Only the enemy tile handles the hit, so no need to send to the others
+	const ASGEnemyTileBase* EnemyTile = Cast<ASGEnemyTileBase>(inTile);
+	if (EnemyTile == nullptr || EventBus == nullptr)
+	{
+		return;
+	}
+
+	FMessage_Gameplay_EnemyGetHit HitMessage{ 0 };
+	HitMessage.TileID = EnemyTile->GetTileID();
+	EventBus->Send(HitMessage, EnemyTile);
+}
+
 TArray<int32> ASGLinkLine::StraightenThePoints(TArray<int32> inPointsToStrighten)
 {
 	checkSlow(ParentGrid != nullptr);
@@ -452,106 +626,83 @@ TArray<int32> ASGLinkLine::StraightenThePoints(TArray<int32> inPointsToStrighten
 	return ResultPoints;
 }
 
-UPaperSpriteComponent* ASGLinkLine::CreateLineCorner(int inAngle, int inLastAngle)
+bool ASGLinkLine::AddLineCorner(int inAngle, int inLastAngle, const FVector& inPosition)
 {
-	// Create the base sprite and initialize
-	UPaperSpriteComponent* NewSprite = nullptr;
-	NewSprite = NewObject<UPaperSpriteComponent>(this);
-	NewSprite->Mobility = EComponentMobility::Movable;
-	NewSprite->RegisterComponent();
-	NewSprite->AttachToComponent(RootComponent, FAttachmentTransformRules::KeepRelativeTransform);
-	NewSprite->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-
 	// Rotate to the last angle
-	NewSprite->SetRelativeRotation(FRotator(inLastAngle, 0, 0));
+	FTransform CornerTransform(FRotator(inLastAngle, 0, 0), inPosition);
 	
 	// Choose the sprite texture
+	UPaperSprite* CornerSprite = nullptr;
 	int32 AngleDiff = (inAngle - inLastAngle + 360) % 360;
 	switch (AngleDiff)
 	{
 	case 45:
 	{
-		NewSprite->SetRelativeScale3D(FVector(1, 1, -1));
-		NewSprite->SetSprite(Corner_135_Sprite);
+		CornerTransform.SetScale3D(FVector(1, 1, -1));
+		CornerSprite = Corner_135_Sprite;
 		break;
 	}
 	case 225:
 	{
-		NewSprite->SetSprite(Corner_45_Sprite);
+		CornerSprite = Corner_45_Sprite;
 		break;
 	}
 	case 90:
 	{
-		NewSprite->SetRelativeScale3D(FVector(1, 1, -1));
-		NewSprite->SetSprite(Corner_90_Sprite);
+		CornerTransform.SetScale3D(FVector(1, 1, -1));
+		CornerSprite = Corner_90_Sprite;
 		break;
 	}
 	case 270:
 	{
-		NewSprite->SetSprite(Corner_90_Sprite);
+		CornerSprite = Corner_90_Sprite;
 		break;
 	}
 	case 135:
 	{
-		NewSprite->SetRelativeScale3D(FVector(1, 1, -1));
-		NewSprite->SetSprite(Corner_45_Sprite);
+		CornerTransform.SetScale3D(FVector(1, 1, -1));
+		CornerSprite = Corner_45_Sprite;
 		break;
 	}
 	case 315:
 	{
-		NewSprite->SetSprite(Corner_135_Sprite);
+		CornerSprite = Corner_135_Sprite;
 		break;
 	}
 	default:
 	{
-		UE_LOG(LogSGame, Warning, TEXT("Invalid angle, returning null sprite!"));
-		return nullptr;
+		UE_LOG(LogSGame, Warning, TEXT("Invalid angle, no corner sprite!"));
+		return false;
 	}
 	}
 
-	// Add to the body sprite array
-	LinkLineSpriteRendererArray.Add(NewSprite);
-
-	return NewSprite;
+	SetNextBodyInstance(CornerSprite, CornerTransform);
+	return true;
 }
 
-UPaperSpriteComponent* ASGLinkLine::CreateLineSegment(int inAngle, bool inIsHead, bool inIsTail)
+void ASGLinkLine::AddLineSegment(int inAngle, bool inIsTail, const FVector& inPosition)
 {
-	UPaperSpriteComponent* NewSprite = NULL;
-	if (inIsTail == true)
-	{
-		NewSprite = TailSpriteRenderComponent;
-	}
-	else
-	{
-		NewSprite = NewObject<UPaperSpriteComponent>(this);
-		NewSprite->Mobility = EComponentMobility::Movable;
-		NewSprite->SetSprite(BodySprite);
-		NewSprite->RegisterComponent();
-		NewSprite->AttachToComponent(RootComponent, FAttachmentTransformRules::KeepRelativeTransform);
-		NewSprite->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-
-		// Add to the body sprite array
-		LinkLineSpriteRendererArray.Add(NewSprite);
-	}
-
-	checkSlow(NewSprite != nullptr);
-
+	// Set the rotation to the new angle
+	FTransform SegmentTransform(FRotator(inAngle, 0, 0), inPosition);
 	if (inAngle % 90 != 0)
 	{
 		// Set Scale to 1.414 if it is cross line
-		NewSprite->SetRelativeScale3D(FVector(1.42f, 1, 1));
+		SegmentTransform.SetScale3D(FVector(1.42f, 1, 1));
 	}
 	else
 	{
 		// Set Scale to a little bit longer than 1 to overlap
-		NewSprite->SetRelativeScale3D(FVector(1.05f, 1, 1));
+		SegmentTransform.SetScale3D(FVector(1.05f, 1, 1));
 	}
 
-	// Set the rotation to the new angle
-	NewSprite->SetRelativeRotation(FRotator(inAngle, 0, 0));
+	if (inIsTail == true)
+	{
+		// The tail keeps its own sprite component
+		TailSpriteRenderComponent->SetRelativeTransform(SegmentTransform);
+		return;
+	}
 
-	return NewSprite;
+	SetNextBodyInstance(BodySprite, SegmentTransform);
 }
 
 void ASGLinkLine::ResetLinkState()
@@ -585,6 +736,7 @@ void ASGLinkLine::BuildPath(ASGTileBase* inNewTile)
 			LinkLinePoints.Pop();
 			LinkLineTiles.Pop();
 		}
+		FirstDirtyLinePoint = FMath::Min(FirstDirtyLinePoint, ExistTileAddress + 1);
 	}
 	else
 	{
@@ -592,7 +744,7 @@ void ASGLinkLine::BuildPath(ASGTileBase* inNewTile)
 		LinkLineTiles.Add(inNewTile);
 
 		// Add the points to the link line points for drawing the sprites
-		LinkLinePoints.Add(inNewTile->GetGridAddress());
+		FirstDirtyLinePoint = FMath::Min(FirstDirtyLinePoint, LinkLinePoints.Add(inNewTile->GetGridAddress()));
 	}
 
 	// Do a link line update
@@ -601,39 +753,7 @@ void ASGLinkLine::BuildPath(ASGTileBase* inNewTile)
 
 ASGLinkLineEmitter::ASGLinkLineEmitter()
 {
-	// Use the collision box as the root component
-	EmitterHeadCollision = CreateDefaultSubobject<UBoxComponent>(TEXT("LinkLineHead-Collision"));
-	EmitterHeadCollision->Mobility = EComponentMobility::Movable;
-	EmitterHeadCollision->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
-	EmitterHeadCollision->InitBoxExtent(FVector(5, 1000, 5));
-	EmitterHeadCollision->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Overlap);
-	RootComponent = EmitterHeadCollision;
-
-	// Then attach psc to the box
-	GetParticleSystemComponent()->AttachToComponent(RootComponent, FAttachmentTransformRules::KeepRelativeTransform);
-}
-
-void ASGLinkLineEmitter::BeginPlay()
-{
-	Super::BeginPlay();
-
-	OnActorHit.AddUniqueDynamic(this, &ASGLinkLineEmitter::OnLinkLineEmitterHitTile);
-	OnActorBeginOverlap.AddUniqueDynamic(this, &ASGLinkLineEmitter::OnLinkLineEmitterOverlapTile);
-}
-
-void ASGLinkLineEmitter::OnLinkLineEmitterHitTile(AActor* SelfActor, AActor* OtherActor, FVector NormalImpulse, const FHitResult& Hit)
-{
-	UE_LOG(LogSGame, Log, TEXT("Hit!"));
-}
-
-void ASGLinkLineEmitter::OnLinkLineEmitterOverlapTile(AActor* OverlappedActor, AActor* OtherActor)
-{
-	checkSlow(OverlappedActor != nullptr && OtherActor != nullptr);
-
-	if (OtherActor->IsA(ASGEnemyTileBase::StaticClass()) == true)
-	{
-		UE_LOG(LogSGame, Log, TEXT("Overlap with enemy tile"));
-		ASGEnemyTileBase* EnemyTile = CastChecked<ASGEnemyTileBase>(OtherActor);
-		EnemyTile->BeginPlayHit();
-	}
+	// The link line starts the ribbon when it has a path
+	GetParticleSystemComponent()->bAutoActivate = false;
+	GetParticleSystemComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 }
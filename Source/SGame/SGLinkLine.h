@@ -5,10 +5,11 @@
 #include "GameFramework/Actor.h"
 #include "PaperSprite.h"
 #include "PaperSpriteComponent.h"
-#include "MessageEndpoint.h"
+#include "PaperGroupedSpriteComponent.h"
 
 #include "SGameMessages.h"
 #include "SGTileBase.h"
+#include "SGGameplayEventBus.h"
 
 #include "SGLinkLine.generated.h"
 
@@ -31,7 +32,10 @@ enum class ELinkLineMode : uint8
 	ELLM_Ribbon,		// Use the ribbon linkline
 };
 
-/** Linkline emitter contains a collision component to get tile overlap event */
+/**
+ * Linkline emitter, the link line moves it along the ribbon path and the ribbon trails behind it.
+ * It has no collision, the link line resolves the tiles the ribbon passes from the grid addresses.
+ */
 UCLASS()
 class SGAME_API ASGLinkLineEmitter : public AEmitter
 {
@@ -39,25 +43,6 @@ class SGAME_API ASGLinkLineEmitter : public AEmitter
 
 public:
 	ASGLinkLineEmitter();
-
-	// Called when the game starts or when spawned
-	virtual void BeginPlay() override;
-
-	/**
-	* Linkline emitter hit the tile
-	*/
-	UFUNCTION()
-	void OnLinkLineEmitterHitTile(AActor* SelfActor, AActor* OtherActor, FVector NormalImpulse, const FHitResult& Hit);
-
-	/**
-	* Linkline emitter overlap the tile
-	*/
-	UFUNCTION()
-	void OnLinkLineEmitterOverlapTile(AActor* OverlappedActor, AActor* OtherActor);
-
-protected:
-	UBoxComponent*				EmitterHeadCollision;
-	UParticleSystemComponent*	EmitterPSC;
 };
 
 UCLASS()
@@ -181,12 +166,17 @@ protected:
 	UPROPERTY(Category = Sprite, EditAnywhere, BlueprintReadOnly, meta = (DisplayThumbnail = "true"))
 	UPaperSprite* BodySprite;
 
-	/** Body sprites for render the link line body lines and coners */
-	UPROPERTY(Category = Sprite, VisibleAnywhere, BlueprintReadOnly)
-	TArray<UPaperSpriteComponent*> LinkLineSpriteRendererArray;
+	/** The link line scale to fit the grid, the sprite spacing is the grid tile size divided by the scale */
+	UPROPERTY(Category = Sprite, EditAnywhere, BlueprintReadOnly)
+	float LinkLineScale;
 
-	/** Update link line sprites using the line points */
-	bool UpdateLinkLineSprites(const TArray<int32>& LinePoints);
+	/**
+	* Update link line sprites using the line points
+	*
+	* @param LinePoints			the points to draw
+	* @param inFirstDirtyPoint	the first point changed since the last draw, the segments before it are kept
+	*/
+	bool UpdateLinkLineSprites(TArrayView<const int32> LinePoints, int32 inFirstDirtyPoint);
 
 	// The ribbon ParticleSystem to display the linkline
 	UPROPERTY(Category = Ribbon, EditAnywhere, BlueprintReadOnly, meta = (DisplayThumbnail = "true"))
@@ -196,7 +186,15 @@ protected:
 	UPROPERTY(Category = Ribbon, EditAnywhere, BlueprintReadOnly)
 	ASGLinkLineEmitter* LinkLineRibbonEmitter;
 
-	/** Update link line ribbon using the line points */
+	/** Ribbon path samples in one tile size */
+	UPROPERTY(Category = Ribbon, EditAnywhere, BlueprintReadOnly)
+	int32 RibbonSamplesPerTile;
+
+	/** How fast the ribbon head runs along the path, in world units per second */
+	UPROPERTY(Category = Ribbon, EditAnywhere, BlueprintReadOnly)
+	float RibbonHeadSpeed;
+
+	/** Update link line ribbon using the line points, the path is built once here and the head runs along it in tick */
 	bool UpdateLinkLineRibbon(const TArray<int32>& LinePoints);
 
 	/** Link line points, for drawing the sprites*/
@@ -212,14 +210,65 @@ private:
 	UPROPERTY(Category = Sprite, VisibleAnywhere, BlueprintReadOnly, meta = (ExposeFunctionCategories = "Sprite,Rendering,Physics,Components|Sprite", AllowPrivateAccess = "true"))
 	UPaperSpriteComponent* TailSpriteRenderComponent;
 
-	UPaperSpriteComponent* CreateLineCorner(int inAngle, int inLastAngle);
-	UPaperSpriteComponent* CreateLineSegment(int inAngle, bool inIsHead, bool inIsTail);
+	/** Batched sprite for render the link line body lines and corners in one draw, the instances are updated in place */
+	UPROPERTY(Category = Sprite, VisibleAnywhere, BlueprintReadOnly, meta = (ExposeFunctionCategories = "Sprite,Rendering,Physics,Components|Sprite", AllowPrivateAccess = "true"))
+	UPaperGroupedSpriteComponent* BodySpriteRenderComponent;
+
+	/** Sprite of every body instance, the instance is reused when the next update puts the same sprite on it */
+	UPROPERTY(Transient)
+	TArray<UPaperSprite*> BodyInstanceSprites;
+
+	/** Body instances written by the current update */
+	int32 BodyInstanceNum;
+
+	/** Add the corner between the last and the new line segment at the position */
+	bool AddLineCorner(int inAngle, int inLastAngle, const FVector& inPosition);
+
+	/** Send the get hit message to the tile, if it is an enemy tile */
+	void SendEnemyGetHit(const ASGTileBase* inTile);
+
+	/** Add the line segment at the position, the first segment is the tail sprite */
+	void AddLineSegment(int inAngle, bool inIsTail, const FVector& inPosition);
+
+	/** Write the next body instance, only the transform changes if the instance has the same sprite */
+	void SetNextBodyInstance(UPaperSprite* inSprite, const FTransform& inTransform);
+
+	/** Remove the body instances the current update didn't write, and send the batch to the renderer */
+	void FinishBodyInstances();
+
+	/** Angle of the segment ending at every drawn point, 0 for the first point */
+	TArray<int32> DrawnSegmentAngles;
+
+	/** Body instances drawn up to every drawn point, a pop goes back to the count and a push continues from it */
+	TArray<int32> DrawnBodyInstanceEnds;
+
+	/** First point of the link line changed since the last sprite draw */
+	int32 FirstDirtyLinePoint;
+
+	/** Smoothed ribbon path through the turning points, keyed by the distance along the straight lines between them */
+	FInterpCurveVector RibbonCurve;
+
+	/** Ribbon path locations at every sample spacing of the arc length */
+	TArray<FVector> RibbonSamples;
+	float RibbonSampleSpacing;
+	float RibbonLength;
+
+	/** The link line tiles in order, and the arc length where the ribbon passes them */
+	TArray<int32> RibbonHitAddresses;
+	TArray<float> RibbonHitDistances;
+	int32 NextRibbonHit;
+
+	/** Arc length the ribbon head has run */
+	float RibbonHeadDistance;
+
+	/** Build the ribbon curve, its arc length samples and the tile hit distances */
+	void BuildRibbonPath(const TArray<int32>& LinePoints);
 
-	int								m_CurrentSpriteNum;
-	int								m_LastAngle;
+	/** Run the ribbon head along the path, and hit the tiles it passes */
+	void MoveRibbonHead(float inDeltaDistance);
 
-	// Holds the messaging endpoint.
-	TSharedPtr<FMessageEndpoint, ESPMode::ThreadSafe> MessageEndpoint;
+	// Holds the gameplay event bus.
+	FSGGameplayEventBus* EventBus;
 
 	// Hold the reference to its parent grid
 	ASGGrid* ParentGrid;
@@ -0,0 +1,211 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SGame.h"
+#include "SGLinkSolver.h"
+#include "SGBoardRules.h"
+
+DECLARE_CYCLE_STAT(TEXT("Link Solver"), STAT_SGLinkSolver, STATGROUP_SGame);
+
+FSGLinkSolver::FSGLinkSolver()
+{
+	MinimumLength = 0;
+	SearchStepNum = 0;
+}
+
+void FSGLinkSolver::BuildFromBitBoard(const FSGBitBoard& inBitBoard)
+{
+	const int32 NumAddresses = inBitBoard.GetGridWidth() * inBitBoard.GetGridHeight();
+	LinkableMasks.SetNum(NumAddresses, false);
+	OccupiedMask.CopyFrom(inBitBoard.GetOccupiedMask());
+	for (int32 GridAddress = 0; GridAddress < NumAddresses; GridAddress++)
+	{
+		FSGBoardMask& LinkableMask = LinkableMasks[GridAddress];
+		if (OccupiedMask.Test(GridAddress) == true)
+		{
+			inBitBoard.BuildSelectableMask(GridAddress, LinkableMask);
+			LinkableMask.Clear(GridAddress);
+		}
+		else if (LinkableMask.Num() != NumAddresses)
+		{
+			LinkableMask.Init(NumAddresses);
+		}
+		else
+		{
+			LinkableMask.Reset();
+		}
+	}
+}
+
+void FSGLinkSolver::BuildFromBoardState(const FSGBoardState& inBoardState)
+{
+	const int32 GridWidth = inBoardState.GetGridWidth();
+	const int32 GridHeight = inBoardState.GetGridHeight();
+	const int32 NumAddresses = inBoardState.Num();
+	LinkableMasks.SetNum(NumAddresses, false);
+	OccupiedMask.Init(NumAddresses);
+	for (int32 GridAddress = 0; GridAddress < NumAddresses; GridAddress++)
+	{
+		FSGBoardMask& LinkableMask = LinkableMasks[GridAddress];
+		if (LinkableMask.Num() != NumAddresses)
+		{
+			LinkableMask.Init(NumAddresses);
+		}
+		else
+		{
+			LinkableMask.Reset();
+		}
+
+		const FSGBoardTile& Tile = inBoardState.GetTile(GridAddress);
+		if (Tile.IsEmpty() == true)
+		{
+			continue;
+		}
+		OccupiedMask.Set(GridAddress);
+
+		const int32 Column = GridAddress % GridWidth;
+		const int32 Row = GridAddress / GridWidth;
+		for (int32 NeighborRow = FMath::Max(Row - 1, 0); NeighborRow <= FMath::Min(Row + 1, GridHeight - 1); NeighborRow++)
+		{
+			for (int32 NeighborColumn = FMath::Max(Column - 1, 0); NeighborColumn <= FMath::Min(Column + 1, GridWidth - 1); NeighborColumn++)
+			{
+				const int32 NeighborAddress = NeighborRow * GridWidth + NeighborColumn;
+				const FSGBoardTile& NeighborTile = inBoardState.GetTile(NeighborAddress);
+				if (NeighborAddress != GridAddress && NeighborTile.IsEmpty() == false &&
+					FSGBoardRules::CanLinkTiles(Tile.TileType, Tile.Abilities, NeighborTile.TileType, NeighborTile.Abilities) == true)
+				{
+					LinkableMask.Set(NeighborAddress);
+				}
+			}
+		}
+	}
+}
+
+bool FSGLinkSolver::FindLinkLine(int32 inMinimumLength, TArray<int32>* OutLinkAddresses)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SGLinkSolver);
+
+	const int32 NumAddresses = LinkableMasks.Num();
+	MinimumLength = FMath::Max(inMinimumLength, 1);
+	SearchStepNum = 0;
+	if (PathMask.Num() != NumAddresses)
+	{
+		PathMask.Init(NumAddresses);
+		ComponentVisitedMask.Init(NumAddresses);
+	}
+	else
+	{
+		PathMask.Reset();
+		ComponentVisitedMask.Reset();
+	}
+
+	FSGBoardMask ComponentMask(NumAddresses);
+	for (int32 StartAddress = 0; StartAddress < NumAddresses; StartAddress++)
+	{
+		if (OccupiedMask.Test(StartAddress) == false || ComponentVisitedMask.Test(StartAddress) == true)
+		{
+			continue;
+		}
+
+		// A component smaller than the link line can't hold it
+		const int32 ComponentSize = FloodComponent(StartAddress, ComponentMask);
+		if (ComponentSize < MinimumLength)
+		{
+			continue;
+		}
+
+		// Any connected 3 tiles have a path through all of them
+		if (MinimumLength <= 3 && OutLinkAddresses == nullptr)
+		{
+			return true;
+		}
+
+		// Every link line ends somewhere in the component, so starting from every tile of it finds all of them
+		for (int32 WordIndex = 0; WordIndex < ComponentMask.NumWords(); WordIndex++)
+		{
+			uint64 Word = ComponentMask.GetWord(WordIndex);
+			while (Word != 0)
+			{
+				const int32 HeadAddress = (WordIndex << 6) + FSGBoardMask::LowestBitIndex(Word);
+				Word &= Word - 1;
+
+				PathAddresses.Reset();
+				PathAddresses.Add(HeadAddress);
+				PathMask.Set(HeadAddress);
+				if (SearchFrom(HeadAddress, 1) == true)
+				{
+					if (OutLinkAddresses != nullptr)
+					{
+						*OutLinkAddresses = PathAddresses;
+					}
+					return true;
+				}
+				PathMask.Clear(HeadAddress);
+			}
+		}
+	}
+
+	return false;
+}
+
+bool FSGLinkSolver::SearchFrom(int32 inHeadAddress, int32 inPathLength)
+{
+	SearchStepNum++;
+	if (inPathLength >= MinimumLength)
+	{
+		return true;
+	}
+
+	const FSGBoardMask& LinkableMask = LinkableMasks[inHeadAddress];
+	for (int32 WordIndex = 0; WordIndex < LinkableMask.NumWords(); WordIndex++)
+	{
+		uint64 Word = LinkableMask.GetWord(WordIndex) & ~PathMask.GetWord(WordIndex);
+		while (Word != 0)
+		{
+			const int32 NextAddress = (WordIndex << 6) + FSGBoardMask::LowestBitIndex(Word);
+			Word &= Word - 1;
+
+			PathMask.Set(NextAddress);
+			PathAddresses.Add(NextAddress);
+			if (SearchFrom(NextAddress, inPathLength + 1) == true)
+			{
+				return true;
+			}
+			PathAddresses.Pop(false);
+			PathMask.Clear(NextAddress);
+		}
+	}
+
+	return false;
+}
+
+int32 FSGLinkSolver::FloodComponent(int32 inStartAddress, FSGBoardMask& ComponentMask)
+{
+	ComponentMask.Reset();
+	FloodStack.Reset();
+	FloodStack.Add(inStartAddress);
+	ComponentVisitedMask.Set(inStartAddress);
+
+	int32 ComponentSize = 0;
+	while (FloodStack.Num() > 0)
+	{
+		const int32 GridAddress = FloodStack.Pop(false);
+		ComponentMask.Set(GridAddress);
+		ComponentSize++;
+
+		const FSGBoardMask& LinkableMask = LinkableMasks[GridAddress];
+		for (int32 WordIndex = 0; WordIndex < LinkableMask.NumWords(); WordIndex++)
+		{
+			uint64 Word = LinkableMask.GetWord(WordIndex) & ~ComponentVisitedMask.GetWord(WordIndex);
+			while (Word != 0)
+			{
+				const int32 NeighborAddress = (WordIndex << 6) + FSGBoardMask::LowestBitIndex(Word);
+				Word &= Word - 1;
+
+				ComponentVisitedMask.Set(NeighborAddress);
+				FloodStack.Add(NeighborAddress);
+			}
+		}
+	}
+
+	return ComponentSize;
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SGame.h"
+#include "SGBitBoard.h"
+#include "SGBoardState.h"
+
+/**
+ * Finds out whether the board still has a link line of the minimum length.
+ * The board is encoded as one linkable neighbor mask for every address, then a depth first search walks the masks.
+ * The link is symmetric, so the search is pruned by the connected component size: a component smaller than the
+ * minimum length has no link line, and any component with 3 tiles has a link line of 3.
+ */
+class SGAME_API FSGLinkSolver
+{
+public:
+	FSGLinkSolver();
+
+	/** Build the linkable neighbor masks from the grid bitboard */
+	void BuildFromBitBoard(const FSGBitBoard& inBitBoard);
+
+	/** Build the linkable neighbor masks from the headless board */
+	void BuildFromBoardState(const FSGBoardState& inBoardState);
+
+	/**
+	* Search a link line in the built board
+	*
+	* @param inMinimumLength	the shortest link line the player can collect
+	* @param OutLinkAddresses	if not null, gets the found link line
+	* @return false if the board is deadlocked
+	*/
+	bool FindLinkLine(int32 inMinimumLength, TArray<int32>* OutLinkAddresses = nullptr);
+
+	/** How many search steps the last FindLinkLine took */
+	int32 GetLastSearchStepNum() const { return SearchStepNum; }
+
+	/** The tiles which can be linked after the tile on the address, in the built board */
+	const FSGBoardMask& GetLinkableMask(int32 inGridAddress) const { return LinkableMasks[inGridAddress]; }
+
+private:
+	/** Depth first search from the head, the visited mask holds the current path */
+	bool SearchFrom(int32 inHeadAddress, int32 inPathLength);
+
+	/** Flood fill the component of the address, mark it visited and return its size */
+	int32 FloodComponent(int32 inStartAddress, FSGBoardMask& ComponentMask);
+
+	/** Linkable neighbors of every address, not including the address itself */
+	TArray<FSGBoardMask> LinkableMasks;
+
+	/** Addresses with a tile */
+	FSGBoardMask OccupiedMask;
+
+	/** Addresses on the current search path */
+	FSGBoardMask PathMask;
+
+	/** Addresses already put into a component */
+	FSGBoardMask ComponentVisitedMask;
+
+	/** Flood fill work list */
+	TArray<int32> FloodStack;
+
+	/** The current search path */
+	TArray<int32> PathAddresses;
+
+	int32 MinimumLength;
+	int32 SearchStepNum;
+};
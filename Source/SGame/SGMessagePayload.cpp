@@ -0,0 +1,6 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SGame.h"
+#include "SGMessagePayload.h"
+
+volatile int32 FSGMessageHeapAllocator::HeapAllocationNum = 0;
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SGame.h"
+#include "SGTileStructs.h"
+
+/** Inline capacity of the tile lists in the messages, covers every tile of an 8x8 board */
+#define SG_MESSAGE_INLINE_TILE_NUM 64
+
+/**
+ * Heap allocator for the message payloads, counts every heap allocation.
+ * The payloads live inline in the message, so the count only grows when a payload is bigger than the inline capacity.
+ */
+class SGAME_API FSGMessageHeapAllocator
+{
+public:
+	typedef FHeapAllocator::SizeType SizeType;
+
+	enum { NeedsElementType = false };
+	enum { RequireRangeCheck = true };
+
+	class ForAnyElementType : public FHeapAllocator::ForAnyElementType
+	{
+	public:
+		FORCEINLINE void ResizeAllocation(SizeType PreviousNumElements, SizeType NumElements, SIZE_T NumBytesPerElement)
+		{
+			if (NumElements > 0)
+			{
+				FPlatformAtomics::InterlockedIncrement(&HeapAllocationNum);
+			}
+			FHeapAllocator::ForAnyElementType::ResizeAllocation(PreviousNumElements, NumElements, NumBytesPerElement);
+		}
+	};
+
+	template<typename ElementType>
+	class ForElementType : public ForAnyElementType
+	{
+	public:
+		FORCEINLINE ElementType* GetAllocation() const
+		{
+			return (ElementType*)ForAnyElementType::GetAllocation();
+		}
+	};
+
+	/** How many times the message payloads went to the heap since the game started */
+	static int32 GetHeapAllocationNum() { return HeapAllocationNum; }
+
+private:
+	static volatile int32 HeapAllocationNum;
+};
+
+template <>
+struct TAllocatorTraits<FSGMessageHeapAllocator> : TAllocatorTraitsBase<FSGMessageHeapAllocator>
+{
+	enum { SupportsMove = true };
+	enum { IsZeroConstruct = true };
+};
+
+/** Tile ids or grid addresses carried by a message */
+typedef TArray<int32, TInlineAllocator<SG_MESSAGE_INLINE_TILE_NUM, FSGMessageHeapAllocator>> FSGMessageTileArray;
+
+/** Damage infos carried by a message, one for every damage tile in the link line */
+typedef TArray<FTileDamageInfo, TInlineAllocator<SG_MESSAGE_INLINE_TILE_NUM, FSGMessageHeapAllocator>> FSGMessageDamageInfoArray;
+
+/** Resource amounts carried by a message, using the resource type as index */
+typedef TArray<float, TInlineAllocator<static_cast<int32>(ESGResourceType::ETT_MAX), FSGMessageHeapAllocator>> FSGMessageResourceArray;
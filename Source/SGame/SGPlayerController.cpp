@@ -3,30 +3,38 @@
 #include "SGame.h"
 #include "SGPlayerController.h"
 #include "SGGameMode.h"
+#include "SGGrid.h"
 #include "SGCheatManager.h"
+#include "SGGlobalGameInstance.h"
 
 ASGPlayerController::ASGPlayerController(const FObjectInitializer& ObjectInitializer)
 {
 	// We want the mouse cursor to show immediately on startup, without having to click in the window.
 	bShowMouseCursor = true;
 
-	// We need click/touch events to interact with our tiles.
-	bEnableTouchEvents = bEnableClickEvents = true;
-	bEnableTouchOverEvents = bEnableMouseOverEvents = true;
+	// The tiles are picked from the grid geometry in PlayerTick, no trace under the cursor or the finger is needed.
+	bEnableTouchEvents = bEnableClickEvents = false;
+	bEnableTouchOverEvents = bEnableMouseOverEvents = false;
+
+	TileHitRatio = 0.8f;
+	bPointerPressed = false;
+	bSwipeBroken = false;
+	LastPointerLocation = FVector::ZeroVector;
+	LastPickedGridAddress = INDEX_NONE;
 
 	// Cheat manager allow us to do some fast debugging
 	CheatClass = USGCheatManager::StaticClass();
+
+	EventBus = nullptr;
 }
 
 void ASGPlayerController::BeginPlay()
 {
-	MessageEndpoint = FMessageEndpoint::Builder("Gameplay_PC")
-		.Handling<FMessage_Gameplay_PlayerBeginInput>(this, &ASGPlayerController::HandlePlayerBeginInput);
-	
-	if (MessageEndpoint.IsValid() == true)
+	EventBus = USGGlobalGameInstance::GetEventBus(this);
+	if (EventBus != nullptr)
 	{
 		// Subscribe the begin input event to allow the player input
-		MessageEndpoint->Subscribe<FMessage_Gameplay_PlayerBeginInput>();
+		EventBus->Subscribe<FMessage_Gameplay_PlayerBeginInput, ASGPlayerController, &ASGPlayerController::HandlePlayerBeginInput>(this);
 	}
 
 	for (FString SkillName : SkillNamesArray)
@@ -45,7 +53,155 @@ void ASGPlayerController::BeginPlay()
 	}
 }
 
-void ASGPlayerController::HandlePlayerBeginInput(const FMessage_Gameplay_PlayerBeginInput& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGPlayerController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (EventBus != nullptr)
+	{
+		EventBus->UnsubscribeAll(this);
+		EventBus = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ASGPlayerController::HandlePlayerBeginInput(const FMessage_Gameplay_PlayerBeginInput& Message)
 {
 	UE_LOG(LogSGame, Log, TEXT("Player begin input"));
 }
+
+void ASGPlayerController::PlayerTick(float DeltaTime)
+{
+	Super::PlayerTick(DeltaTime);
+
+	ASGGameMode* GameMode = Cast<ASGGameMode>(UGameplayStatics::GetGameMode(this));
+	ASGGrid* Grid = GameMode != nullptr ? GameMode->GetCurrentGrid() : nullptr;
+	if (Grid == nullptr)
+	{
+		return;
+	}
+
+	FVector PointerLocation;
+	bool bPressed = false;
+	const bool bPointerOnGridPlane = GetPointerGridLocation(Grid, PointerLocation, bPressed);
+	if (bPressed == true && bPointerOnGridPlane == true)
+	{
+		if (bPointerPressed == false)
+		{
+			// Just pressed, pick the tile under the pointer
+			bPointerPressed = true;
+			LastPickedGridAddress = INDEX_NONE;
+			bSwipeBroken = false;
+			PickTileAtAddress(Grid, Grid->GetGridAddressFromLocation(PointerLocation, TileHitRatio));
+		}
+		else if (bSwipeBroken == true)
+		{
+			// Back on the grid plane, the way in between is unknown, so only the tile under the pointer, the path goes on
+			bSwipeBroken = false;
+			PickTileAtAddress(Grid, Grid->GetGridAddressFromLocation(PointerLocation, TileHitRatio));
+		}
+		else
+		{
+			PickTilesAlongSwipe(Grid, LastPointerLocation, PointerLocation);
+		}
+		LastPointerLocation = PointerLocation;
+	}
+	else if (bPressed == true && bPointerPressed == true)
+	{
+		// Still pressed but off the grid plane, the last location is stale
+		bSwipeBroken = true;
+	}
+	else if (bPressed == false && bPointerPressed == true)
+	{
+		bPointerPressed = false;
+		bSwipeBroken = false;
+
+		// Released after picking tiles, the player ends the path
+		if (LastPickedGridAddress != INDEX_NONE && EventBus != nullptr)
+		{
+			FMessage_Gameplay_GameStatusUpdate GameStatusUpdateMessage;
+			GameStatusUpdateMessage.NewGameStatus = ESGGameStatus::EGS_PlayerEndBuildPath;
+			EventBus->Publish(GameStatusUpdateMessage);
+		}
+		LastPickedGridAddress = INDEX_NONE;
+	}
+}
+
+bool ASGPlayerController::GetPointerGridLocation(const ASGGrid* inGrid, FVector& OutLocation, bool& bOutPressed) const
+{
+	checkSlow(inGrid != nullptr);
+
+	// The finger first, the mouse simulates it
+	float ScreenX = 0.0f;
+	float ScreenY = 0.0f;
+	GetInputTouchState(ETouchIndex::Touch1, ScreenX, ScreenY, bOutPressed);
+	if (bOutPressed == false)
+	{
+		bOutPressed = IsInputKeyDown(EKeys::LeftMouseButton);
+		if (GetMousePosition(ScreenX, ScreenY) == false)
+		{
+			return false;
+		}
+	}
+
+	FVector WorldOrigin;
+	FVector WorldDirection;
+	if (DeprojectScreenPositionToWorld(ScreenX, ScreenY, WorldOrigin, WorldDirection) == false)
+	{
+		return false;
+	}
+
+	// The tiles lie on the plane of the grid, facing the camera along the Y axis
+	const float GridDepth = inGrid->GetActorLocation().Y;
+	if (FMath::IsNearlyZero(WorldDirection.Y) == true)
+	{
+		return false;
+	}
+	const float RayDistance = (GridDepth - WorldOrigin.Y) / WorldDirection.Y;
+	if (RayDistance < 0.0f)
+	{
+		return false;
+	}
+
+	OutLocation = WorldOrigin + WorldDirection * RayDistance;
+	return true;
+}
+
+void ASGPlayerController::PickTilesAlongSwipe(ASGGrid* inGrid, const FVector& inFromLocation, const FVector& inToLocation)
+{
+	checkSlow(inGrid != nullptr);
+
+	// Step a quarter of the tile, shorter than the hit part of any tile the swipe crosses
+	const float StepLength = inGrid->GetTileSize().GetMin() * 0.25f;
+	checkSlow(StepLength > 0.0f);
+	const int32 StepNum = FMath::Max(FMath::CeilToInt(FVector::Dist(inFromLocation, inToLocation) / StepLength), 1);
+	for (int32 Step = 1; Step <= StepNum; Step++)
+	{
+		const FVector StepLocation = FMath::Lerp(inFromLocation, inToLocation, static_cast<float>(Step) / StepNum);
+		PickTileAtAddress(inGrid, inGrid->GetGridAddressFromLocation(StepLocation, TileHitRatio));
+	}
+}
+
+void ASGPlayerController::PickTileAtAddress(ASGGrid* inGrid, int32 GridAddress)
+{
+	checkSlow(inGrid != nullptr);
+	if (GridAddress == INDEX_NONE || GridAddress == LastPickedGridAddress)
+	{
+		return;
+	}
+
+	const ASGTileBase* Tile = inGrid->GetTileFromGridAddress(GridAddress);
+	if (Tile == nullptr)
+	{
+		return;
+	}
+	LastPickedGridAddress = GridAddress;
+	UE_LOG(LogSGameTile, Log, TEXT("Tile %s was picked, address (%d,%d)"), *Tile->GetName(), GridAddress % inGrid->GetGridWidth(), GridAddress / inGrid->GetGridWidth());
+
+	// Tell the game logic, the new tile is picked
+	if (EventBus != nullptr)
+	{
+		FMessage_Gameplay_NewTilePicked TilePickedMessage;
+		TilePickedMessage.TileID = Tile->GetTileID();
+		EventBus->Publish(TilePickedMessage);
+	}
+}
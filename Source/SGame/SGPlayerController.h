@@ -3,14 +3,15 @@
 #pragma once
 
 #include "GameFramework/PlayerController.h"
-#include "MessageEndpoint.h"
-#include "MessageEndpointBuilder.h"
 #include "SGameMessages.h"
+#include "SGGameplayEventBus.h"
 #include "SGSkillBase.h"
 #include "SGPlayerSkillManager.h"
 
 #include "SGPlayerController.generated.h"
 
+class ASGGrid;
+
 /**
  * SGame player controller
  */
@@ -24,6 +25,12 @@ public:
 	/** Event when play begins for this actor. */
 	virtual void BeginPlay() override;
 
+	/** Event when play ends for this actor. */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Pick the tiles under the cursor or the finger, mapped to the grid address without any trace */
+	virtual void PlayerTick(float DeltaTime) override;
+
 	/** Player's current skill instance*/
 	UPROPERTY(BlueprintReadOnly, Category = "Skill")
 	TArray<ASGSkillBase*> SkillsArray;
@@ -34,10 +41,37 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Skill")
 	TArray<FString> SkillNamesArray;
 
+	/** Part of the tile size around the tile center which picks the tile, the gap around it lets a diagonal swipe pass the tile corners */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Input")
+	float TileHitRatio;
+
 private:
+	/**
+	* Where the cursor or the finger points on the grid plane
+	*
+	* @param OutLocation	the world location on the grid plane
+	* @param bOutPressed	whether the finger touches or the left mouse button is down
+	* @return false if the pointer doesn't face the grid
+	*/
+	bool GetPointerGridLocation(const ASGGrid* inGrid, FVector& OutLocation, bool& bOutPressed) const;
+
+	/** Pick the tiles on the way between the two pointer locations, so a fast swipe doesn't skip a tile */
+	void PickTilesAlongSwipe(ASGGrid* inGrid, const FVector& inFromLocation, const FVector& inToLocation);
+
+	/** Tell the game logic the tile on the address is picked, once for every tile the pointer enters */
+	void PickTileAtAddress(ASGGrid* inGrid, int32 GridAddress);
+
+	/** The pointer pressed in the last tick, where it was and the last tile it picked */
+	bool bPointerPressed;
+	FVector LastPointerLocation;
+
+	/** The pressed pointer left the grid plane, the swipe starts again from where it comes back */
+	bool bSwipeBroken;
+	int32 LastPickedGridAddress;
+
 	/** Player can input now*/
-	void HandlePlayerBeginInput(const FMessage_Gameplay_PlayerBeginInput& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandlePlayerBeginInput(const FMessage_Gameplay_PlayerBeginInput& Message);
 
-	// Holds the messaging endpoint.
-	TSharedPtr<FMessageEndpoint, ESPMode::ThreadSafe> MessageEndpoint;
+	// Holds the gameplay event bus.
+	FSGGameplayEventBus* EventBus;
 };
@@ -3,6 +3,7 @@
 #include "SGame.h"
 #include "SGSpritePawn.h"
 #include "PaperSprite.h"
+#include "SGGlobalGameInstance.h"
 
 // Sets default values
 ASGSpritePawn::ASGSpritePawn()
@@ -16,6 +17,7 @@ ASGSpritePawn::ASGSpritePawn()
 
 	HPMax = 100;
 	ArmorMax = 0;
+	EventBus = nullptr;
 }
 
 // Called when the game starts or when spawned
@@ -26,24 +28,33 @@ void ASGSpritePawn::BeginPlay()
 	CurrentHP = HPMax;
 	CurrentArmor = ArmorMax;
 	
-	MessageEndpoint = FMessageEndpoint::Builder("Gameplay_PlayerPawn")
-		.Handling<FMessage_Gameplay_PlayerTakeDamage>(this, &ASGSpritePawn::HandlePlayerTakeDamage)
-		.Handling<FMessage_Gameplay_ResourceCollect>(this, &ASGSpritePawn::HandleCollectResouce);
-	if (MessageEndpoint.IsValid() == true)
+	EventBus = USGGlobalGameInstance::GetEventBus(this);
+	if (EventBus != nullptr)
 	{
 		// Subscribe the grid needed messages
-		MessageEndpoint->Subscribe<FMessage_Gameplay_PlayerTakeDamage>();
-		MessageEndpoint->Subscribe<FMessage_Gameplay_ResourceCollect>();
+		EventBus->Subscribe<FMessage_Gameplay_PlayerTakeDamage, ASGSpritePawn, &ASGSpritePawn::HandlePlayerTakeDamage>(this);
+		EventBus->Subscribe<FMessage_Gameplay_ResourceCollect, ASGSpritePawn, &ASGSpritePawn::HandleCollectResouce>(this);
 	}
 }
 
+void ASGSpritePawn::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (EventBus != nullptr)
+	{
+		EventBus->UnsubscribeAll(this);
+		EventBus = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called every frame
 void ASGSpritePawn::Tick( float DeltaTime )
 {
 	Super::Tick( DeltaTime );
 }
 
-void ASGSpritePawn::HandlePlayerTakeDamage(const FMessage_Gameplay_PlayerTakeDamage& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGSpritePawn::HandlePlayerTakeDamage(const FMessage_Gameplay_PlayerTakeDamage& Message)
 {
 	// todo: Add armor damage calculation
 	CurrentHP = CurrentHP - Message.DirectDamage;
@@ -52,10 +63,10 @@ void ASGSpritePawn::HandlePlayerTakeDamage(const FMessage_Gameplay_PlayerTakeDam
 	OnPlayHitAniamtion();
 }
 
-void ASGSpritePawn::HandleCollectResouce(const FMessage_Gameplay_ResourceCollect& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGSpritePawn::HandleCollectResouce(const FMessage_Gameplay_ResourceCollect& Message)
 {
 	CurrentHP += Message.SummupResouces[static_cast<int32>(ESGResourceType::ETR_HP)];
-	FMath::Clamp(CurrentHP, 0, HPMax);
+	CurrentHP = FMath::Clamp(CurrentHP, 0, HPMax);
 	SetCurrentHealth(CurrentHP);
 
 	CurrentArmor += Message.SummupResouces[static_cast<int32>(ESGResourceType::ETT_Armor)];
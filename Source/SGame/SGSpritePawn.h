@@ -4,9 +4,8 @@
 
 #include "PaperSpriteComponent.h"
 #include "GameFramework/Pawn.h"
-#include "MessageEndpoint.h"
-#include "MessageEndpointBuilder.h"
 #include "SGameMessages.h"
+#include "SGGameplayEventBus.h"
 
 #include "SGSpritePawn.generated.h"
 
@@ -23,6 +22,9 @@ public:
 
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+
+	// Called when the level ends
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 	// Called every frame
 	virtual void Tick( float DeltaSeconds ) override;
@@ -53,15 +55,15 @@ protected:
 	void OnPlayHitAniamtion();
 
 	/** Handles the player picked new tile*/
-	void HandlePlayerTakeDamage(const FMessage_Gameplay_PlayerTakeDamage& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandlePlayerTakeDamage(const FMessage_Gameplay_PlayerTakeDamage& Message);
 
 	/** Handles collect resouce*/
-	void HandleCollectResouce(const FMessage_Gameplay_ResourceCollect& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleCollectResouce(const FMessage_Gameplay_ResourceCollect& Message);
 
 private:
 	UPROPERTY(Category = Sprite, VisibleAnywhere, BlueprintReadOnly, meta = (ExposeFunctionCategories = "Sprite,Rendering,Physics,Components|Sprite", AllowPrivateAccess = "true"))
 	class UPaperSpriteComponent* RenderComponent;
 
-	// Holds the messaging endpoint.
-	TSharedPtr<FMessageEndpoint, ESPMode::ThreadSafe> MessageEndpoint;
+	// Holds the gameplay event bus.
+	FSGGameplayEventBus* EventBus;
 };
@@ -4,6 +4,7 @@
 #include "SGTileBase.h"
 #include "SGGrid.h"
 #include "SGGameMode.h"
+#include "SGGlobalGameInstance.h"
 
 // Sets default values
 ASGTileBase::ASGTileBase()
@@ -13,6 +14,12 @@ ASGTileBase::ASGTileBase()
 
 	// We want the tile can be moved (falling), so we need a root component
 	SetRootComponent(GetRenderComponent());
+
+	// The player controller picks the tiles from the grid geometry, the tiles need no collision
+	GetRenderComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SetActorEnableCollision(false);
+
+	EventBus = nullptr;
 }
 
 // Called when the game starts or when spawned
@@ -20,107 +27,77 @@ void ASGTileBase::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// Set our class up to handle clicks and touches.
-	OnClicked.AddUniqueDynamic(this, &ASGTileBase::TilePress_Mouse);
-	OnBeginCursorOver.AddUniqueDynamic(this, &ASGTileBase::TileEnter_Mouse);
-	OnReleased.AddUniqueDynamic(this, &ASGTileBase::TileRelease_Mouse);
-
-	OnInputTouchBegin.AddUniqueDynamic(this, &ASGTileBase::TilePress);
-	OnInputTouchEnter.AddUniqueDynamic(this, &ASGTileBase::TileEnter);
-	OnInputTouchEnd.AddUniqueDynamic(this, &ASGTileBase::TileRelease);
-
-	FString EndPointName = FString::Printf(TEXT("Gameplay_Tile_%d"), GridAddress);
-	MessageEndpoint = FMessageEndpoint::Builder(*EndPointName)
-		.Handling<FMessage_Gameplay_TileSelectableStatusChange>(this, &ASGTileBase::HandleSelectableStatusChange)
-		.Handling<FMessage_Gameplay_TileLinkedStatusChange>(this, &ASGTileBase::HandleLinkStatusChange)
-		.Handling<FMessage_Gameplay_TileBeginMove>(this, &ASGTileBase::HandleTileMove)
-		.Handling<FMessage_Gameplay_TileCollect>(this, &ASGTileBase::HandleTileCollected)
-		.Handling<FMessage_Gameplay_DamageToTile>(this, &ASGTileBase::HandleTakeDamage);
-
-	if (MessageEndpoint.IsValid() == true)
-	{
-		// Subscribe the tile need events
-		MessageEndpoint->Subscribe<FMessage_Gameplay_TileSelectableStatusChange>();
-		MessageEndpoint->Subscribe<FMessage_Gameplay_TileLinkedStatusChange>();
-		MessageEndpoint->Subscribe<FMessage_Gameplay_TileBeginMove>();
-		MessageEndpoint->Subscribe<FMessage_Gameplay_TileCollect>();
-		MessageEndpoint->Subscribe<FMessage_Gameplay_DamageToTile>();
-	}
+	// The events are subscribed when the tile manager activates the tile
+	EventBus = USGGlobalGameInstance::GetEventBus(this);
 
 	Grid = Cast<ASGGrid>(GetOwner());
 }
 
-// Called every frame
-void ASGTileBase::Tick( float DeltaTime )
-{
-	Super::Tick( DeltaTime );
-
-	// TickFalling(DeltaTime);
-}
-
-void ASGTileBase::TilePress(ETouchIndex::Type FingerIndex, AActor* TouchedActor)
+void ASGTileBase::ActivateTile()
 {
-	UE_LOG(LogSGameTile, Log, TEXT("Tile %s was pressed, address (%d,%d)"), *GetName(), GridAddress % 6, GridAddress / 6);
-
-	// Tell the game logic, the new tile is picked
-	FMessage_Gameplay_NewTilePicked* TilePickedMessage = new FMessage_Gameplay_NewTilePicked();
-	TilePickedMessage->TileID = TileID;
-	if (MessageEndpoint.IsValid() == true)
+	if (EventBus != nullptr)
 	{
-		MessageEndpoint->Publish(TilePickedMessage, EMessageScope::Process);
+		// Subscribe the tile need events, the events for a single tile are sent to this tile only
+		EventBus->Subscribe<FMessage_Gameplay_TileSelectableStatusChange, ASGTileBase, &ASGTileBase::HandleSelectableStatusChange>(this);
+		EventBus->Subscribe<FMessage_Gameplay_TileLinkedStatusChange, ASGTileBase, &ASGTileBase::HandleLinkStatusChange>(this);
+		EventBus->Subscribe<FMessage_Gameplay_TileStatusChange, ASGTileBase, &ASGTileBase::HandleStatusChange>(this);
+		EventBus->Subscribe<FMessage_Gameplay_TileBeginMove, ASGTileBase, &ASGTileBase::HandleTileMove>(this);
+		EventBus->Subscribe<FMessage_Gameplay_TileCollect, ASGTileBase, &ASGTileBase::HandleTileCollected>(this);
+		EventBus->Subscribe<FMessage_Gameplay_DamageToTile, ASGTileBase, &ASGTileBase::HandleTakeDamage>(this);
 	}
-}
 
-void ASGTileBase::TileEnter(ETouchIndex::Type FingerIndex, AActor* TouchedActor)
-{
-	UE_LOG(LogSGameTile, Log, TEXT("Tile %s was entered, address (%d,%d)"), *GetName(), GridAddress % 6, GridAddress / 6);
-	FMessage_Gameplay_NewTilePicked* TilePickedMessage = new FMessage_Gameplay_NewTilePicked();
-	TilePickedMessage->TileID = TileID;
-	if (MessageEndpoint.IsValid() == true)
+	// Forget the damage cached by the last life of the tile
+	CachedDamageMessage.TileID = INDEX_NONE;
+
+	// Reset the look, the recycled tile may still show the linked, dimmed or dead sprite
+	checkSlow(GetRenderComponent());
+	if (Sprite_Normal != nullptr)
 	{
-		MessageEndpoint->Publish(TilePickedMessage, EMessageScope::Process);
+		GetRenderComponent()->SetSprite(Sprite_Normal);
 	}
+	GetRenderComponent()->SetSpriteColor(FLinearColor::White);
+	GetRenderComponent()->SetRelativeRotation(FRotator(0, 0, 0));
+	GetRenderComponent()->SetWorldScale3D(FVector(1.0f, 1.0f, 1.0f));
+
+	SetActorHiddenInGame(false);
+	SetActorTickEnabled(true);
 }
 
-void ASGTileBase::TileRelease(ETouchIndex::Type FingerIndex, AActor* TouchedActor)
+void ASGTileBase::DeactivateTile()
 {
-	FMessage_Gameplay_GameStatusUpdate* GameStatusUpdateMessage = new FMessage_Gameplay_GameStatusUpdate();
-	GameStatusUpdateMessage->NewGameStatus = ESGGameStatus::EGS_PlayerEndBuildPath;
-
-	if (MessageEndpoint.IsValid() == true)
+	// Remove all the subscriptions of the tile, including the ones from the sub class
+	if (EventBus != nullptr)
 	{
-		MessageEndpoint->Publish(GameStatusUpdateMessage, EMessageScope::Process);
+		EventBus->UnsubscribeAll(this);
 	}
-}
 
-void ASGTileBase::TilePress_Mouse(AActor* TouchedActor, FKey ButtonPressed)
-{
-	TilePress(ETouchIndex::Touch1, TouchedActor);
+	SetActorHiddenInGame(true);
+	SetActorTickEnabled(false);
 }
 
-void ASGTileBase::TileEnter_Mouse(AActor* TouchedActor)
+void ASGTileBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	// This is meant to simulate finger-swiping, so ignore if the mouse isn't clicked.
-	if (APlayerController* PC = UGameplayStatics::GetPlayerController(this, 0))
+	// Remove all the subscriptions of the tile, including the ones from the sub class
+	if (EventBus != nullptr)
 	{
-		if (PC->IsInputKeyDown(EKeys::LeftMouseButton))
-		{
-			TileEnter(ETouchIndex::Touch1, TouchedActor);
-		}
+		EventBus->UnsubscribeAll(this);
+		EventBus = nullptr;
 	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
-void ASGTileBase::TileRelease_Mouse(AActor* TouchedActor, FKey ButtonPressed)
+// Called every frame
+void ASGTileBase::Tick( float DeltaTime )
 {
-	if (APlayerController* PC = UGameplayStatics::GetPlayerController(this, 0))
-	{
-		TileRelease(ETouchIndex::Touch1, TouchedActor);
-	}
+	Super::Tick( DeltaTime );
+
+	// TickFalling(DeltaTime);
 }
 
 bool ASGTileBase::IsSelectable() const
 {
-	return Data.TileStatusArray.Contains(ESGTileStatusFlag::ESF_SELECTABLE);
+	return State.HasStatus(ESGTileStatusFlag::ESF_SELECTABLE);
 }
 
 void ASGTileBase::SetGridAddress(int32 NewLocation)
@@ -133,6 +110,12 @@ int32 ASGTileBase::GetGridAddress() const
 	return GridAddress;
 }
 
+const FSGBoardTile& ASGTileBase::GetArchetype() const
+{
+	check(Grid && Grid->GetTileManager());
+	return Grid->GetTileManager()->GetTileArchetype(TileTypeID);
+}
+
 void ASGTileBase::OnTileCollected()
 {
 
@@ -143,14 +126,14 @@ void ASGTileBase::OnTileTakeDamage()
 
 }
 
-TArray<FTileResourceUnit> ASGTileBase::GetTileResource() const
+const FSGTileResourceArray& ASGTileBase::GetTileResource() const
 {
-	return Data.TileResourceArray;
+	return GetArchetype().Resources;
 }
 
-void ASGTileBase::HandleTileCollected(const FMessage_Gameplay_TileCollect& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGTileBase::HandleTileCollected(const FMessage_Gameplay_TileCollect& Message)
 {
-	FILTER_MESSAGE;
+	checkSlow(Message.TileID == TileID);
 
 	// Do some collect animation
 
@@ -162,52 +145,17 @@ void ASGTileBase::HandleTileCollected(const FMessage_Gameplay_TileCollect& Messa
 	}
 }
 
-bool ASGTileBase::OnTakeTileDamage(const TArray<FTileDamageInfo>& DamageInfos, FTileLifeArmorInfo& LifeArmorInfo) const
+bool ASGTileBase::ApplyDamageResult(const FMessage_Gameplay_DamageToTile& Message)
 {
-	for (int i = 0; i < DamageInfos.Num(); i++)
-	{
-		// Calculate the piercing damage first
-		LifeArmorInfo.CurrentLife -= DamageInfos[i].InitialDamage * DamageInfos[i].PiercingArmorRatio;
-		if (LifeArmorInfo.CurrentLife < 0)
-		{
-			return true;
-		}
-
-		// Reduce the tile armor value
-		float ResultDamage = DamageInfos[i].InitialDamage * (1 - DamageInfos[i].PiercingArmorRatio);
-
-		// Currently the tile armor duracity is fix to 1 (1 armor absorb = 1 damage)
-		if (LifeArmorInfo.CurrentArmor > 0)
-		{
-			float ArmorBefore = LifeArmorInfo.CurrentArmor;
-			float ArmorAfter = ArmorBefore - ResultDamage;
-			LifeArmorInfo.CurrentArmor = FMath::Clamp(ArmorAfter, 0.0f, LifeArmorInfo.ArmorMax);
-			
-			ResultDamage -= ArmorBefore;
-			if (ResultDamage < 0)
-			{
-				ResultDamage = 0;
-			}
-		}
-
-		// The damage don't absorb completely 
-		if (ResultDamage > 0)
-		{
-			LifeArmorInfo.CurrentLife -= ResultDamage;
-			if (LifeArmorInfo.CurrentLife < 0)
-			{
-				return true;
-			}
-		}
-	}
-
-	return false;
+	State.LifeArmorInfo.CurrentLife = Message.CurrentLife;
+	State.LifeArmorInfo.CurrentArmor = Message.CurrentArmor;
+	return Message.bDead;
 }
 
-bool ASGTileBase::EvaluateDamageToTile(const TArray<FTileDamageInfo>& DamageInfos) const
+bool ASGTileBase::EvaluateDamageToTile(const FSGMessageDamageInfoArray& DamageInfos) const
 {
-	FTileLifeArmorInfo FakeInfo = Data.LifeArmorInfo;
-	return OnTakeTileDamage(DamageInfos, FakeInfo);
+	FTileLifeArmorInfo FakeInfo = State.LifeArmorInfo;
+	return FSGBoardRules::ApplyTileDamage(DamageInfos, FakeInfo);
 }
 
 void ASGTileBase::OnTweenCompleteNative(AiTweenEvent* eventOperator, AActor* actorTweening, USceneComponent* componentTweening, UWidget* widgetTweening, FName tweenName, FHitResult sweepHitResultForMoveEvents, bool successfulTransform)
@@ -219,11 +167,11 @@ void ASGTileBase::OnTweenCompleteNative(AiTweenEvent* eventOperator, AActor* act
 	}
 }
 
-void ASGTileBase::HandleTakeDamage(const FMessage_Gameplay_DamageToTile& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGTileBase::HandleTakeDamage(const FMessage_Gameplay_DamageToTile& Message)
 {
-	FILTER_MESSAGE;
+	checkSlow(Message.TileID == TileID);
 
-	if (Abilities.bCanTakeDamage == false)
+	if (GetAbilities().bCanTakeDamage == false)
 	{
 		UE_LOG(LogSGameTile, Log, TEXT("Tile cannnot take damage"));
 		return;
@@ -239,21 +187,46 @@ void ASGTileBase::HandleTakeDamage(const FMessage_Gameplay_DamageToTile& Message
 	}
 	else
 	{
-		// Take damage first
-		bool TileDead = OnTakeTileDamage(Message.DamageInfos, Data.LifeArmorInfo);
+		ApplyDamageResult(Message);
 	}
 }
 
-void ASGTileBase::HandleSelectableStatusChange(const FMessage_Gameplay_TileSelectableStatusChange& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGTileBase::HandleSelectableStatusChange(const FMessage_Gameplay_TileSelectableStatusChange& Message)
+{
+	FILTER_MESSAGE;
+
+	ApplySelectableStatus(Message.NewSelectableStatus);
+}
+
+void ASGTileBase::HandleLinkStatusChange(const FMessage_Gameplay_TileLinkedStatusChange& Message)
 {
 	FILTER_MESSAGE;
 
-	UE_LOG(LogSGameTile, Log, TEXT("Tile %d selectable flag changed to %d"), GridAddress, Message.NewSelectableStatus);
+	ApplyLinkStatus(Message.NewLinkStatus);
+}
+
+void ASGTileBase::HandleStatusChange(const FMessage_Gameplay_TileStatusChange& Message)
+{
+	// The message is sent to this tile only, and only carries its own status
+	if (Message.bSelectableChanged == true)
+	{
+		ApplySelectableStatus(Message.NewSelectableStatus);
+	}
 
-	if (Message.NewSelectableStatus == true)
+	if (Message.bLinkedChanged == true)
 	{
-		// Add the selectable flag to the status array
-		Data.TileStatusArray.AddUnique(ESGTileStatusFlag::ESF_SELECTABLE);
+		ApplyLinkStatus(Message.NewLinkStatus);
+	}
+}
+
+void ASGTileBase::ApplySelectableStatus(bool bNewSelectableStatus)
+{
+	UE_LOG(LogSGameTile, Log, TEXT("Tile %d selectable flag changed to %d"), GridAddress, bNewSelectableStatus);
+
+	if (bNewSelectableStatus == true)
+	{
+		// Add the selectable flag to the status flags
+		State.SetStatus(ESGTileStatusFlag::ESF_SELECTABLE);
 
 		// Set the white color 
 		GetRenderComponent()->SetSpriteColor(FLinearColor::White);
@@ -261,40 +234,38 @@ void ASGTileBase::HandleSelectableStatusChange(const FMessage_Gameplay_TileSelec
 	else
 	{
 		// Remove the selectable flag
-		Data.TileStatusArray.Remove(ESGTileStatusFlag::ESF_SELECTABLE);
+		State.ClearStatus(ESGTileStatusFlag::ESF_SELECTABLE);
 
 		// Dim the sprite
 		GetRenderComponent()->SetSpriteColor(FLinearColor(0.2f, 0.2f, 0.2f));
 	}
 }
 
-void ASGTileBase::HandleLinkStatusChange(const FMessage_Gameplay_TileLinkedStatusChange& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGTileBase::ApplyLinkStatus(bool bNewLinkStatus)
 {
-	FILTER_MESSAGE;
+	UE_LOG(LogSGameTile, Log, TEXT("Tile %d link status changed to %d"), GridAddress, bNewLinkStatus);
 
-	UE_LOG(LogSGameTile, Log, TEXT("Tile %d link status changed to %d"), GridAddress, Message.NewLinkStatus);
-
-	if (Message.NewLinkStatus == true)
+	if (bNewLinkStatus == true)
 	{
-		// Add the selectable flag to the status array
-		Data.TileStatusArray.AddUnique(ESGTileStatusFlag::ESF_LINKED);
+		// Add the linked flag to the status flags
+		State.SetStatus(ESGTileStatusFlag::ESF_LINKED);
 
 		// Set the linked sprite
 		GetRenderComponent()->SetSprite(Sprite_Selected);
 	}
 	else
 	{
-		// Remove the selectable flag
-		Data.TileStatusArray.Remove(ESGTileStatusFlag::ESF_LINKED);
+		// Remove the linked flag
+		State.ClearStatus(ESGTileStatusFlag::ESF_LINKED);
 
 		// Set the normal sprite
 		GetRenderComponent()->SetSprite(Sprite_Normal);
 	}
 }
 
-void ASGTileBase::HandleTileMove(const FMessage_Gameplay_TileBeginMove& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context)
+void ASGTileBase::HandleTileMove(const FMessage_Gameplay_TileBeginMove& Message)
 {
-	FILTER_MESSAGE;
+	checkSlow(Message.TileID == TileID);
 
 	UE_LOG(LogSGameTile, Log, TEXT("Tile ID: %d, at old address: %d will move to the new address %d"), Message.TileID, Message.OldTileAddress, Message.NewTileAddress);
 
@@ -316,12 +287,12 @@ void ASGTileBase::HandleTileMove(const FMessage_Gameplay_TileBeginMove& Message,
 void ASGTileBase::FinishFalling()
 {
 	SetActorLocation(FallingEndLocation);
-	if (MessageEndpoint.IsValid() == true)
+	if (EventBus != nullptr)
 	{
 		// Send the finish move message to other module
-		FMessage_Gameplay_TileEndMove* Message = new FMessage_Gameplay_TileEndMove();
-		Message->TileID = TileID;
-		MessageEndpoint->Publish(Message, EMessageScope::Process);
+		FMessage_Gameplay_TileEndMove Message;
+		Message.TileID = TileID;
+		EventBus->Publish(Message);
 	}
 }
 
@@ -5,18 +5,22 @@
 #include "PaperSprite.h"
 #include "PaperSpriteActor.h"
 #include "GameFramework/Actor.h"
-#include "MessageEndpoint.h"
 #include "SGameMessages.h"
+#include "SGBoardRules.h"
 #include "iTween/iTInterface.h"
 
 #include "SGTileBase.generated.h"
 
 class ASGGrid;
+class FSGGameplayEventBus;
 
+// Only needed by the messages which can be broadcast to all tiles with the -1 tile id,
+// the messages for a single tile are sent to the tile directly
 #define  FILTER_MESSAGE \
 	if (FilterMessage(Message.TileID) == false) \
 	return;
 
+/** The data of a tile type, the spawned tiles share it through the tile archetype of their library entry */
 USTRUCT(BlueprintType)
 struct FSGTileData
 {
@@ -27,10 +31,6 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	ESGTileType TileType;
 
-	/** The current tile status flag, should not be accessed anywhere, for test convenient now*/
-	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-	TArray<ESGTileStatusFlag> TileStatusArray;
-
 	/** The current tile resource info*/
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TArray<FTileResourceUnit> TileResourceArray;
@@ -39,11 +39,53 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	FTileDamageInfo CauseDamageInfo;
 
-	/** The current tile damage info, only valid if the tile can take damage*/
+	/** The initial tile life and armor, only valid if the tile can take damage*/
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	FTileLifeArmorInfo LifeArmorInfo;
 };
 
+/** The state of a spawned tile, the rest of the tile data is shared by the tile type */
+USTRUCT(BlueprintType)
+struct FSGTileState
+{
+	GENERATED_USTRUCT_BODY();
+
+public:
+	FSGTileState()
+		: TileStatusFlags(0)
+	{
+	}
+
+	/** Whether the tile is in the status */
+	FORCEINLINE bool HasStatus(ESGTileStatusFlag inFlag) const
+	{
+		return (TileStatusFlags & GetStatusBit(inFlag)) != 0;
+	}
+
+	FORCEINLINE void SetStatus(ESGTileStatusFlag inFlag)
+	{
+		TileStatusFlags |= GetStatusBit(inFlag);
+	}
+
+	FORCEINLINE void ClearStatus(ESGTileStatusFlag inFlag)
+	{
+		TileStatusFlags &= ~GetStatusBit(inFlag);
+	}
+
+	FORCEINLINE static int32 GetStatusBit(ESGTileStatusFlag inFlag)
+	{
+		return 1 << static_cast<int32>(inFlag);
+	}
+
+	/** The current tile status flags, one bit for every ESGTileStatusFlag*/
+	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, meta = (Bitmask, BitmaskEnum = "ESGTileStatusFlag"))
+	int32 TileStatusFlags;
+
+	/** The current tile life and armor, only valid if the tile can take damage*/
+	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
+	FTileLifeArmorInfo LifeArmorInfo;
+};
+
 USTRUCT(BlueprintType)
 struct FSGTileType
 {
@@ -52,6 +94,10 @@ struct FSGTileType
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	float Probability;
 
+	/** Scale the probability by the round, the curve time is the round number. Leave it empty to use the same probability in every round */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	class UCurveFloat* RoundProbabilityCurve;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TSubclassOf<class ASGTileBase> TileClass;
 
@@ -70,6 +116,7 @@ struct FSGTileType
 	FSGTileType()
 	{
 		Probability = 1;
+		RoundProbabilityCurve = nullptr;
 		TileClass = nullptr;
 	}
 };
@@ -85,37 +132,38 @@ public:
 
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+
+	// Called when the tile is destroyed or the level ends
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/**
+	* Called by the tile manager when the tile is spawned or taken from the pool,
+	* after the tile id, data and abilities are set. Subscribes the tile events and resets the look.
+	*/
+	virtual void ActivateTile();
+
+	/** Called by the tile manager before the tile goes back to the pool, the tile stops receiving events and is hidden */
+	virtual void DeactivateTile();
 	
 	// Called every frame
 	virtual void Tick( float DeltaSeconds ) override;
 
-	/** When a tile is touched. */
-	UFUNCTION()
-	void TilePress(ETouchIndex::Type FingerIndex, AActor* TouchedActor);
-
-	/** When the user's finger moves over a tile. */
-	UFUNCTION()
-	void TileEnter(ETouchIndex::Type FingerIndex, AActor* TouchedActor);
-
-	/** When the user's finger release a tile*/
+	/** Is current tile selecatable*/
 	UFUNCTION()
-	void TileRelease(ETouchIndex::Type FingerIndex, AActor* TouchedActor);
+	bool IsSelectable() const;
 
-	/** Mouse surrogate for TilePress. */
-	UFUNCTION()
-	void TilePress_Mouse(AActor* TouchedActor, FKey ButtonPressed);
+	/** Whether the tile is in the status */
+	UFUNCTION(BlueprintPure, Category = "Tile")
+	bool HasTileStatus(ESGTileStatusFlag inFlag) const { return State.HasStatus(inFlag); }
 
-	/** Mouse surrogate for TileEnter. */
-	UFUNCTION()
-	void TileEnter_Mouse(AActor* TouchedActor);
+	/** The base type of the tile */
+	UFUNCTION(BlueprintPure, Category = "Tile")
+	ESGTileType GetTileType() const { return GetArchetype().TileType; }
 
-	/** Mouse surrogate for TileRelease*/
-	UFUNCTION()
-	void TileRelease_Mouse(AActor* TouchedActor, FKey ButtonPressed);
+	/** The data shared by the tiles of the same library entry, found by the tile type id */
+	const FSGBoardTile& GetArchetype() const;
 
-	/** Is current tile selecatable*/
-	UFUNCTION()
-	bool IsSelectable() const;
+	const FSGTileAbilities& GetAbilities() const { return GetArchetype().Abilities; }
 
 	void SetGridAddress(int32 NewLocation);
 	int32 GetGridAddress() const;
@@ -123,7 +171,7 @@ public:
 	int32 GetTileID() const { return TileID; }
 	void SetTileID(int32 val) { TileID = val; }
 
-	virtual int32 GetTileCausedDamage() const { return Data.CauseDamageInfo.InitialDamage; }
+	virtual int32 GetTileCausedDamage() const { return GetArchetype().CauseDamageInfo.InitialDamage; }
 
 	int32 GetSpawnedRound() const { return SpawnedRound; }
 	void SetSpawnedRound(int32 val) { SpawnedRound = val; }
@@ -131,12 +179,18 @@ public:
 	UPROPERTY(BlueprintReadOnly)
 	int32 TileTypeID;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	/** The class default abilities, the library entries without their own abilities use them. The spawned tile reads its archetype */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
 	FSGTileAbilities Abilities;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	/** The class default data, the library entries without their own data use them. The spawned tile reads its archetype */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
 	FSGTileData Data;
 
+	/** The state of this tile, reset from the archetype when the tile is spawned or taken from the pool */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	FSGTileState State;
+
 	// Falling functions
 	UFUNCTION(BlueprintImplementableEvent)
 	void StartFalling();
@@ -150,7 +204,7 @@ public:
 	virtual void OnTileTakeDamage();
 
 	/** Return the tile resource that can be collect */
-	virtual TArray<FTileResourceUnit> GetTileResource() const;
+	virtual const FSGTileResourceArray& GetTileResource() const;
 
 	/**
 	* Evaluate the if the tile survive after this damage
@@ -159,7 +213,7 @@ public:
 	*
 	* @return return true means that the tile is dead (life reduce to 0)
 	*/
-	bool EvaluateDamageToTile(const TArray<FTileDamageInfo>& DamageInfos) const;
+	bool EvaluateDamageToTile(const FSGMessageDamageInfoArray& DamageInfos) const;
 
 	virtual void OnTweenCompleteNative(AiTweenEvent* eventOperator, AActor* actorTweening, USceneComponent* componentTweening, UWidget* widgetTweening, FName tweenName, FHitResult sweepHitResultForMoveEvents, bool successfulTransform) override;
 
@@ -199,14 +253,11 @@ protected:
 	ASGGrid* Grid;
 
 	/**
-	* Called when the tile take damage
-	*
-	* @param DamageInfos	all the damage infos caused to the tiles
-	* @param LifeArmorInfo	the life armor info to take damage
+	* Copy the life and armor the grid tile store computed for the damage
 	*
 	* @return return true means that the tile is dead (life reduce to 0)
 	*/
-	virtual bool OnTakeTileDamage(const TArray<FTileDamageInfo>& DamageInfos, FTileLifeArmorInfo& LifeArmorInfo) const;
+	bool ApplyDamageResult(const FMessage_Gameplay_DamageToTile& Message);
 
 	/** If the Message send to me */
 	bool FilterMessage(int32 inTileID)
@@ -224,26 +275,35 @@ protected:
 
 private:
 
-	// Holds the messaging endpoint.
+	// Holds the gameplay event bus.
 	// Note that we don't want the sub class inherited this member,
 	// because every message handler should explicitly handled by itself class
-	TSharedPtr<FMessageEndpoint, ESPMode::ThreadSafe> MessageEndpoint;
+	FSGGameplayEventBus* EventBus;
 
 	/** Handles tile become selectalbe */
-	void HandleSelectableStatusChange(const FMessage_Gameplay_TileSelectableStatusChange& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleSelectableStatusChange(const FMessage_Gameplay_TileSelectableStatusChange& Message);
 
 	/** Handles tile become selectalbe */
-	void HandleLinkStatusChange(const FMessage_Gameplay_TileLinkedStatusChange& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleLinkStatusChange(const FMessage_Gameplay_TileLinkedStatusChange& Message);
+
+	/** Handles the batched status change, only the changed tiles are in the message */
+	void HandleStatusChange(const FMessage_Gameplay_TileStatusChange& Message);
+
+	/** Apply the new selectable status to the tile */
+	void ApplySelectableStatus(bool bNewSelectableStatus);
+
+	/** Apply the new link status to the tile */
+	void ApplyLinkStatus(bool bNewLinkStatus);
 
 	/** Handles tile become selectalbe */
-	void HandleTileMove(const FMessage_Gameplay_TileBeginMove& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleTileMove(const FMessage_Gameplay_TileBeginMove& Message);
 
 	/** Handle tile collected */
-	void HandleTileCollected(const FMessage_Gameplay_TileCollect& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleTileCollected(const FMessage_Gameplay_TileCollect& Message);
 
 	/** Handle tile linked */
-	void HandleTileLinked(const FMessage_Gameplay_TileCollect& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleTileLinked(const FMessage_Gameplay_TileCollect& Message);
 
 	/** Handle take damage message */
-	void HandleTakeDamage(const FMessage_Gameplay_DamageToTile& Message, const TSharedRef<IMessageContext, ESPMode::ThreadSafe>& Context);
+	void HandleTakeDamage(const FMessage_Gameplay_DamageToTile& Message);
 };
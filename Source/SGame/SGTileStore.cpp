@@ -0,0 +1,222 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SGame.h"
+#include "SGTileStore.h"
+
+DECLARE_CYCLE_STAT(TEXT("Tile Store Link Damage"), STAT_SGTileStoreLinkDamage, STATGROUP_SGame);
+
+FSGTileStore::FSGTileStore()
+{
+	EnemyNum = 0;
+}
+
+void FSGTileStore::Init(int32 inAddressNum)
+{
+	checkSlow(inAddressNum >= 0);
+
+	TileTypeIDs.Init(INDEX_NONE, inAddressNum);
+	TileTypes.Init(ESGTileType::ETT_Sword, inAddressNum);
+	Lives.Init(0.0f, inAddressNum);
+	Armors.Init(0.0f, inAddressNum);
+	ArmorMaxes.Init(0.0f, inAddressNum);
+	Damages.Init(0.0f, inAddressNum);
+	PiercingRatios.Init(0.0f, inAddressNum);
+	EnemyWeights.Init(0.0f, inAddressNum);
+	for (TArray<float>& Yields : ResourceYields)
+	{
+		Yields.Init(0.0f, inAddressNum);
+	}
+	AddressWeights.Init(0.0f, inAddressNum);
+	AliveWeights.Init(0.0f, inAddressNum);
+	EnemyNum = 0;
+}
+
+void FSGTileStore::SetTile(int32 GridAddress, const FSGBoardTile& inTile)
+{
+	checkSlow(TileTypeIDs.IsValidIndex(GridAddress));
+
+	// Replace the old tile
+	ClearTile(GridAddress);
+	if (inTile.IsEmpty() == true)
+	{
+		return;
+	}
+
+	TileTypeIDs[GridAddress] = inTile.TileTypeID;
+	TileTypes[GridAddress] = inTile.TileType;
+	Lives[GridAddress] = inTile.LifeArmorInfo.CurrentLife;
+	Armors[GridAddress] = inTile.LifeArmorInfo.CurrentArmor;
+	ArmorMaxes[GridAddress] = inTile.LifeArmorInfo.ArmorMax;
+	Damages[GridAddress] = inTile.CauseDamageInfo.InitialDamage;
+	PiercingRatios[GridAddress] = inTile.CauseDamageInfo.PiercingArmorRatio;
+	if (inTile.Abilities.bEnemyTile == true)
+	{
+		EnemyWeights[GridAddress] = 1.0f;
+		EnemyNum++;
+	}
+
+	// The same resource type may appear more than once
+	for (const FTileResourceUnit& Resource : inTile.Resources)
+	{
+		ResourceYields[static_cast<int32>(Resource.ResourceType)][GridAddress] += Resource.ResourceAmount;
+	}
+}
+
+void FSGTileStore::ClearTile(int32 GridAddress)
+{
+	checkSlow(TileTypeIDs.IsValidIndex(GridAddress));
+
+	if (EnemyWeights[GridAddress] > 0.0f)
+	{
+		EnemyNum--;
+	}
+
+	TileTypeIDs[GridAddress] = INDEX_NONE;
+	Lives[GridAddress] = 0.0f;
+	Armors[GridAddress] = 0.0f;
+	ArmorMaxes[GridAddress] = 0.0f;
+	Damages[GridAddress] = 0.0f;
+	PiercingRatios[GridAddress] = 0.0f;
+	EnemyWeights[GridAddress] = 0.0f;
+	for (TArray<float>& Yields : ResourceYields)
+	{
+		Yields[GridAddress] = 0.0f;
+	}
+}
+
+void FSGTileStore::MoveTile(int32 FromGridAddress, int32 ToGridAddress)
+{
+	checkSlow(TileTypeIDs.IsValidIndex(FromGridAddress) && TileTypeIDs.IsValidIndex(ToGridAddress));
+	checkSlow(IsEmpty(ToGridAddress) == true);
+
+	TileTypeIDs[ToGridAddress] = TileTypeIDs[FromGridAddress];
+	TileTypes[ToGridAddress] = TileTypes[FromGridAddress];
+	Lives[ToGridAddress] = Lives[FromGridAddress];
+	Armors[ToGridAddress] = Armors[FromGridAddress];
+	ArmorMaxes[ToGridAddress] = ArmorMaxes[FromGridAddress];
+	Damages[ToGridAddress] = Damages[FromGridAddress];
+	PiercingRatios[ToGridAddress] = PiercingRatios[FromGridAddress];
+	EnemyWeights[ToGridAddress] = EnemyWeights[FromGridAddress];
+	for (TArray<float>& Yields : ResourceYields)
+	{
+		Yields[ToGridAddress] = Yields[FromGridAddress];
+	}
+
+	// The enemy moved with the tile
+	EnemyWeights[FromGridAddress] = 0.0f;
+	ClearTile(FromGridAddress);
+}
+
+void FSGTileStore::BuildAddressWeights(const FSGMessageTileArray& inGridAddresses)
+{
+	FMemory::Memzero(AddressWeights.GetData(), AddressWeights.Num() * sizeof(float));
+	for (int32 i = 0; i < inGridAddresses.Num(); i++)
+	{
+		checkSlow(AddressWeights.IsValidIndex(inGridAddresses[i]));
+		AddressWeights[inGridAddresses[i]] = 1.0f;
+	}
+}
+
+void FSGTileStore::SumResources(const FSGMessageTileArray& inGridAddresses, FSGMessageResourceArray& SumupResource)
+{
+	checkSlow(SumupResource.Num() == static_cast<int32>(ESGResourceType::ETT_MAX));
+	BuildAddressWeights(inGridAddresses);
+
+	const int32 AddressNum = Num();
+	const float* RESTRICT Weights = AddressWeights.GetData();
+	for (int32 ResourceType = 0; ResourceType < static_cast<int32>(ESGResourceType::ETT_MAX); ResourceType++)
+	{
+		const float* RESTRICT Yields = ResourceYields[ResourceType].GetData();
+		float Sum = 0.0f;
+		for (int32 GridAddress = 0; GridAddress < AddressNum; GridAddress++)
+		{
+			Sum += Yields[GridAddress] * Weights[GridAddress];
+		}
+		SumupResource[ResourceType] += Sum;
+	}
+}
+
+bool FSGTileStore::SumEnemyAttackDamage(float& outDamageCanBeShield, float& outDamageDirectToHP) const
+{
+	if (EnemyNum == 0)
+	{
+		return false;
+	}
+
+	// Same split as FSGBoardRules::AddEnemyAttackDamage, the other tiles have zero weight
+	const int32 AddressNum = Num();
+	const float* RESTRICT TileDamages = Damages.GetData();
+	const float* RESTRICT TilePiercingRatios = PiercingRatios.GetData();
+	const float* RESTRICT Weights = EnemyWeights.GetData();
+	float DamageCanBeShield = 0.0f;
+	float DamageDirectToHP = 0.0f;
+	for (int32 GridAddress = 0; GridAddress < AddressNum; GridAddress++)
+	{
+		const float EnemyDamage = TileDamages[GridAddress] * Weights[GridAddress];
+		DamageCanBeShield += EnemyDamage * (1 - TilePiercingRatios[GridAddress]);
+		DamageDirectToHP += EnemyDamage * TilePiercingRatios[GridAddress];
+	}
+
+	outDamageCanBeShield += DamageCanBeShield;
+	outDamageDirectToHP += DamageDirectToHP;
+	return true;
+}
+
+void FSGTileStore::BuildLinkDamageInfos(const FSGMessageTileArray& inSourceAddresses, FSGMessageDamageInfoArray& OutDamageInfos) const
+{
+	OutDamageInfos.Reset(inSourceAddresses.Num());
+	for (int32 i = 0; i < inSourceAddresses.Num(); i++)
+	{
+		checkSlow(IsEmpty(inSourceAddresses[i]) == false);
+		OutDamageInfos.Add(GetDamageInfo(inSourceAddresses[i]));
+	}
+}
+
+void FSGTileStore::ApplyLinkDamage(const FSGMessageTileArray& inTargetAddresses, const FSGMessageDamageInfoArray& inDamageInfos, FSGMessageTileArray& OutDeadAddresses)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SGTileStoreLinkDamage);
+
+	OutDeadAddresses.Reset();
+	BuildAddressWeights(inTargetAddresses);
+	FMemory::Memcpy(AliveWeights.GetData(), AddressWeights.GetData(), AddressWeights.Num() * sizeof(float));
+
+	// One pass over the board for every damage info, the dead target stops taking damage like ApplyTileDamage returns
+	const int32 AddressNum = Num();
+	float* RESTRICT TileLives = Lives.GetData();
+	float* RESTRICT TileArmors = Armors.GetData();
+	float* RESTRICT Alive = AliveWeights.GetData();
+	const float* RESTRICT TileArmorMaxes = ArmorMaxes.GetData();
+	for (int32 i = 0; i < inDamageInfos.Num(); i++)
+	{
+		const float PiercingDamage = inDamageInfos[i].InitialDamage * inDamageInfos[i].PiercingArmorRatio;
+		const float ArmorDamage = inDamageInfos[i].InitialDamage * (1 - inDamageInfos[i].PiercingArmorRatio);
+		for (int32 GridAddress = 0; GridAddress < AddressNum; GridAddress++)
+		{
+			const bool bTarget = Alive[GridAddress] > 0.0f;
+
+			// Calculate the piercing damage first
+			const float PiercedLife = TileLives[GridAddress] - PiercingDamage;
+			const bool bArmorStep = bTarget && PiercedLife >= 0;
+
+			// The armor absorbs the rest, 1 armor absorb = 1 damage
+			const float ArmorBefore = TileArmors[GridAddress];
+			const bool bHasArmor = ArmorBefore > 0;
+			const float ArmorAfter = FMath::Clamp(ArmorBefore - ArmorDamage, 0.0f, TileArmorMaxes[GridAddress]);
+			const float ResultDamage = bHasArmor ? FMath::Max(ArmorDamage - ArmorBefore, 0.0f) : ArmorDamage;
+			const float LifeAfter = bArmorStep ? PiercedLife - ResultDamage : PiercedLife;
+
+			TileArmors[GridAddress] = (bArmorStep && bHasArmor) ? ArmorAfter : ArmorBefore;
+			TileLives[GridAddress] = bTarget ? LifeAfter : TileLives[GridAddress];
+			Alive[GridAddress] = (bTarget && LifeAfter >= 0) ? 1.0f : 0.0f;
+		}
+	}
+
+	// The targets which were hit and are not alive any more
+	for (int32 i = 0; i < inTargetAddresses.Num(); i++)
+	{
+		if (Alive[inTargetAddresses[i]] == 0.0f)
+		{
+			OutDeadAddresses.Add(inTargetAddresses[i]);
+		}
+	}
+}
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SGame.h"
+#include "SGBoardState.h"
+#include "SGMessagePayload.h"
+
+/**
+ * Gameplay data of the grid tiles as a structure of arrays, indexed by the grid address and kept in sync with the grid tiles.
+ * The resource, enemy attack and link damage sums run as plain loops over the arrays instead of calling every tile actor.
+ * The empty addresses keep zero in every array, so the loops don't branch on them.
+ */
+class SGAME_API FSGTileStore
+{
+public:
+	FSGTileStore();
+
+	/** Initialize the empty store */
+	void Init(int32 inAddressNum);
+
+	/** Place the tile on the address, with its current life and armor */
+	void SetTile(int32 GridAddress, const FSGBoardTile& inTile);
+
+	/** Remove the tile on the address */
+	void ClearTile(int32 GridAddress);
+
+	/** Move the tile to another empty address */
+	void MoveTile(int32 FromGridAddress, int32 ToGridAddress);
+
+	int32 Num() const { return TileTypeIDs.Num(); }
+
+	bool IsEmpty(int32 GridAddress) const { return TileTypeIDs[GridAddress] == INDEX_NONE; }
+	int32 GetTileTypeID(int32 GridAddress) const { return TileTypeIDs[GridAddress]; }
+	ESGTileType GetTileType(int32 GridAddress) const { return TileTypes[GridAddress]; }
+	float GetLife(int32 GridAddress) const { return Lives[GridAddress]; }
+	float GetArmor(int32 GridAddress) const { return Armors[GridAddress]; }
+
+	FTileDamageInfo GetDamageInfo(int32 GridAddress) const
+	{
+		FTileDamageInfo DamageInfo;
+		DamageInfo.InitialDamage = Damages[GridAddress];
+		DamageInfo.PiercingArmorRatio = PiercingRatios[GridAddress];
+		return DamageInfo;
+	}
+
+	/**
+	* Sum up the resources of the tiles
+	*
+	* @param inGridAddresses	the collected tiles
+	* @param SumupResource		the resource sum, using the resource type as index
+	*/
+	void SumResources(const FSGMessageTileArray& inGridAddresses, FSGMessageResourceArray& SumupResource);
+
+	/**
+	* The attack of all the enemy tiles on the board
+	*
+	* @return false if there is no enemy on the board
+	*/
+	bool SumEnemyAttackDamage(float& outDamageCanBeShield, float& outDamageDirectToHP) const;
+
+	/** The link damage, one damage info for every damage source tile */
+	void BuildLinkDamageInfos(const FSGMessageTileArray& inSourceAddresses, FSGMessageDamageInfoArray& OutDamageInfos) const;
+
+	/**
+	* Apply the link damage to the target tiles, same rule as FSGBoardRules::ApplyTileDamage
+	*
+	* @param inTargetAddresses	the tiles taking the damage
+	* @param inDamageInfos		the link damage
+	* @param OutDeadAddresses	the targets whose life reduced to 0, in the target order
+	*/
+	void ApplyLinkDamage(const FSGMessageTileArray& inTargetAddresses, const FSGMessageDamageInfoArray& inDamageInfos, FSGMessageTileArray& OutDeadAddresses);
+
+private:
+	/** Set the weight of the addresses to 1 and the others to 0 */
+	void BuildAddressWeights(const FSGMessageTileArray& inGridAddresses);
+
+	TArray<int32> TileTypeIDs;
+	TArray<ESGTileType> TileTypes;
+
+	TArray<float> Lives;
+	TArray<float> Armors;
+	TArray<float> ArmorMaxes;
+
+	/** Damage the tile causes, the enemy attack or the link damage */
+	TArray<float> Damages;
+	TArray<float> PiercingRatios;
+
+	/** 1 for the enemy tiles, 0 for the others */
+	TArray<float> EnemyWeights;
+	int32 EnemyNum;
+
+	/** Resource amount of every address, one array for every resource type */
+	TArray<float> ResourceYields[static_cast<int32>(ESGResourceType::ETT_MAX)];
+
+	/** Scratch weights of the selected addresses, and the alive targets during the link damage */
+	TArray<float> AddressWeights;
+	TArray<float> AliveWeights;
+};
@@ -13,7 +13,8 @@ enum class ESGTileType : uint8
 	ETT_Coin = 3,					// Coin
 	ETT_Mana = 4,					// Mana
 	ETT_Arrow = 5,					// Arrow
-	ETT_Soldier = 6					// Soldier
+	ETT_Soldier = 6,				// Soldier
+	ETT_MAX = 7,					// Max tile type
 };
 
 /** Types of resource type. */
@@ -93,7 +94,7 @@ struct FSGTileAbilities
 	bool bCanCauseCustomBehavior;
 };
 
-/** Types of every possible tile state flag that the tile will be in, note it can be in multiple state */
+/** Types of every possible tile state flag that the tile will be in, note it can be in multiple state, the flag is the bit index in the status mask */
 UENUM(BlueprintType)
 enum class ESGTileStatusFlag : uint8
 {
@@ -9,3 +9,4 @@ DECLARE_LOG_CATEGORY_EXTERN(LogSGameTile, Display, All);
 DECLARE_LOG_CATEGORY_EXTERN(LogSGameProcedure, Display, All);
 DECLARE_LOG_CATEGORY_EXTERN(LogSGameAsyncTask, Display, All);
 
+DECLARE_STATS_GROUP(TEXT("SGame"), STATGROUP_SGame, STATCAT_Advanced);
@@ -2,6 +2,7 @@
 
 #include "SGame.h"
 #include "SGTileStructs.h"
+#include "SGMessagePayload.h"
 
 #include "SGameMessages.generated.h"
 
@@ -11,6 +12,14 @@ USTRUCT()
 struct FMessage_Gameplay_GameStart
 {
 	GENERATED_USTRUCT_BODY()
+
+	/** Seed of the match random stream, only used when bUseFixedSeed is set */
+	UPROPERTY()
+	int32 RandomSeed = 0;
+
+	/** Start the match from the fixed RandomSeed, otherwise the match picks a new seed */
+	UPROPERTY()
+	bool bUseFixedSeed = false;
 };
 
 /**
@@ -69,9 +78,8 @@ struct FMessage_Gameplay_LinkedTilesCollect
 {
 	GENERATED_USTRUCT_BODY()
 
-	/** The collected tile address */
-	UPROPERTY()
-	TArray<int32> TilesAddressToCollect;
+	/** The collected tile address, inline payload so it is not reflected */
+	FSGMessageTileArray TilesAddressToCollect;
 };
 
 /**
@@ -112,9 +120,17 @@ struct FMessage_Gameplay_DamageToTile
 	UPROPERTY()
 	int32 TileID;
 
-	/** The damage info */
+	/** Life of the tile after the damage, from the grid tile store */
+	UPROPERTY()
+	float CurrentLife = 0.0f;
+
+	/** Armor of the tile after the damage, from the grid tile store */
 	UPROPERTY()
-	TArray<FTileDamageInfo> DamageInfos;
+	float CurrentArmor = 0.0f;
+
+	/** The damage killed the tile */
+	UPROPERTY()
+	bool bDead = false;
 };
 
 /**
@@ -194,6 +210,33 @@ struct FMessage_Gameplay_TileLinkedStatusChange
 	bool NewLinkStatus;
 };
 
+/**
+* The selectable and link status change of one tile, only sent to the tiles whose status really changed
+*/
+USTRUCT()
+struct FMessage_Gameplay_TileStatusChange
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The changed tile */
+	UPROPERTY()
+	int32 TileID;
+
+	/** Whether the selectable status changed, and the new status */
+	UPROPERTY()
+	bool bSelectableChanged;
+
+	UPROPERTY()
+	bool NewSelectableStatus;
+
+	/** Whether the link status changed, and the new status */
+	UPROPERTY()
+	bool bLinkedChanged;
+
+	UPROPERTY()
+	bool NewLinkStatus;
+};
+
 /**
 * Player take damage
 */
@@ -219,9 +262,8 @@ struct FMessage_Gameplay_ResourceCollect
 {
 	GENERATED_USTRUCT_BODY()
 
-	/** Collect resouce array, using the resource type as index */
-	UPROPERTY()
-	TArray<float> SummupResouces;
+	/** Collect resouce array, using the resource type as index, inline payload so it is not reflected */
+	FSGMessageResourceArray SummupResouces;
 };
 
 /** Defines the game state */